@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file boot_orchestrator.h
+ * @brief Dependency-driven boot sequencing with parallel steps and a timing report.
+ *
+ * Each init step names the steps it depends on. Steps whose dependencies are
+ * satisfied run concurrently on a small pool of worker tasks (the calling
+ * task is one of them), so slow independent work — SPIFFS mount, asset sync,
+ * Wi-Fi driver init, Zigbee platform config — overlaps instead of queueing.
+ *
+ * Every step records start/end timestamps; the table stays readable after
+ * boot so the slowest phase can be identified and attacked.
+ *
+ * Usage:
+ * @code
+ * static const boot_step_t steps[] = {
+ *     { .name = "nvs",    .fn = step_nvs_init },
+ *     { .name = "diag",   .fn = step_crash_diag,  .deps = { "nvs" } },
+ *     { .name = "spiffs", .fn = step_spiffs },
+ *     { .name = "assets", .fn = step_assets,      .deps = { "nvs", "spiffs" } },
+ *     { .name = "wifi",   .fn = step_wifi_init,   .deps = { "nvs" } },
+ *     { .name = "zb_cfg", .fn = step_zb_platform, .deps = { "nvs" } },
+ *     { .name = "http",   .fn = step_http_start,  .deps = { "assets", "wifi" } },
+ * };
+ * boot_orchestrator_run(steps, sizeof(steps) / sizeof(steps[0]), NULL);
+ * boot_orchestrator_log_report();
+ * @endcode
+ */
+
+#define BOOT_MAX_STEPS      16  /**< Steps per run */
+#define BOOT_MAX_DEPS       4   /**< Dependencies per step */
+#define BOOT_DEFAULT_WORKERS 2  /**< Worker tasks in addition to the caller */
+
+/** Step entry point. Return ESP_OK on success; any error skips dependents. */
+typedef esp_err_t (*boot_step_fn_t)(void *arg);
+
+typedef struct {
+    const char     *name;                 /**< Unique step name, referenced by deps */
+    boot_step_fn_t  fn;                   /**< Step body */
+    void           *arg;                  /**< Passed to fn */
+    const char     *deps[BOOT_MAX_DEPS];  /**< Names of prerequisite steps (unused = NULL) */
+    bool            optional;             /**< If true, failure does not skip dependents */
+} boot_step_t;
+
+typedef struct {
+    uint8_t  workers;     /**< Extra worker tasks (0 = run everything on the caller) */
+    uint32_t stack_size;  /**< Worker stack in bytes; must fit the hungriest step */
+    uint8_t  priority;    /**< Worker task priority */
+} boot_orchestrator_config_t;
+
+#define BOOT_ORCHESTRATOR_CONFIG_DEFAULT() { \
+    .workers    = BOOT_DEFAULT_WORKERS,      \
+    .stack_size = 4096,                      \
+    .priority   = 5,                         \
+}
+
+typedef enum {
+    BOOT_STEP_PENDING = 0,
+    BOOT_STEP_RUNNING,
+    BOOT_STEP_OK,
+    BOOT_STEP_FAILED,
+    BOOT_STEP_SKIPPED,   /**< Not run because a required dependency failed */
+} boot_step_state_t;
+
+/** Timing record for one step (one row of the report table). */
+typedef struct {
+    const char       *name;
+    boot_step_state_t state;
+    esp_err_t         result;
+    uint8_t           worker;    /**< 0 = calling task, 1.. = worker task */
+    int64_t           ready_us;  /**< esp_timer time when all deps had finished */
+    int64_t           start_us;  /**< esp_timer time when the step began */
+    int64_t           end_us;    /**< esp_timer time when the step returned */
+} boot_phase_record_t;
+
+/**
+ * Run the boot steps, blocking until every step has finished or been skipped.
+ *
+ * Validates the graph first (unique names, known deps, no cycles). Steps
+ * execute in dependency order, concurrently where the graph allows.
+ *
+ * @param steps  Step table. Must remain valid for as long as the report is read.
+ * @param count  Number of entries (max BOOT_MAX_STEPS)
+ * @param cfg    Worker pool config, or NULL for BOOT_ORCHESTRATOR_CONFIG_DEFAULT()
+ * @return ESP_OK if every non-optional step succeeded, ESP_FAIL if any failed
+ *         or was skipped, ESP_ERR_INVALID_ARG for a malformed graph,
+ *         ESP_ERR_NO_MEM if worker tasks could not be created.
+ */
+esp_err_t boot_orchestrator_run(const boot_step_t *steps, size_t count,
+                                const boot_orchestrator_config_t *cfg);
+
+/**
+ * Get the per-phase timing table from the last run.
+ *
+ * @param[out] records  Set to the internal table (valid until the next run)
+ * @param[out] count    Number of records
+ * @param[out] total_us Wall time of the whole run (may be NULL)
+ * @return ESP_OK, or ESP_ERR_INVALID_STATE if no run has completed
+ */
+esp_err_t boot_orchestrator_get_report(const boot_phase_record_t **records,
+                                       size_t *count, int64_t *total_us);
+
+/** Log the timing table, slowest step first. */
+void boot_orchestrator_log_report(void);
+
+/** Human-readable name for a step state. */
+const char *boot_orchestrator_state_str(boot_step_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
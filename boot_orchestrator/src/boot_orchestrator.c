@@ -0,0 +1,328 @@
+// SPDX-License-Identifier: MIT
+#include "boot_orchestrator.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "boot_orch";
+
+/* Run state — shared by the calling task and the worker tasks, guarded by s_lock */
+static const boot_step_t   *s_steps = NULL;
+static size_t               s_count = 0;
+static uint32_t             s_dep_mask[BOOT_MAX_STEPS];
+static boot_phase_record_t  s_records[BOOT_MAX_STEPS];
+static size_t               s_finished = 0;
+static int64_t              s_run_start_us = 0;
+static int64_t              s_run_total_us = 0;
+static bool                 s_report_valid = false;
+
+static SemaphoreHandle_t    s_lock = NULL;
+static SemaphoreHandle_t    s_progress = NULL;   /* counting: "a step changed state" */
+static SemaphoreHandle_t    s_exited = NULL;     /* counting: one give per worker exit */
+static StaticSemaphore_t    s_lock_buf;
+static StaticSemaphore_t    s_progress_buf;
+static StaticSemaphore_t    s_exited_buf;
+static uint8_t              s_worker_count = 0;
+
+#define PROGRESS_MAX_TOKENS 32
+
+/* ================================================================== */
+/*  Graph validation                                                   */
+/* ================================================================== */
+
+static int find_step(const char *name)
+{
+    for (size_t i = 0; i < s_count; i++) {
+        if (strcmp(s_steps[i].name, name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+static esp_err_t resolve_deps(void)
+{
+    for (size_t i = 0; i < s_count; i++) {
+        if (!s_steps[i].name || !s_steps[i].fn) {
+            ESP_LOGE(TAG, "Step %u: missing name or fn", (unsigned)i);
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (strcmp(s_steps[i].name, s_steps[j].name) == 0) {
+                ESP_LOGE(TAG, "Duplicate step name '%s'", s_steps[i].name);
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < s_count; i++) {
+        s_dep_mask[i] = 0;
+        for (int d = 0; d < BOOT_MAX_DEPS && s_steps[i].deps[d]; d++) {
+            int idx = find_step(s_steps[i].deps[d]);
+            if (idx < 0 || idx == (int)i) {
+                ESP_LOGE(TAG, "Step '%s': bad dependency '%s'",
+                         s_steps[i].name, s_steps[i].deps[d]);
+                return ESP_ERR_INVALID_ARG;
+            }
+            s_dep_mask[i] |= 1UL << idx;
+        }
+    }
+
+    /* Kahn's algorithm on bitmasks: repeatedly retire steps whose deps are retired */
+    uint32_t retired = 0;
+    uint32_t all = (1UL << s_count) - 1;
+    bool progress = true;
+    while (retired != all && progress) {
+        progress = false;
+        for (size_t i = 0; i < s_count; i++) {
+            if (!(retired & (1UL << i)) && (s_dep_mask[i] & ~retired) == 0) {
+                retired |= 1UL << i;
+                progress = true;
+            }
+        }
+    }
+    if (retired != all) {
+        ESP_LOGE(TAG, "Dependency cycle between boot steps");
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+/* ================================================================== */
+/*  Scheduling                                                         */
+/* ================================================================== */
+
+static bool is_terminal(boot_step_state_t st)
+{
+    return st == BOOT_STEP_OK || st == BOOT_STEP_FAILED || st == BOOT_STEP_SKIPPED;
+}
+
+static void broadcast_progress(void)
+{
+    for (uint8_t i = 0; i <= s_worker_count; i++) {
+        xSemaphoreGive(s_progress);
+    }
+}
+
+/* Caller holds s_lock. Returns a ready step index (marked RUNNING) or -1.
+ * Steps blocked by a failed dependency are marked SKIPPED along the way. */
+static int claim_ready_step(uint8_t worker)
+{
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < s_count; i++) {
+            boot_phase_record_t *r = &s_records[i];
+            if (r->state != BOOT_STEP_PENDING) continue;
+
+            bool ready = true, blocked = false;
+            int64_t ready_us = s_run_start_us;
+            for (size_t d = 0; d < s_count; d++) {
+                if (!(s_dep_mask[i] & (1UL << d))) continue;
+                const boot_phase_record_t *dr = &s_records[d];
+                if (dr->state == BOOT_STEP_SKIPPED ||
+                    (dr->state == BOOT_STEP_FAILED && !s_steps[d].optional)) {
+                    blocked = true;
+                    break;
+                }
+                if (!is_terminal(dr->state)) {
+                    ready = false;
+                } else if (dr->end_us > ready_us) {
+                    ready_us = dr->end_us;
+                }
+            }
+
+            if (blocked) {
+                r->state  = BOOT_STEP_SKIPPED;
+                r->result = ESP_ERR_INVALID_STATE;
+                s_finished++;
+                changed = true;   /* may unblock-to-skip further dependents */
+                continue;
+            }
+            if (ready) {
+                r->state    = BOOT_STEP_RUNNING;
+                r->worker   = worker;
+                r->ready_us = ready_us;
+                return (int)i;
+            }
+        }
+    }
+    return -1;
+}
+
+static void worker_loop(uint8_t worker)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    while (s_finished < s_count) {
+        int idx = claim_ready_step(worker);
+        if (idx < 0) {
+            if (s_finished >= s_count) break;
+            xSemaphoreGive(s_lock);
+            xSemaphoreTake(s_progress, portMAX_DELAY);
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            continue;
+        }
+
+        const boot_step_t *step = &s_steps[idx];
+        s_records[idx].start_us = esp_timer_get_time();
+        xSemaphoreGive(s_lock);
+
+        esp_err_t err = step->fn(step->arg);
+        int64_t end = esp_timer_get_time();
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        s_records[idx].end_us = end;
+        s_records[idx].result = err;
+        s_records[idx].state  = (err == ESP_OK) ? BOOT_STEP_OK : BOOT_STEP_FAILED;
+        s_finished++;
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Step '%s' failed: %s%s", step->name, esp_err_to_name(err),
+                     step->optional ? " (optional)" : "");
+        }
+        broadcast_progress();
+    }
+    xSemaphoreGive(s_lock);
+    broadcast_progress();   /* let idle workers observe completion */
+}
+
+static void worker_task(void *arg)
+{
+    uint8_t worker = (uint8_t)(uintptr_t)arg;
+    worker_loop(worker);
+    xSemaphoreGive(s_exited);
+    vTaskDelete(NULL);
+}
+
+/* ================================================================== */
+/*  Public API                                                         */
+/* ================================================================== */
+
+esp_err_t boot_orchestrator_run(const boot_step_t *steps, size_t count,
+                                const boot_orchestrator_config_t *cfg)
+{
+    static const boot_orchestrator_config_t default_cfg = BOOT_ORCHESTRATOR_CONFIG_DEFAULT();
+    if (!cfg) cfg = &default_cfg;
+    if (!steps || count == 0 || count > BOOT_MAX_STEPS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_steps = steps;
+    s_count = count;
+    s_report_valid = false;
+    esp_err_t err = resolve_deps();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    memset(s_records, 0, sizeof(s_records));
+    for (size_t i = 0; i < count; i++) {
+        s_records[i].name = steps[i].name;
+    }
+    s_finished = 0;
+
+    if (!s_lock) {
+        s_lock     = xSemaphoreCreateMutexStatic(&s_lock_buf);
+        s_progress = xSemaphoreCreateCountingStatic(PROGRESS_MAX_TOKENS, 0, &s_progress_buf);
+        s_exited   = xSemaphoreCreateCountingStatic(BOOT_MAX_STEPS, 0, &s_exited_buf);
+    }
+    while (xSemaphoreTake(s_progress, 0) == pdTRUE) {}
+
+    s_run_start_us = esp_timer_get_time();
+
+    /* Never start more workers than the graph could ever keep busy */
+    uint8_t workers = cfg->workers;
+    if (workers > count - 1) workers = (uint8_t)(count - 1);
+    s_worker_count = 0;
+    for (uint8_t w = 1; w <= workers; w++) {
+        char name[configMAX_TASK_NAME_LEN];
+        snprintf(name, sizeof(name), "boot_w%u", w);
+        if (xTaskCreate(worker_task, name, cfg->stack_size, (void *)(uintptr_t)w,
+                        cfg->priority, NULL) != pdPASS) {
+            ESP_LOGW(TAG, "Worker %u create failed, continuing with %u",
+                     w, s_worker_count);
+            break;
+        }
+        s_worker_count++;
+    }
+
+    worker_loop(0);
+    for (uint8_t w = 0; w < s_worker_count; w++) {
+        xSemaphoreTake(s_exited, portMAX_DELAY);
+    }
+
+    s_run_total_us = esp_timer_get_time() - s_run_start_us;
+    s_report_valid = true;
+
+    err = ESP_OK;
+    for (size_t i = 0; i < count; i++) {
+        if (s_records[i].state == BOOT_STEP_SKIPPED ||
+            (s_records[i].state == BOOT_STEP_FAILED && !steps[i].optional)) {
+            err = ESP_FAIL;
+        }
+    }
+    ESP_LOGI(TAG, "Boot sequence done in %lld ms (%u steps, %u workers)%s",
+             (long long)(s_run_total_us / 1000), (unsigned)count,
+             (unsigned)s_worker_count + 1, err == ESP_OK ? "" : " — with failures");
+    return err;
+}
+
+esp_err_t boot_orchestrator_get_report(const boot_phase_record_t **records,
+                                       size_t *count, int64_t *total_us)
+{
+    if (!records || !count) return ESP_ERR_INVALID_ARG;
+    if (!s_report_valid) return ESP_ERR_INVALID_STATE;
+    *records = s_records;
+    *count   = s_count;
+    if (total_us) *total_us = s_run_total_us;
+    return ESP_OK;
+}
+
+void boot_orchestrator_log_report(void)
+{
+    if (!s_report_valid) {
+        ESP_LOGW(TAG, "No boot report available");
+        return;
+    }
+
+    /* Insertion sort of indices by duration, slowest first */
+    uint8_t order[BOOT_MAX_STEPS];
+    for (size_t i = 0; i < s_count; i++) {
+        uint8_t v = (uint8_t)i;
+        int64_t dv = s_records[v].end_us - s_records[v].start_us;
+        size_t j = i;
+        while (j > 0 &&
+               (s_records[order[j - 1]].end_us - s_records[order[j - 1]].start_us) < dv) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = v;
+    }
+
+    ESP_LOGI(TAG, "%-12s %-8s %2s %9s %9s %9s",
+             "step", "state", "w", "start_ms", "wait_ms", "dur_ms");
+    for (size_t k = 0; k < s_count; k++) {
+        const boot_phase_record_t *r = &s_records[order[k]];
+        bool ran = (r->state == BOOT_STEP_OK || r->state == BOOT_STEP_FAILED);
+        ESP_LOGI(TAG, "%-12s %-8s %2u %9.1f %9.1f %9.1f",
+                 r->name, boot_orchestrator_state_str(r->state), r->worker,
+                 ran ? (r->start_us - s_run_start_us) / 1000.0 : 0.0,
+                 ran ? (r->start_us - r->ready_us) / 1000.0 : 0.0,
+                 ran ? (r->end_us - r->start_us) / 1000.0 : 0.0);
+    }
+    ESP_LOGI(TAG, "total %.1f ms", s_run_total_us / 1000.0);
+}
+
+const char *boot_orchestrator_state_str(boot_step_state_t state)
+{
+    switch (state) {
+        case BOOT_STEP_PENDING: return "PENDING";
+        case BOOT_STEP_RUNNING: return "RUNNING";
+        case BOOT_STEP_OK:      return "OK";
+        case BOOT_STEP_FAILED:  return "FAILED";
+        case BOOT_STEP_SKIPPED: return "SKIPPED";
+        default:                return "INVALID";
+    }
+}
@@ -0,0 +1,393 @@
+/**
+ * @file cli_args.hpp
+ * @brief Typed, declarative argument parsing for CLI command handlers
+ *
+ * A command declares its arguments once — type, name, range, default — as a
+ * constexpr spec bound to the fields of a plain struct. The spec parses argv
+ * straight into that struct (no heap, strings point into argv), validates
+ * ranges, and prints usage text generated from the same declarations, so the
+ * help can never drift from what the parser accepts.
+ *
+ * Argument kinds:
+ * - cli_int(&S::f, "name", min, max)        required positional integer
+ * - cli_int(&S::f, "name", min, max, def)   optional positional integer
+ * - cli_str(&S::f, "name")                  required positional string
+ * - cli_str(&S::f, "name", def)             optional positional string
+ * - cli_opt(&S::f, "-n", min, max, def)     integer option taking a value
+ * - cli_flag(&S::f, "--json")               boolean switch
+ *
+ * Options and flags may appear anywhere; positionals fill in declaration
+ * order. `-h` / `--help` prints the usage line.
+ *
+ * Example usage:
+ * @code
+ * struct LedArgs {
+ *     int32_t     index;
+ *     const char* mode;
+ *     uint32_t    ms;
+ *     bool        quiet;
+ * };
+ * static constexpr auto kLedArgs = cli_args<LedArgs>("led",
+ *     cli_int(&LedArgs::index, "index", 0, 3),
+ *     cli_str(&LedArgs::mode,  "mode", "on"),
+ *     cli_opt(&LedArgs::ms,    "-t", 0, 60000, 500),
+ *     cli_flag(&LedArgs::quiet, "-q"));
+ * static_assert(kLedArgs.is_valid(), "bad argument spec");
+ *
+ * static int cmd_led(int argc, char** argv)
+ * {
+ *     LedArgs a;
+ *     if (!kLedArgs.parse(argc, argv, a)) return 1;   // error + usage already printed
+ *     ...
+ * }
+ * // kLedArgs.print_usage() -> "usage: led <index:0..3> [mode=on] [-t 0..60000 (500)] [-q]"
+ * @endcode
+ */
+
+#pragma once
+
+#include "cli_framework.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+/// How an argument is matched on the command line
+enum class CliArgKind : uint8_t {
+    POSITIONAL,  ///< Filled by position
+    OPTION,      ///< "-x value"
+    FLAG,        ///< "-x", sets true
+};
+
+/**
+ * @brief Integer argument (positional or option) bound to S::*field
+ */
+template<typename S, typename T>
+struct CliIntArg {
+    static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value,
+                  "integer argument bound to a non-integer field");
+    using Struct = S;
+
+    T S::*      field;
+    const char* name;
+    int64_t     min;
+    int64_t     max;
+    T           def;
+    bool        required;
+    CliArgKind  kind;
+
+    void set_default(S& out) const { out.*field = def; }
+
+    /// min <= max, both representable in T, and an optional default within them
+    constexpr bool valid() const
+    {
+        constexpr int64_t lo = std::is_signed<T>::value
+            ? static_cast<int64_t>(std::numeric_limits<T>::min()) : 0;
+        constexpr int64_t hi =
+            static_cast<uint64_t>(std::numeric_limits<T>::max()) > static_cast<uint64_t>(INT64_MAX)
+            ? INT64_MAX : static_cast<int64_t>(std::numeric_limits<T>::max());
+        if (min > max || min < lo || max > hi) return false;
+        if (required) return true;
+        int64_t d = static_cast<int64_t>(def);
+        return d <= hi && d >= min && d <= max;
+    }
+
+    bool assign(S& out, const char* value) const
+    {
+        if (!value || !*value) {
+            Cli::printf("error: %s needs a value\n", name);
+            return false;
+        }
+        char* end = nullptr;
+        errno = 0;
+        long long v = strtoll(value, &end, 0);
+        if (*end != '\0' || errno == ERANGE) {
+            Cli::printf("error: %s: '%s' is not a number\n", name, value);
+            return false;
+        }
+        if (v < min || v > max) {
+            Cli::printf("error: %s must be %lld..%lld\n", name, (long long)min, (long long)max);
+            return false;
+        }
+        out.*field = static_cast<T>(v);
+        return true;
+    }
+
+    void print_usage() const
+    {
+        if (kind == CliArgKind::OPTION) {
+            Cli::printf(" [%s %lld..%lld (%lld)]", name, (long long)min, (long long)max, (long long)def);
+        } else if (required) {
+            Cli::printf(" <%s:%lld..%lld>", name, (long long)min, (long long)max);
+        } else {
+            Cli::printf(" [%s=%lld]", name, (long long)def);
+        }
+    }
+};
+
+/**
+ * @brief String argument — stored as a pointer into argv, never copied
+ */
+template<typename S>
+struct CliStrArg {
+    using Struct = S;
+
+    const char* S::* field;
+    const char*      name;
+    const char*      def;
+    bool             required;
+    CliArgKind       kind;
+
+    void set_default(S& out) const { out.*field = def; }
+
+    constexpr bool valid() const { return true; }
+
+    bool assign(S& out, const char* value) const
+    {
+        out.*field = value;
+        return true;
+    }
+
+    void print_usage() const
+    {
+        if (required) {
+            Cli::printf(" <%s>", name);
+        } else if (def) {
+            Cli::printf(" [%s=%s]", name, def);
+        } else {
+            Cli::printf(" [%s]", name);
+        }
+    }
+};
+
+/**
+ * @brief Boolean switch
+ */
+template<typename S>
+struct CliFlagArg {
+    using Struct = S;
+
+    bool S::*   field;
+    const char* name;
+    bool        required;  // always false; uniform with the other kinds
+    CliArgKind  kind;
+
+    void set_default(S& out) const { out.*field = false; }
+
+    constexpr bool valid() const { return true; }
+
+    bool assign(S& out, const char*) const
+    {
+        out.*field = true;
+        return true;
+    }
+
+    void print_usage() const { Cli::printf(" [%s]", name); }
+};
+
+/// Keeps a default value from taking part in deduction (500 works for a uint32_t field)
+template<typename T>
+struct CliNoDeduce {
+    using type = T;
+};
+
+template<typename S, typename T>
+constexpr CliIntArg<S, T> cli_int(T S::* field, const char* name, int64_t min, int64_t max)
+{
+    return { field, name, min, max, T{}, true, CliArgKind::POSITIONAL };
+}
+
+template<typename S, typename T>
+constexpr CliIntArg<S, T> cli_int(T S::* field, const char* name, int64_t min, int64_t max,
+                                  typename CliNoDeduce<T>::type def)
+{
+    return { field, name, min, max, def, false, CliArgKind::POSITIONAL };
+}
+
+template<typename S, typename T>
+constexpr CliIntArg<S, T> cli_opt(T S::* field, const char* name, int64_t min, int64_t max,
+                                  typename CliNoDeduce<T>::type def)
+{
+    return { field, name, min, max, def, false, CliArgKind::OPTION };
+}
+
+template<typename S>
+constexpr CliStrArg<S> cli_str(const char* S::* field, const char* name)
+{
+    return { field, name, nullptr, true, CliArgKind::POSITIONAL };
+}
+
+template<typename S>
+constexpr CliStrArg<S> cli_str(const char* S::* field, const char* name, const char* def)
+{
+    return { field, name, def, false, CliArgKind::POSITIONAL };
+}
+
+template<typename S>
+constexpr CliFlagArg<S> cli_flag(bool S::* field, const char* name)
+{
+    return { field, name, false, CliArgKind::FLAG };
+}
+
+/**
+ * @brief Heterogeneous argument list; each() expands to straight-line code
+ *        per argument, so the parser is generated per spec at compile time.
+ */
+template<typename... A>
+struct CliArgList {
+    constexpr CliArgList() = default;
+
+    template<typename F>
+    constexpr void each(F&&) const {}
+};
+
+template<typename H, typename... T>
+struct CliArgList<H, T...> {
+    H                 head;
+    CliArgList<T...>  tail;
+
+    constexpr CliArgList(H h, T... t) : head(h), tail(t...) {}
+
+    template<typename F>
+    constexpr void each(F&& f) const
+    {
+        f(head);
+        tail.each(f);
+    }
+};
+
+/**
+ * @brief Argument spec for one command; see the file comment
+ */
+template<typename S, typename... A>
+class CliArgSpec {
+public:
+    static_assert(sizeof...(A) > 0, "empty argument spec");
+
+    constexpr CliArgSpec(const char* command, A... args) : m_command(command), m_args(args...) {}
+
+    /**
+     * @brief Check the spec: names set and unique, options start with '-',
+     *        no required positional after an optional one, integer ranges
+     *        ordered, within the field type and containing their default.
+     *        For static_assert.
+     */
+    constexpr bool is_valid() const
+    {
+        bool ok = true;
+        bool seen_optional = false;
+        m_args.each([&](const auto& a) {
+            if (!a.name || !a.name[0]) ok = false;
+            if (!a.valid()) ok = false;
+            if (a.kind != CliArgKind::POSITIONAL && a.name && a.name[0] != '-') ok = false;
+            if (a.kind == CliArgKind::POSITIONAL) {
+                if (a.required && seen_optional) ok = false;
+                if (!a.required) seen_optional = true;
+            }
+            size_t same = 0;
+            m_args.each([&](const auto& b) {
+                if (a.name && b.name && cli_strcmp(a.name, b.name) == 0) ++same;
+            });
+            if (same != 1) ok = false;
+        });
+        return ok;
+    }
+
+    /**
+     * @brief Parse argv[1..argc) into out
+     *
+     * Fields not given on the command line get their defaults.
+     *
+     * @return true on success; false after printing the error and usage
+     *         (or just the usage for -h / --help)
+     */
+    bool parse(int argc, char** argv, S& out) const
+    {
+        m_args.each([&](const auto& a) { a.set_default(out); });
+
+        int position = 0;
+        for (int i = 1; i < argc; ++i) {
+            const char* tok = argv[i];
+            if (strcmp(tok, "-h") == 0 || strcmp(tok, "--help") == 0) {
+                print_usage();
+                return false;
+            }
+
+            bool ok = true;
+            bool matched = false;
+            if (is_switch(tok)) {
+                m_args.each([&](const auto& a) {
+                    if (matched || a.kind == CliArgKind::POSITIONAL || strcmp(a.name, tok) != 0) return;
+                    matched = true;
+                    if (a.kind == CliArgKind::FLAG) {
+                        ok = a.assign(out, nullptr);
+                    } else {
+                        ok = a.assign(out, (i + 1 < argc) ? argv[++i] : nullptr);
+                    }
+                });
+                if (!matched) Cli::printf("error: unknown option '%s'\n", tok);
+            } else {
+                int index = 0;
+                m_args.each([&](const auto& a) {
+                    if (matched || a.kind != CliArgKind::POSITIONAL) return;
+                    if (index++ == position) {
+                        matched = true;
+                        ok = a.assign(out, tok);
+                    }
+                });
+                position++;
+                if (!matched) Cli::printf("error: unexpected argument '%s'\n", tok);
+            }
+            if (!matched || !ok) {
+                print_usage();
+                return false;
+            }
+        }
+
+        const char* missing = nullptr;
+        int index = 0;
+        m_args.each([&](const auto& a) {
+            if (a.kind != CliArgKind::POSITIONAL) return;
+            if (a.required && index >= position && !missing) missing = a.name;
+            index++;
+        });
+        if (missing) {
+            Cli::printf("error: missing <%s>\n", missing);
+            print_usage();
+            return false;
+        }
+        return true;
+    }
+
+    /// Print "usage: <command> <args...>" generated from the spec
+    void print_usage() const
+    {
+        Cli::printf("usage: %s", m_command);
+        m_args.each([](const auto& a) { a.print_usage(); });
+        Cli::printf("\n");
+    }
+
+private:
+    const char*      m_command;
+    CliArgList<A...> m_args;
+
+    // "-x" / "--xyz", but not a negative number
+    static bool is_switch(const char* tok)
+    {
+        return tok[0] == '-' && tok[1] != '\0' && !(tok[1] >= '0' && tok[1] <= '9');
+    }
+};
+
+/**
+ * @brief Build an argument spec for struct S
+ * @param command Command name shown in the usage line
+ */
+template<typename S, typename... A>
+constexpr CliArgSpec<S, A...> cli_args(const char* command, A... args)
+{
+    static_assert((std::is_same<typename A::Struct, S>::value && ...),
+                  "argument bound to a different struct");
+    return CliArgSpec<S, A...>(command, args...);
+}
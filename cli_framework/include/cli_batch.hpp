@@ -0,0 +1,110 @@
+/**
+ * @file cli_batch.hpp
+ * @brief Batch execution of multi-line CLI scripts
+ *
+ * For provisioning and field debugging a whole script is sent at once. On a
+ * terminal session:
+ *
+ *   batch begin [--quiet]
+ *   wifi-set "MyNet" "secret"
+ *   repeat 3
+ *     led on
+ *     sleep 200
+ *     led off
+ *   end
+ *   on-error continue
+ *   nvs-stats
+ *   batch end
+ *
+ * Lines between `batch begin` and `batch end` are collected without echo or
+ * prompts, then run in one go. Control lines:
+ *
+ *   repeat <n> ... end          loop (nests up to MAX_DEPTH)
+ *   sleep <ms>                  pause (max 60000)
+ *   on-error stop|continue      failure policy from here on (default stop)
+ *   # ...                       comment
+ *
+ * Command output passes through unless --quiet. The run ends with one
+ * machine-readable result line:
+ *
+ *   {"batch":{"status":"ok|failed|aborted|error","executed":N,"failed":N,
+ *    "elapsed_ms":N,"errors":[{"line":L,"rc":R,"cmd":"..."}]}}
+ *
+ * The script is checked (repeat/end balance, argument ranges) before anything
+ * runs; a bad script produces status "error" and executes nothing.
+ *
+ * A WebSocket client sends the same script as one multi-line text frame.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Summary of one batch run
+ */
+struct CliBatchResult {
+    const char* status;      ///< "ok", "failed" (continued past errors), "aborted", "error"
+    uint32_t    executed;    ///< Commands run, counting every repeat iteration
+    uint32_t    failed;      ///< Commands that returned non-zero
+    uint32_t    elapsed_ms;
+};
+
+class CliBatch {
+public:
+    static constexpr size_t SCRIPT_MAX = 2048;  ///< Collected script bytes
+    static constexpr size_t MAX_LINES  = 128;
+    static constexpr size_t MAX_DEPTH  = 4;     ///< Nested repeat levels
+    static constexpr size_t MAX_ERRORS = 8;     ///< Failures listed in the result
+
+    CliBatch() = delete;
+
+    /**
+     * @brief Run a script and print the result line
+     *
+     * Output goes to Cli::out(); normally called through
+     * CliSession::run_batch(), which routes it and holds the CLI lock for the
+     * whole script. Commands run one after another on the calling task;
+     * `sleep` blocks it (and every other session) for its duration.
+     *
+     * @param script NUL-terminated, newline-separated; modified in place
+     * @param quiet  Discard command output, print only the result line
+     * @param out    Optional copy of the summary
+     * @return 0 if every command succeeded, 1 otherwise
+     */
+    static int run(char* script, bool quiet, CliBatchResult* out = nullptr);
+
+    /**
+     * @brief Claim the shared collection buffer for a session
+     * @return false if another session is collecting
+     */
+    static bool begin_collect(const void* owner);
+
+    /**
+     * @brief Append one line to the collection buffer
+     * @return false if the script no longer fits (the batch will be rejected)
+     */
+    static bool append(const void* owner, const char* line, size_t len);
+
+    /**
+     * @brief Run the collected script and release the buffer
+     * @return As run(), or 1 if the script overflowed
+     */
+    static int end_collect(const void* owner, bool quiet);
+
+    /**
+     * @brief Drop the collected script and release the buffer (Ctrl-C, disconnect)
+     */
+    static void cancel_collect(const void* owner);
+
+    /// Handler of the built-in `batch` command (prints how to start a batch)
+    static int cmd_batch(int argc, char** argv);
+
+private:
+    static char        s_script[SCRIPT_MAX];
+    static size_t      s_script_len;
+    static bool        s_overflow;
+    static const void* s_owner;
+};
@@ -0,0 +1,109 @@
+/**
+ * @file cli_bench.hpp
+ * @brief On-device micro-benchmark registry and `bench` command
+ *
+ * A benchmark is a function run once per iteration. The runner does a few
+ * untimed warm-up iterations, then times each iteration with the CPU cycle
+ * counter and reports min / median / p99 / max. Samples go into a static
+ * array, so the runner itself never allocates.
+ *
+ *   bench                              list registered benchmarks
+ *   bench <name|prefix|all> [-n N] [-w W] [--json]
+ *
+ * `bench nvs` runs every benchmark whose name starts with "nvs". --json
+ * prints one JSON object per benchmark on its own line, for scripts that
+ * compare firmware builds.
+ *
+ * Example usage:
+ * @code
+ * static void bench_led(void* ctx) { static_cast<BoardLed*>(ctx)->set_state(BoardLed::State::JOINED); }
+ *
+ * static const CliBenchCase kLedBench = { "led", "BoardLed::set_state", nullptr, bench_led, nullptr, &led };
+ *
+ * CliBench::add(kLedBench);
+ * cli_bench_add_stock();          // nvs-save, nvs-load, json-status
+ * CliBench::register_command();
+ * @endcode
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief One benchmark
+ */
+struct CliBenchCase {
+    const char* name;                   ///< Unique name (no spaces)
+    const char* description;            ///< One line shown by `bench`
+    esp_err_t (*setup)(void* ctx);      ///< Optional, once before warm-up
+    void      (*run)(void* ctx);        ///< The measured operation, one iteration
+    void      (*teardown)(void* ctx);   ///< Optional, once after the last iteration
+    void*       ctx;
+};
+
+/**
+ * @brief Result of one benchmark run, in CPU cycles per iteration
+ */
+struct CliBenchResult {
+    uint32_t iterations;
+    uint32_t min;
+    uint32_t median;
+    uint32_t p99;
+    uint32_t max;
+    uint32_t mean;
+};
+
+class CliBench {
+public:
+    static constexpr size_t   MAX_BENCHES        = 16;
+    static constexpr uint32_t MAX_ITERATIONS     = 1000;  ///< Sample array size
+    static constexpr uint32_t DEFAULT_ITERATIONS = 100;
+    static constexpr uint32_t DEFAULT_WARMUP     = 10;
+
+    CliBench() = delete;
+
+    /**
+     * @brief Register a benchmark
+     * @param bench Must have static storage
+     * @return ESP_OK, ESP_ERR_NO_MEM when full, ESP_ERR_INVALID_ARG for a bad
+     *         or duplicate name
+     */
+    static esp_err_t add(const CliBenchCase& bench);
+
+    /**
+     * @brief Register the `bench` command with Cli
+     */
+    static esp_err_t register_command();
+
+    /**
+     * @brief Run one benchmark programmatically
+     * @param iterations Timed iterations (clamped to MAX_ITERATIONS)
+     * @param warmup     Untimed iterations first
+     * @return ESP_OK, or the setup() error
+     */
+    static esp_err_t run(const CliBenchCase& bench, uint32_t iterations, uint32_t warmup,
+                         CliBenchResult* out);
+
+private:
+    static const CliBenchCase* s_benches[MAX_BENCHES];
+    static size_t              s_count;
+    static uint32_t            s_samples[MAX_ITERATIONS];
+
+    static int cmd_bench(int argc, char** argv);
+};
+
+/**
+ * @brief Add the stock benchmarks
+ *
+ * - nvs-save:    NvsStore::save<uint32_t>() (open, set, commit, close)
+ * - nvs-load:    NvsStore::load<uint32_t>()
+ * - json-status: build the /api/status-shaped cJSON object, print it
+ *                unformatted and free both — the web server's send_json() path
+ *
+ * The NVS benchmarks use the "cli_bench" namespace and clean up after
+ * themselves. crash_diag_bench_add() adds diag-json and diag-cbor.
+ */
+esp_err_t cli_bench_add_stock();
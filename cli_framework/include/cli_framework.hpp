@@ -0,0 +1,556 @@
+/**
+ * @file cli_framework.hpp
+ * @brief Allocation-free command-line framework with compile-time command tables
+ *
+ * Commands live in sorted tables and are dispatched by binary search, so a
+ * command resolves in O(log N) regardless of how many are registered. Tables
+ * are normally built at compile time: cli_make_table() sorts the entries in a
+ * constant expression and cli_table_is_valid() lets a static_assert reject
+ * duplicate names before the firmware is ever flashed.
+ *
+ * Input lines are tokenized in place (quotes and backslash escapes supported);
+ * argv points into the caller's buffer, so no heap is touched on the command
+ * path.
+ *
+ * Terminal sessions get line editing, a static history ring (CliHistory) and
+ * Tab completion backed by a trie built from the table at compile time.
+ *
+ * Input and output are transport-agnostic: a CliSession turns a byte stream
+ * into lines and routes command output to a CliSink in small chunks, so the
+ * same commands run over UART, USB-Serial-JTAG or a WebSocket (see
+ * cli_transport.hpp) and large dumps never need a large RAM buffer.
+ *
+ * Example usage:
+ * @code
+ * static int cmd_reboot(int argc, char** argv) { esp_restart(); return 0; }
+ * static int cmd_led(int argc, char** argv)    { ... Cli::printf("ok\n"); return 0; }
+ *
+ * static constexpr CliCommand kCommands[] = {
+ *     { "reboot", "Restart the device",     cmd_reboot },
+ *     { "led",    "led <on|off> - set LED", cmd_led    },
+ * };
+ * static constexpr auto kTable = cli_make_table(kCommands);
+ * static_assert(cli_table_is_valid(kTable), "duplicate or empty CLI command");
+ * static constexpr auto kTrie = cli_make_trie<cli_trie_size(kTable)>(kTable);  // tab completion
+ *
+ * Cli::register_table(kTable, kTrie);
+ * Cli::register_command("version", "Print firmware version", cmd_version);
+ *
+ * char line[] = "led \"on\"";
+ * Cli::execute(line);
+ * @endcode
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <sys/types.h>
+
+/**
+ * @brief Command handler, esp_console style
+ * @return 0 on success, non-zero command-specific error code otherwise
+ */
+using CliHandler = int (*)(int argc, char** argv);
+
+/**
+ * @brief One command table entry
+ */
+struct CliCommand {
+    const char* name;         ///< Command word (no spaces)
+    const char* description;  ///< One-line help text shown by `help`
+    CliHandler  handler;      ///< Called with argv[0] == name
+};
+
+/**
+ * @brief Compile-time string compare (strcmp semantics)
+ */
+constexpr int cli_strcmp(const char* a, const char* b)
+{
+    while (*a && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return static_cast<unsigned char>(*a) - static_cast<unsigned char>(*b);
+}
+
+/**
+ * @brief Fixed-size command table, sorted by name
+ *
+ * Produced by cli_make_table(); usually a constexpr object in flash.
+ */
+template<size_t N>
+struct CliCommandTable {
+    CliCommand entries[N];
+
+    constexpr size_t size() const { return N; }
+    constexpr const CliCommand& operator[](size_t i) const { return entries[i]; }
+};
+
+/**
+ * @brief Sort a command list by name at compile time
+ * @param cmds Unsorted command array
+ * @return Table with the same entries in ascending name order
+ */
+template<size_t N>
+constexpr CliCommandTable<N> cli_make_table(const CliCommand (&cmds)[N])
+{
+    CliCommandTable<N> table{};
+    for (size_t i = 0; i < N; ++i) {
+        // Insertion sort — N is small and this runs in the compiler
+        size_t j = i;
+        while (j > 0 && cli_strcmp(table.entries[j - 1].name, cmds[i].name) > 0) {
+            table.entries[j] = table.entries[j - 1];
+            --j;
+        }
+        table.entries[j] = cmds[i];
+    }
+    return table;
+}
+
+/**
+ * @brief Check a table is sorted, duplicate-free and fully populated
+ *
+ * Intended for static_assert next to the table definition.
+ */
+template<size_t N>
+constexpr bool cli_table_is_valid(const CliCommandTable<N>& table)
+{
+    for (size_t i = 0; i < N; ++i) {
+        if (!table.entries[i].name || !table.entries[i].name[0] || !table.entries[i].handler) {
+            return false;
+        }
+        if (i > 0 && cli_strcmp(table.entries[i - 1].name, table.entries[i].name) >= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief One node of a compile-time command-name trie
+ *
+ * Node 0 is the root. Children of a node form a sibling list in name order;
+ * index 0 doubles as "none" for child/sibling because the root is never a
+ * child.
+ */
+struct CliTrieNode {
+    char     ch;       ///< Character on the edge into this node
+    uint16_t child;    ///< First child, 0 = none
+    uint16_t sibling;  ///< Next sibling, 0 = none
+    uint16_t cmd;      ///< Table index of the command ending here, or NO_CMD
+
+    static constexpr uint16_t NO_CMD = 0xFFFF;
+};
+
+/// Longest command name a trie can hold
+static constexpr size_t CLI_TRIE_MAX_DEPTH = 32;
+
+/**
+ * @brief Trie over a CliCommandTable, used for tab completion
+ */
+template<size_t M>
+struct CliTrie {
+    CliTrieNode nodes[M];
+
+    constexpr size_t size() const { return M; }
+};
+
+/**
+ * @brief Node count for the trie of a sorted table
+ *
+ * In a sorted table each name adds one node per character beyond its common
+ * prefix with the previous name, so the trie is sized exactly.
+ */
+template<size_t N>
+constexpr size_t cli_trie_size(const CliCommandTable<N>& table)
+{
+    size_t nodes = 1;
+    for (size_t i = 0; i < N; ++i) {
+        size_t lcp = 0;
+        if (i > 0) {
+            const char* a = table.entries[i - 1].name;
+            const char* b = table.entries[i].name;
+            while (a[lcp] && a[lcp] == b[lcp]) ++lcp;
+        }
+        size_t len = 0;
+        while (table.entries[i].name[len]) ++len;
+        nodes += len - lcp;
+    }
+    return nodes;
+}
+
+/**
+ * @brief Build the trie of a sorted table at compile time
+ *
+ * @code
+ * static constexpr auto kTrie = cli_make_trie<cli_trie_size(kTable)>(kTable);
+ * Cli::register_table(kTable, kTrie);
+ * @endcode
+ *
+ * Sorted input means every new branch is appended after the previous name's
+ * node at the divergence depth, so only that one path needs to be tracked.
+ */
+template<size_t M, size_t N>
+constexpr CliTrie<M> cli_make_trie(const CliCommandTable<N>& table)
+{
+    static_assert(M < CliTrieNode::NO_CMD, "trie too large");
+    CliTrie<M> trie{};
+    trie.nodes[0] = { '\0', 0, 0, CliTrieNode::NO_CMD };
+    uint16_t path[CLI_TRIE_MAX_DEPTH + 1] = {};  // path[d] = node at depth d of the previous name
+    size_t prev_len = 0;
+    uint16_t next = 1;
+
+    for (size_t i = 0; i < N; ++i) {
+        const char* name = table.entries[i].name;
+        size_t lcp = 0;
+        if (i > 0) {
+            const char* prev = table.entries[i - 1].name;
+            while (prev[lcp] && prev[lcp] == name[lcp]) ++lcp;
+        }
+
+        size_t d = lcp;
+        for (; name[d] && d < CLI_TRIE_MAX_DEPTH; ++d) {
+            uint16_t node = next++;
+            trie.nodes[node] = { name[d], 0, 0, CliTrieNode::NO_CMD };
+            if (d == lcp && i > 0 && prev_len > lcp) {
+                trie.nodes[path[d + 1]].sibling = node;  // diverges from the previous name here
+            } else {
+                trie.nodes[path[d]].child = node;
+            }
+            path[d + 1] = node;
+        }
+        trie.nodes[path[d]].cmd = static_cast<uint16_t>(i);
+        prev_len = d;
+    }
+    return trie;
+}
+
+/**
+ * @brief Command registry, tokenizer and dispatcher
+ *
+ * All state is static: a handful of table slots plus a fixed-capacity sorted
+ * array for commands added one at a time with register_command(). Nothing is
+ * allocated after boot.
+ */
+class Cli {
+public:
+    static constexpr size_t MAX_ARGS             = 16;   ///< argv entries per line
+    static constexpr size_t MAX_TABLES           = 6;    ///< register_table() slots
+    static constexpr size_t MAX_DYNAMIC_COMMANDS = 16;   ///< register_command() capacity
+    static constexpr size_t LINE_MAX             = 256;  ///< Longest accepted input line
+
+    // execute() return codes (handler return values are passed through)
+    static constexpr int ERR_NOT_FOUND     = -1;  ///< Unknown command word
+    static constexpr int ERR_SYNTAX        = -2;  ///< Unterminated quote or dangling escape
+    static constexpr int ERR_TOO_MANY_ARGS = -3;  ///< More than MAX_ARGS tokens
+
+    Cli() = delete;
+
+    /**
+     * @brief Register a compile-time command table
+     * @param table Table built with cli_make_table(); must have static storage
+     * @return ESP_OK, ESP_ERR_NO_MEM if all table slots are used,
+     *         ESP_ERR_INVALID_ARG if unsorted or a name is already registered
+     */
+    template<size_t N>
+    static esp_err_t register_table(const CliCommandTable<N>& table)
+    {
+        return register_table(table.entries, N);
+    }
+
+    /**
+     * @brief Register a compile-time table together with its trie
+     *
+     * Same as above; the trie (from cli_make_trie()) serves tab completion.
+     */
+    template<size_t N, size_t M>
+    static esp_err_t register_table(const CliCommandTable<N>& table, const CliTrie<M>& trie)
+    {
+        return register_table(table.entries, N, trie.nodes);
+    }
+
+    /**
+     * @brief Register a sorted command array (runtime form of the above)
+     * @param cmds  Entries sorted by name; must have static storage
+     * @param count Number of entries
+     * @param trie  Optional trie nodes for cmds (static storage), or nullptr
+     */
+    static esp_err_t register_table(const CliCommand* cmds, size_t count,
+                                    const CliTrieNode* trie = nullptr);
+
+    /**
+     * @brief Register a single command
+     *
+     * Inserted into a fixed-capacity sorted array, so lookup stays a binary
+     * search. The strings must remain valid for the lifetime of the CLI.
+     *
+     * @return ESP_OK, ESP_ERR_NO_MEM when MAX_DYNAMIC_COMMANDS is reached,
+     *         ESP_ERR_INVALID_ARG for a bad or duplicate name
+     */
+    static esp_err_t register_command(const char* name, const char* description,
+                                      CliHandler handler);
+
+    /**
+     * @brief Look up a command by exact name
+     * @return Entry, or nullptr if not registered
+     */
+    static const CliCommand* find(const char* name);
+
+    /**
+     * @brief Split a line into arguments in place
+     *
+     * Whitespace separates tokens. Single quotes take everything literally;
+     * double quotes allow \" and \\ escapes; outside quotes a backslash
+     * escapes the next character. Quotes can join adjacent text ("a"b → ab).
+     * The line buffer is modified and argv entries point into it.
+     *
+     * @param line     NUL-terminated input, modified in place
+     * @param argv     Output token pointers
+     * @param max_args Capacity of argv
+     * @return Token count, ERR_SYNTAX or ERR_TOO_MANY_ARGS
+     */
+    static int tokenize(char* line, char** argv, size_t max_args);
+
+    /**
+     * @brief Tokenize a line in place and run the matching command
+     * @param line NUL-terminated input, modified in place
+     * @return Handler return value, 0 for a blank line, or one of the ERR_* codes
+     */
+    static int execute(char* line);
+
+    /**
+     * @brief Formatted output for command handlers
+     *
+     * Goes to the session that is executing the command (stdout when called
+     * outside a session). Output is streamed through the session's chunk
+     * buffer, so there is no length limit.
+     */
+    static int printf(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+    /**
+     * @brief Raw output for command handlers (same routing as printf)
+     */
+    static void write(const char* data, size_t len);
+
+    /**
+     * @brief Output stream of the executing session, for APIs that take a FILE*
+     *        (e.g. esp_timer_dump()). stdout outside a session.
+     */
+    static FILE* out();
+
+    /**
+     * @brief Wait inside a command handler without stalling other sessions
+     *
+     * Releases the execution lock for `ms` so commands from other
+     * sessions run meanwhile, then retakes it and restores this session's
+     * output. Inside a batch the lock is kept (the batch's tables are
+     * shared), so the wait blocks other sessions like `sleep` does. Anything
+     * the handler keeps in shared statics must survive another command
+     * running during the wait.
+     */
+    static void wait(uint32_t ms);
+
+    /**
+     * @brief Visit every registered command in name order
+     */
+    static void for_each(void (*fn)(const CliCommand& cmd, void* ctx), void* ctx);
+
+    /**
+     * @brief Visit every command whose name starts with a prefix
+     *
+     * Tables registered with a trie are walked through it; other tables and
+     * register_command() entries are range-scanned by binary search. Visit
+     * order is per table, not global.
+     *
+     * @param prefix Candidate prefix (need not be NUL-terminated)
+     * @param len    Prefix length
+     * @return Number of matches
+     */
+    static size_t complete(const char* prefix, size_t len,
+                           void (*fn)(const CliCommand& cmd, void* ctx), void* ctx);
+
+private:
+    friend class CliSession;
+    friend class CliBatch;
+
+    struct TableRef {
+        const CliCommand*  cmds;
+        size_t             count;
+        const CliTrieNode* trie;
+    };
+
+    static TableRef   s_tables[MAX_TABLES];
+    static size_t     s_table_count;
+    static CliCommand s_dynamic[MAX_DYNAMIC_COMMANDS];
+    static size_t     s_dynamic_count;
+    static FILE*      s_out;
+    static bool       s_in_batch;       ///< CliBatch::run() is executing
+
+    static void lock();
+    static void unlock();
+
+    static const CliCommand* search(const CliCommand* cmds, size_t count, const char* name);
+    static size_t complete_scan(const CliCommand* cmds, size_t count, const char* prefix, size_t len,
+                                void (*fn)(const CliCommand& cmd, void* ctx), void* ctx);
+    static size_t complete_trie(const CliCommand* cmds, const CliTrieNode* trie,
+                                const char* prefix, size_t len,
+                                void (*fn)(const CliCommand& cmd, void* ctx), void* ctx);
+};
+
+/**
+ * @brief Fixed-size command history
+ *
+ * Lines are stored back to back, NUL-terminated, in a byte ring; the oldest
+ * entries are overwritten as new ones arrive. Short commands therefore share
+ * the space instead of each taking a LINE_MAX slot, and nothing is allocated.
+ */
+class CliHistory {
+public:
+    static constexpr size_t BYTES = 512;  ///< Ring capacity, all entries together
+
+    CliHistory() : m_head(0), m_tail(0), m_count(0) {}
+
+    /**
+     * @brief Append a line (skipped if empty, too long, or equal to the newest)
+     */
+    void add(const char* line, size_t len);
+
+    /**
+     * @brief Copy an entry out
+     * @param age 0 = newest
+     * @param out Destination, NUL-terminated on success
+     * @param cap Capacity of out
+     * @return Entry length, or -1 if there is no such entry
+     */
+    int get(size_t age, char* out, size_t cap) const;
+
+    /// Number of stored entries
+    size_t count() const { return m_count; }
+
+private:
+    char     m_buf[BYTES];
+    uint32_t m_head;   ///< Write position (free-running)
+    uint32_t m_tail;   ///< Start of the oldest entry (free-running)
+    size_t   m_count;
+
+    char at(uint32_t pos) const { return m_buf[pos % BYTES]; }
+    uint32_t entry_start(uint32_t end) const;
+};
+
+/**
+ * @brief Output sink — where a session's command output ends up
+ *
+ * The transport interface: a transport supplies one of these per session and
+ * pushes received bytes into CliSession::feed().
+ */
+struct CliSink {
+    /// Deliver one chunk of output (at most CliSession::OUTPUT_CHUNK bytes)
+    void (*write)(void* ctx, const char* data, size_t len);
+    void* ctx;
+};
+
+/**
+ * @brief One interactive CLI connection
+ *
+ * Owns a line buffer and a small output chunk buffer. Bytes fed in are
+ * assembled into lines; each complete line is executed with output routed to
+ * this session's sink. Commands from different sessions are serialised.
+ *
+ * Echoing (terminal) sessions also get line editing: left/right, Home/End,
+ * Delete, Ctrl-A/E/U, up/down through a CliHistory, and Tab completion of the
+ * command word.
+ *
+ * `batch begin [--quiet]` switches the session to collecting a script: no
+ * echo, no prompts, no history, until `batch end` runs it (Ctrl-C drops it).
+ */
+class CliSession {
+public:
+    static constexpr size_t OUTPUT_CHUNK = 128;  ///< Output flushed to the sink in pieces this big
+
+    /**
+     * @param sink   Output destination
+     * @param prompt Prompt printed after each command, or nullptr for none
+     * @param echo   Echo typed characters back (serial terminals)
+     */
+    CliSession(CliSink sink, const char* prompt, bool echo);
+    ~CliSession();
+
+    // Non-copyable (owns the output stream)
+    CliSession(const CliSession&) = delete;
+    CliSession& operator=(const CliSession&) = delete;
+
+    /**
+     * @brief Push received bytes; executes every complete line
+     */
+    void feed(const char* data, size_t len);
+
+    /**
+     * @brief Execute one line directly (bypasses the line buffer)
+     * @param line NUL-terminated, modified in place
+     * @return Result of Cli::execute()
+     */
+    int execute(char* line);
+
+    /**
+     * @brief Run a multi-line script (see cli_batch.hpp) with output routed here
+     * @param script NUL-terminated, newline-separated; modified in place
+     * @param quiet  Only print the result line
+     * @return 0 if every command succeeded, 1 otherwise
+     */
+    int run_batch(char* script, bool quiet);
+
+    /**
+     * @brief Write straight to this session's output (e.g. banners)
+     */
+    void write(const char* data, size_t len);
+
+    /**
+     * @brief Print the prompt (if any) and flush
+     */
+    void show_prompt();
+
+    /**
+     * @brief Discard any partially typed line
+     */
+    void reset();
+
+private:
+    /// Escape-sequence parser state
+    enum class Esc : uint8_t { NONE, ESC, CSI, SS3 };
+
+    CliSink     m_sink;
+    const char* m_prompt;
+    bool        m_echo;
+    bool        m_discarding;  ///< Current line overflowed; drop until newline
+    bool        m_batching;    ///< Collecting a batch script (see cli_batch.hpp)
+    bool        m_batch_quiet;
+    char        m_last;        ///< Previous byte, to fold CR LF into one line end
+    Esc         m_esc;
+    uint8_t     m_esc_param;   ///< Numeric CSI parameter (e.g. 3 in ESC[3~)
+    size_t      m_len;
+    size_t      m_cursor;      ///< Edit position, 0..m_len
+    int         m_hist_pos;    ///< History entry shown, -1 = the line being typed
+    char        m_line[Cli::LINE_MAX];
+    char        m_chunk[OUTPUT_CHUNK];
+    FILE*       m_out;
+    CliHistory  m_history;
+
+    void end_line();
+    bool batch_line(const char* line);
+    bool echoing() const { return m_echo && !m_batching; }
+    void echo(const char* data, size_t len);
+    void handle_escape(char c);
+    void insert(const char* text, size_t n);
+    void erase_before_cursor();
+    void erase_at_cursor();
+    void move_cursor(size_t pos);
+    void redraw_tail(size_t erased);
+    void replace_line(const char* text, size_t n);
+    void recall(int pos);
+    void complete();
+
+    static ssize_t stream_write(void* cookie, const char* buf, size_t size);
+};
@@ -0,0 +1,121 @@
+/**
+ * @file cli_output_ring.hpp
+ * @brief Lock-free single-producer/single-consumer output ring for CLI transports
+ *
+ * Decouples the task that runs a command from the speed of the link: command
+ * output is copied into the ring and a low-priority drain task pushes it to
+ * the device (UART, USB-Serial-JTAG). A command dumping kilobytes at 115200
+ * baud therefore costs the caller a memcpy per chunk instead of blocking it on
+ * TX for the whole transfer.
+ *
+ * When the ring is full the overflow policy decides: BLOCK (the default)
+ * waits for space up to a timeout and then discards, so long output such as
+ * `help` or `top` arrives complete at link speed; DROP discards the chunk
+ * immediately, for callers that must never wait and can lose output.
+ * Either way the producer's worst-case stall is bounded, and every discarded
+ * byte is counted.
+ *
+ * Example usage:
+ * @code
+ * static uint8_t tx_buf[1024];
+ * static CliOutputRing tx(tx_buf, sizeof(tx_buf));   // CliOverflow::BLOCK by default
+ * tx.start_drain([](void*, const char* d, size_t n) { uart_write_bytes(UART_NUM_0, d, n); },
+ *                nullptr);
+ * tx.write("hello\n", 6);
+ * @endcode
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <cstddef>
+#include <cstdint>
+
+/// What CliOutputRing::write() does when the data does not fit
+enum class CliOverflow : uint8_t {
+    DROP,   ///< Discard the chunk, never wait
+    BLOCK,  ///< Wait for the drain task up to the block timeout, then discard
+};
+
+struct CliOutputRingConfig {
+    CliOverflow policy         = CliOverflow::BLOCK;
+    uint32_t    block_ms       = 100;   ///< BLOCK: longest wait per write() (1 KiB drains in ~90 ms at 115200)
+    UBaseType_t drain_priority = 1;     ///< Keep below every real-time task
+    uint32_t    drain_stack    = 2048;
+};
+
+class CliOutputRing {
+public:
+    struct Stats {
+        uint32_t written;      ///< Bytes accepted
+        uint32_t dropped;      ///< Bytes discarded on overflow
+        uint32_t drop_events;  ///< write() calls that discarded
+        uint32_t block_events; ///< write() calls that had to wait (BLOCK)
+        uint32_t high_water;   ///< Peak fill level in bytes
+    };
+
+    /// Drain destination — may block, it runs on the drain task
+    using DrainFn = void (*)(void* ctx, const char* data, size_t len);
+
+    /**
+     * @param storage Ring memory; size must be a power of two
+     * @param size    Bytes of storage
+     * @param cfg     Overflow policy and drain task settings
+     */
+    CliOutputRing(uint8_t* storage, size_t size,
+                  const CliOutputRingConfig& cfg = CliOutputRingConfig());
+    ~CliOutputRing();
+
+    // Non-copyable (owns the drain task)
+    CliOutputRing(const CliOutputRing&) = delete;
+    CliOutputRing& operator=(const CliOutputRing&) = delete;
+
+    /**
+     * @brief Start the drain task
+     * @return ESP_OK, ESP_ERR_INVALID_STATE if running or storage is invalid,
+     *         ESP_ERR_NO_MEM if the task could not be created
+     */
+    esp_err_t start_drain(DrainFn fn, void* ctx);
+
+    /**
+     * @brief Queue output (producer side — one task at a time)
+     *
+     * All-or-nothing: a chunk is either queued whole or dropped whole, so
+     * output never tears mid-chunk. Chunks larger than the ring are dropped.
+     *
+     * @return true if queued
+     */
+    bool write(const char* data, size_t len);
+
+    /**
+     * @brief Wait until the drain task has emptied the ring
+     * @return true if empty before the timeout
+     */
+    bool flush(TickType_t timeout);
+
+    /// Bytes currently queued
+    size_t used() const;
+
+    Stats stats() const { return m_stats; }
+    void  reset_stats();
+
+private:
+    uint8_t*            m_buf;
+    uint32_t            m_mask;
+    CliOutputRingConfig m_cfg;
+    uint32_t            m_head;     ///< Producer index (free-running)
+    uint32_t            m_tail;     ///< Consumer index (free-running)
+    bool                m_waiting;  ///< Producer is blocked on m_space
+    Stats               m_stats;
+    DrainFn             m_drain;
+    void*               m_drain_ctx;
+    TaskHandle_t        m_task;
+    SemaphoreHandle_t   m_space;
+    StaticSemaphore_t   m_space_buf;
+
+    bool wait_for_space(size_t len);
+    static void drain_task(void* arg);
+};
@@ -0,0 +1,38 @@
+/**
+ * @file cli_sys_commands.hpp
+ * @brief Optional runtime profiling command pack for cli_framework
+ *
+ * Registers:
+ *   top [ms]            per-task CPU usage over a sampling window (default 1000 ms;
+ *                       other sessions keep running during the window)
+ *   heap                free / minimum free / largest block per capability
+ *   stacks              per-task stack high-water marks, tightest first
+ *   timers              active esp_timers (esp_timer_dump)
+ *   nvs-stats [ns]      NVS entry usage, optionally for one namespace
+ *
+ * Task snapshots live in static arrays sized by CLI_SYS_MAX_TASKS, so `top`,
+ * `stacks` and `heap` never allocate and do not perturb the heap they report.
+ * `timers` (esp_timer_dump() callocs its print buffer) and `nvs-stats <ns>`
+ * (nvs_open() allocates a handle entry) make short-lived allocations.
+ * `top` needs CONFIG_FREERTOS_USE_TRACE_FACILITY and
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS; `stacks` needs the former.
+ *
+ * Example usage:
+ * @code
+ * cli_register_system_commands();
+ * @endcode
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <cstddef>
+
+/// Tasks captured per snapshot; extra tasks are counted but not listed
+static constexpr size_t CLI_SYS_MAX_TASKS = 32;
+
+/**
+ * @brief Register top, heap, stacks, timers and nvs-stats
+ * @return Result of Cli::register_table()
+ */
+esp_err_t cli_register_system_commands();
@@ -0,0 +1,144 @@
+/**
+ * @file cli_transport.hpp
+ * @brief Ready-made CLI transports: UART, USB-Serial-JTAG and WebSocket
+ *
+ * Each transport owns its CliSession(s) and a reader; all of them dispatch into
+ * the same Cli command registry, so a command registered once is reachable
+ * from the serial console and from the web UI alike.
+ *
+ * The serial transports queue output in a CliOutputRing drained by a
+ * low-priority task, so a command never waits on the baud rate.
+ *
+ * Example usage:
+ * @code
+ * static CliUartTransport uart_cli(UART_NUM_0);
+ * uart_cli.start();
+ *
+ * // ESP32-C6, after web_server_base_start():
+ * CliWsTransport::start("/ws/cli");
+ * @endcode
+ */
+
+#pragma once
+
+#include "cli_framework.hpp"
+#include "cli_output_ring.hpp"
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "soc/soc_caps.h"
+
+/**
+ * @brief CLI on a UART (the default console on most boards)
+ *
+ * Installs the UART driver if the application has not already done so and
+ * runs a reader task that feeds received bytes into the session. Output goes
+ * through a TX_RING_SIZE-byte ring drained by its own low-priority task; a
+ * full ring makes the command wait for the link (CliOverflow::BLOCK) unless
+ * `tx_cfg` opts into DROP.
+ */
+class CliUartTransport {
+public:
+    static constexpr size_t TX_RING_SIZE = 1024;  ///< Output ring bytes (power of two)
+
+    /**
+     * @param port   UART to use
+     * @param prompt Prompt string (static storage), or nullptr
+     * @param tx_cfg Output ring overflow policy and drain task settings
+     */
+    explicit CliUartTransport(uart_port_t port = UART_NUM_0, const char* prompt = "> ",
+                              const CliOutputRingConfig& tx_cfg = CliOutputRingConfig());
+    ~CliUartTransport();
+
+    // Non-copyable (owns a task and a session)
+    CliUartTransport(const CliUartTransport&) = delete;
+    CliUartTransport& operator=(const CliUartTransport&) = delete;
+
+    /**
+     * @brief Start the reader task
+     * @param stack_size Reader stack; command handlers run on it
+     * @param priority   Reader task priority
+     * @return ESP_OK, ESP_ERR_INVALID_STATE if already running, or a driver error
+     */
+    esp_err_t start(uint32_t stack_size = 4096, UBaseType_t priority = 5);
+
+    /// Output ring, for its overflow counters
+    const CliOutputRing& tx() const { return m_tx; }
+
+private:
+    uart_port_t   m_port;
+    uint8_t       m_tx_buf[TX_RING_SIZE];
+    CliOutputRing m_tx;
+    CliSession    m_session;
+    TaskHandle_t  m_task;
+
+    static void sink_write(void* ctx, const char* data, size_t len);
+    static void tx_drain(void* ctx, const char* data, size_t len);
+    static void reader_task(void* arg);
+};
+
+#if SOC_USB_SERIAL_JTAG_SUPPORTED
+/**
+ * @brief CLI on the built-in USB-Serial-JTAG port (C3/C6/S3 etc.); output as for CliUartTransport
+ */
+class CliUsbJtagTransport {
+public:
+    static constexpr size_t TX_RING_SIZE = 1024;  ///< Output ring bytes (power of two)
+
+    explicit CliUsbJtagTransport(const char* prompt = "> ",
+                                 const CliOutputRingConfig& tx_cfg = CliOutputRingConfig());
+    ~CliUsbJtagTransport();
+
+    // Non-copyable (owns a task and a session)
+    CliUsbJtagTransport(const CliUsbJtagTransport&) = delete;
+    CliUsbJtagTransport& operator=(const CliUsbJtagTransport&) = delete;
+
+    /**
+     * @brief Install the USB-Serial-JTAG driver if needed and start the reader task
+     * @return ESP_OK, ESP_ERR_INVALID_STATE if already running, or a driver error
+     */
+    esp_err_t start(uint32_t stack_size = 4096, UBaseType_t priority = 5);
+
+    /// Output ring, for its overflow counters
+    const CliOutputRing& tx() const { return m_tx; }
+
+private:
+    uint8_t       m_tx_buf[TX_RING_SIZE];
+    CliOutputRing m_tx;
+    CliSession    m_session;
+    TaskHandle_t  m_task;
+
+    static void sink_write(void* ctx, const char* data, size_t len);
+    static void tx_drain(void* ctx, const char* data, size_t len);
+    static void reader_task(void* arg);
+};
+#endif
+
+/**
+ * @brief CLI over a web_server_base WebSocket endpoint (ESP32-C6 only)
+ *
+ * Each text frame received is one command line. The command's output comes
+ * back as one WebSocket message, sent as a series of fragments of at most
+ * CliSession::OUTPUT_CHUNK bytes while the command runs, so a long dump never
+ * has to fit in RAM. A frame containing newlines is run as a batch script
+ * (cli_batch.hpp) and answered with one message ending in the result line.
+ * Up to MAX_CLIENTS browsers can be connected at once; slots of closed
+ * sockets are reclaimed when a new client connects.
+ */
+class CliWsTransport {
+public:
+    static constexpr size_t MAX_CLIENTS = 2;
+
+    CliWsTransport() = delete;
+
+    /**
+     * @brief Register the WebSocket endpoint
+     *
+     * Call after web_server_base_start().
+     *
+     * @param uri Endpoint path (static storage), e.g. "/ws/cli"
+     * @return ESP_OK, ESP_ERR_NOT_SUPPORTED on targets without web_server_base,
+     *         or the web_server_base_register() error
+     */
+    static esp_err_t start(const char* uri = "/ws/cli");
+};
@@ -0,0 +1,347 @@
+/**
+ * @file cli_batch.cpp
+ * @brief Script collection, validation and execution for batch mode
+ */
+
+#include "cli_batch.hpp"
+#include "cli_framework.hpp"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+char        CliBatch::s_script[CliBatch::SCRIPT_MAX] = {};
+size_t      CliBatch::s_script_len = 0;
+bool        CliBatch::s_overflow = false;
+const void* CliBatch::s_owner = nullptr;
+
+static constexpr uint32_t SLEEP_MAX_MS = 60000;
+static constexpr uint32_t REPEAT_MAX   = 10000;
+
+enum class OpKind : uint8_t { COMMAND, REPEAT, END, SLEEP, ON_ERROR };
+
+struct Op {
+    const char* text;   ///< Trimmed source line (commands are copied before execution)
+    uint16_t    line;   ///< 1-based line in the script, for error reports
+    uint16_t    match;  ///< REPEAT: index of its END
+    OpKind      kind;
+    uint32_t    value;  ///< REPEAT count, SLEEP ms, ON_ERROR 1 = continue
+};
+
+struct BatchError {
+    uint16_t op;  ///< Index into s_ops
+    int      rc;
+};
+
+// Batches are serialised by the CLI lock, so one set of tables is enough
+static Op         s_ops[CliBatch::MAX_LINES];
+static BatchError s_errors[CliBatch::MAX_ERRORS];
+
+/* ==== Output ==== */
+
+static ssize_t null_write(void*, const char*, size_t size)
+{
+    return static_cast<ssize_t>(size);
+}
+
+// Sink for --quiet: command output is formatted and thrown away
+static FILE* null_stream()
+{
+    static FILE* stream = [] {
+        cookie_io_functions_t io = {};
+        io.write = null_write;
+        return fopencookie(nullptr, "w", io);
+    }();
+    return stream;
+}
+
+static void print_json_string(const char* s)
+{
+    Cli::write("\"", 1);
+    for (; *s; ++s) {
+        unsigned char c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\') {
+            char esc[2] = { '\\', static_cast<char>(c) };
+            Cli::write(esc, 2);
+        } else if (c < 0x20) {
+            Cli::printf("\\u%04x", c);
+        } else {
+            Cli::write(s, 1);
+        }
+    }
+    Cli::write("\"", 1);
+}
+
+static void print_syntax_error(uint16_t line, const char* reason)
+{
+    Cli::printf("{\"batch\":{\"status\":\"error\",\"line\":%u,\"reason\":\"%s\","
+                "\"executed\":0,\"failed\":0,\"elapsed_ms\":0,\"errors\":[]}}\n",
+                (unsigned)line, reason);
+}
+
+/* ==== Parsing ==== */
+
+static bool parse_u32(const char* s, uint32_t max, uint32_t* out)
+{
+    char* end = nullptr;
+    errno = 0;
+    unsigned long v = strtoul(s, &end, 0);
+    if (*s == '-' || *end != '\0' || errno == ERANGE || v > max) return false;
+    *out = static_cast<uint32_t>(v);
+    return true;
+}
+
+// Classify one trimmed line; returns the error reason or nullptr
+static const char* classify(Op& op)
+{
+    char buf[Cli::LINE_MAX];
+    size_t len = strlen(op.text);
+    if (len >= sizeof(buf)) return "line too long";
+    memcpy(buf, op.text, len + 1);
+
+    char* argv[3];
+    int argc = Cli::tokenize(buf, argv, 3);
+    op.kind = OpKind::COMMAND;
+    op.value = 0;
+    if (argc == Cli::ERR_SYNTAX) return "unterminated quote";
+    if (argc <= 0) return nullptr;  // too many args: an ordinary command
+
+    if (strcmp(argv[0], "repeat") == 0) {
+        op.kind = OpKind::REPEAT;
+        if (argc != 2 || !parse_u32(argv[1], REPEAT_MAX, &op.value)) return "repeat <0..10000>";
+    } else if (strcmp(argv[0], "end") == 0) {
+        op.kind = OpKind::END;
+        if (argc != 1) return "end takes no arguments";
+    } else if (strcmp(argv[0], "sleep") == 0) {
+        op.kind = OpKind::SLEEP;
+        if (argc != 2 || !parse_u32(argv[1], SLEEP_MAX_MS, &op.value)) return "sleep <0..60000>";
+    } else if (strcmp(argv[0], "on-error") == 0) {
+        op.kind = OpKind::ON_ERROR;
+        if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+            op.value = 0;
+        } else if (argc == 2 && strcmp(argv[1], "continue") == 0) {
+            op.value = 1;
+        } else {
+            return "on-error stop|continue";
+        }
+    }
+    return nullptr;
+}
+
+// Split the script into ops and pair repeat/end. Returns the op count, or -1
+// after printing the error result.
+static int compile(char* script)
+{
+    size_t count = 0;
+    uint16_t open[CliBatch::MAX_DEPTH];
+    size_t depth = 0;
+    uint16_t line_no = 0;
+
+    char* p = script;
+    while (*p) {
+        char* line = p;
+        char* nl = strchr(p, '\n');
+        p = nl ? nl + 1 : p + strlen(p);
+        if (nl) *nl = '\0';
+        ++line_no;
+
+        while (*line == ' ' || *line == '\t') ++line;
+        char* end = line + strlen(line);
+        while (end > line && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) --end;
+        *end = '\0';
+        if (*line == '\0' || *line == '#') continue;
+
+        if (count >= CliBatch::MAX_LINES) {
+            print_syntax_error(line_no, "too many lines");
+            return -1;
+        }
+        Op& op = s_ops[count];
+        op.text = line;
+        op.line = line_no;
+        op.match = 0;
+        const char* reason = classify(op);
+        if (reason) {
+            print_syntax_error(line_no, reason);
+            return -1;
+        }
+
+        if (op.kind == OpKind::REPEAT) {
+            if (depth >= CliBatch::MAX_DEPTH) {
+                print_syntax_error(line_no, "repeat nested too deep");
+                return -1;
+            }
+            open[depth++] = static_cast<uint16_t>(count);
+        } else if (op.kind == OpKind::END) {
+            if (depth == 0) {
+                print_syntax_error(line_no, "end without repeat");
+                return -1;
+            }
+            uint16_t start = open[--depth];
+            s_ops[start].match = static_cast<uint16_t>(count);
+            op.match = start;
+        }
+        ++count;
+    }
+
+    if (depth) {
+        print_syntax_error(s_ops[open[depth - 1]].line, "repeat without end");
+        return -1;
+    }
+    return static_cast<int>(count);
+}
+
+/* ==== Execution ==== */
+
+int CliBatch::run(char* script, bool quiet, CliBatchResult* out)
+{
+    CliBatchResult result = { "error", 0, 0, 0 };
+    int count = compile(script);
+    if (count < 0) {
+        if (out) *out = result;
+        return 1;
+    }
+
+    struct Frame {
+        uint16_t start;
+        uint32_t left;
+    } stack[MAX_DEPTH];
+    size_t depth = 0;
+    bool keep_going = false;
+    bool aborted = false;
+    size_t error_count = 0;
+    char buf[Cli::LINE_MAX];
+
+    Cli::s_in_batch = true;
+    FILE* visible = Cli::s_out;
+    FILE* hidden = quiet ? null_stream() : nullptr;
+    const int64_t t0 = esp_timer_get_time();
+
+    size_t pc = 0;
+    while (pc < static_cast<size_t>(count) && !aborted) {
+        const Op& op = s_ops[pc];
+        switch (op.kind) {
+            case OpKind::REPEAT:
+                if (op.value == 0) {
+                    pc = op.match + 1u;
+                    continue;
+                }
+                stack[depth++] = { static_cast<uint16_t>(pc), op.value };
+                break;
+            case OpKind::END:
+                if (--stack[depth - 1].left > 0) {
+                    pc = stack[depth - 1].start + 1u;
+                    continue;
+                }
+                depth--;
+                break;
+            case OpKind::SLEEP:
+                if (op.value) vTaskDelay(pdMS_TO_TICKS(op.value));
+                break;
+            case OpKind::ON_ERROR:
+                keep_going = op.value != 0;
+                break;
+            case OpKind::COMMAND: {
+                // The tokenizer rewrites in place and repeat bodies run again
+                strcpy(buf, op.text);
+                if (hidden) Cli::s_out = hidden;
+                int rc = Cli::execute(buf);
+                if (hidden) {
+                    fflush(hidden);
+                    Cli::s_out = visible;
+                }
+                result.executed++;
+                if (rc != 0) {
+                    result.failed++;
+                    if (error_count < MAX_ERRORS) s_errors[error_count++] = { static_cast<uint16_t>(pc), rc };
+                    aborted = !keep_going;
+                }
+                break;
+            }
+        }
+        ++pc;
+    }
+
+    Cli::s_in_batch = false;
+    result.elapsed_ms = static_cast<uint32_t>((esp_timer_get_time() - t0) / 1000);
+    result.status = aborted ? "aborted" : result.failed ? "failed" : "ok";
+
+    Cli::printf("{\"batch\":{\"status\":\"%s\",\"executed\":%u,\"failed\":%u,"
+                "\"elapsed_ms\":%u,\"errors\":[",
+                result.status, (unsigned)result.executed, (unsigned)result.failed,
+                (unsigned)result.elapsed_ms);
+    for (size_t i = 0; i < error_count; ++i) {
+        const Op& op = s_ops[s_errors[i].op];
+        Cli::printf("%s{\"line\":%u,\"rc\":%d,\"cmd\":", i ? "," : "",
+                    (unsigned)op.line, s_errors[i].rc);
+        print_json_string(op.text);
+        Cli::write("}", 1);
+    }
+    Cli::printf("]}}\n");
+
+    if (out) *out = result;
+    return result.failed ? 1 : 0;
+}
+
+/* ==== Collection (terminal sessions) ==== */
+
+bool CliBatch::begin_collect(const void* owner)
+{
+    Cli::lock();
+    bool ok = !s_owner || s_owner == owner;
+    if (ok) {
+        s_owner = owner;
+        s_script_len = 0;
+        s_script[0] = '\0';
+        s_overflow = false;
+    }
+    Cli::unlock();
+    return ok;
+}
+
+bool CliBatch::append(const void* owner, const char* line, size_t len)
+{
+    if (s_owner != owner || s_overflow) return false;
+    if (s_script_len + len + 2 > SCRIPT_MAX) {
+        s_overflow = true;
+        return false;
+    }
+    memcpy(s_script + s_script_len, line, len);
+    s_script_len += len;
+    s_script[s_script_len++] = '\n';
+    s_script[s_script_len] = '\0';
+    return true;
+}
+
+// Called with the CLI lock held (from CliSession)
+int CliBatch::end_collect(const void* owner, bool quiet)
+{
+    if (s_owner != owner) return 1;
+    int ret = 1;
+    if (s_overflow) {
+        Cli::printf("{\"batch\":{\"status\":\"error\",\"line\":0,\"reason\":\"line or script too long (max %u bytes)\","
+                    "\"executed\":0,\"failed\":0,\"elapsed_ms\":0,\"errors\":[]}}\n",
+                    (unsigned)SCRIPT_MAX);
+    } else {
+        ret = run(s_script, quiet);
+    }
+    s_owner = nullptr;
+    return ret;
+}
+
+void CliBatch::cancel_collect(const void* owner)
+{
+    Cli::lock();
+    if (s_owner == owner) s_owner = nullptr;
+    Cli::unlock();
+}
+
+int CliBatch::cmd_batch(int, char**)
+{
+    Cli::printf("usage: batch begin [--quiet]  ... script lines ...  batch end\n"
+                "  on a terminal session; over WebSocket send the script as one\n"
+                "  multi-line frame. Control lines: repeat <n> / end, sleep <ms>,\n"
+                "  on-error stop|continue, # comment\n");
+    return 1;
+}
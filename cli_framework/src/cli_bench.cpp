@@ -0,0 +1,170 @@
+/**
+ * @file cli_bench.cpp
+ * @brief Benchmark registry, cycle-count runner and `bench` command
+ */
+
+#include "cli_bench.hpp"
+#include "cli_args.hpp"
+#include "cli_framework.hpp"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include <cstdlib>
+#include <cstring>
+
+const CliBenchCase* CliBench::s_benches[CliBench::MAX_BENCHES] = {};
+size_t              CliBench::s_count = 0;
+uint32_t            CliBench::s_samples[CliBench::MAX_ITERATIONS] = {};
+
+esp_err_t CliBench::add(const CliBenchCase& bench)
+{
+    if (!bench.name || !bench.name[0] || strchr(bench.name, ' ') || !bench.run) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < s_count; ++i) {
+        if (strcmp(s_benches[i]->name, bench.name) == 0) return ESP_ERR_INVALID_ARG;
+    }
+    if (s_count >= MAX_BENCHES) return ESP_ERR_NO_MEM;
+    s_benches[s_count++] = &bench;
+    return ESP_OK;
+}
+
+static int compare_u32(const void* a, const void* b)
+{
+    uint32_t x = *static_cast<const uint32_t*>(a);
+    uint32_t y = *static_cast<const uint32_t*>(b);
+    return (x > y) - (x < y);
+}
+
+esp_err_t CliBench::run(const CliBenchCase& bench, uint32_t iterations, uint32_t warmup,
+                        CliBenchResult* out)
+{
+    if (!out) return ESP_ERR_INVALID_ARG;
+    if (iterations == 0) iterations = 1;
+    if (iterations > MAX_ITERATIONS) iterations = MAX_ITERATIONS;
+
+    if (bench.setup) {
+        esp_err_t err = bench.setup(bench.ctx);
+        if (err != ESP_OK) return err;
+    }
+
+    for (uint32_t i = 0; i < warmup; ++i) {
+        bench.run(bench.ctx);
+    }
+
+    // Cycle counter deltas are modulo 2^32, so wrap-around between the two
+    // reads is harmless for anything shorter than ~20 s at 240 MHz
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < iterations; ++i) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        bench.run(bench.ctx);
+        uint32_t dt = esp_cpu_get_cycle_count() - t0;
+        s_samples[i] = dt;
+        sum += dt;
+    }
+
+    if (bench.teardown) {
+        bench.teardown(bench.ctx);
+    }
+
+    qsort(s_samples, iterations, sizeof(s_samples[0]), compare_u32);
+    out->iterations = iterations;
+    out->min    = s_samples[0];
+    out->median = s_samples[iterations / 2];
+    out->p99    = s_samples[(iterations * 99) / 100];
+    out->max    = s_samples[iterations - 1];
+    out->mean   = static_cast<uint32_t>(sum / iterations);
+    return ESP_OK;
+}
+
+static bool name_matches(const char* name, const char* pattern)
+{
+    if (strcmp(pattern, "all") == 0) return true;
+    return strncmp(name, pattern, strlen(pattern)) == 0;
+}
+
+struct BenchArgs {
+    const char* pattern;
+    uint32_t    iterations;
+    uint32_t    warmup;
+    bool        json;
+};
+
+static constexpr auto BENCH_ARGS = cli_args<BenchArgs>("bench",
+    cli_str(&BenchArgs::pattern, "name|prefix|all", nullptr),
+    cli_opt(&BenchArgs::iterations, "-n", 1, CliBench::MAX_ITERATIONS, CliBench::DEFAULT_ITERATIONS),
+    cli_opt(&BenchArgs::warmup, "-w", 0, 10000, CliBench::DEFAULT_WARMUP),
+    cli_flag(&BenchArgs::json, "--json"));
+static_assert(BENCH_ARGS.is_valid(), "bad bench argument spec");
+
+int CliBench::cmd_bench(int argc, char** argv)
+{
+    BenchArgs args;
+    if (!BENCH_ARGS.parse(argc, argv, args)) return 1;
+
+    if (!args.pattern) {
+        if (s_count == 0) {
+            Cli::printf("No benchmarks registered\n");
+        }
+        for (size_t i = 0; i < s_count; ++i) {
+            Cli::printf("  %-14s %s\n", s_benches[i]->name, s_benches[i]->description);
+        }
+        return 0;
+    }
+
+    const char* pattern = args.pattern;
+    const uint32_t iterations = args.iterations;
+    const uint32_t warmup = args.warmup;
+    const bool json = args.json;
+
+    const uint32_t mhz = esp_rom_get_cpu_ticks_per_us();
+    if (!json) {
+        Cli::printf("%-14s %6s %10s %10s %10s %10s %9s\n",
+                    "bench", "n", "min", "median", "p99", "max", "median_us");
+    }
+
+    int ran = 0;
+    int failed = 0;
+    for (size_t i = 0; i < s_count; ++i) {
+        const CliBenchCase& b = *s_benches[i];
+        if (!name_matches(b.name, pattern)) continue;
+        ran++;
+
+        CliBenchResult r;
+        esp_err_t err = run(b, iterations, warmup, &r);
+        if (err != ESP_OK) {
+            failed++;
+            if (json) {
+                Cli::printf("{\"bench\":\"%s\",\"error\":\"%s\"}\n", b.name, esp_err_to_name(err));
+            } else {
+                Cli::printf("%-14s setup failed: %s\n", b.name, esp_err_to_name(err));
+            }
+            continue;
+        }
+
+        if (json) {
+            Cli::printf("{\"bench\":\"%s\",\"n\":%u,\"warmup\":%u,\"cpu_mhz\":%u,"
+                        "\"min\":%u,\"median\":%u,\"p99\":%u,\"max\":%u,\"mean\":%u}\n",
+                        b.name, (unsigned)r.iterations, (unsigned)warmup, (unsigned)mhz,
+                        (unsigned)r.min, (unsigned)r.median, (unsigned)r.p99,
+                        (unsigned)r.max, (unsigned)r.mean);
+        } else {
+            Cli::printf("%-14s %6u %10u %10u %10u %10u %9.2f\n", b.name,
+                        (unsigned)r.iterations, (unsigned)r.min, (unsigned)r.median,
+                        (unsigned)r.p99, (unsigned)r.max,
+                        mhz ? (double)r.median / mhz : 0.0);
+        }
+    }
+
+    if (ran == 0) {
+        Cli::printf("No benchmark matches '%s'\n", pattern);
+        return 1;
+    }
+    return failed ? 1 : 0;
+}
+
+esp_err_t CliBench::register_command()
+{
+    return Cli::register_command("bench",
+                                 "bench [name|prefix|all] [-n N] [-w W] [--json] - cycle-count benchmarks",
+                                 cmd_bench);
+}
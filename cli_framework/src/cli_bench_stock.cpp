@@ -0,0 +1,88 @@
+/**
+ * @file cli_bench_stock.cpp
+ * @brief Stock benchmarks: NvsStore save/load and JSON response serialisation
+ */
+
+#include "cli_bench.hpp"
+#include "cJSON.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs_helpers.hpp"
+#include <cstdlib>
+
+static constexpr const char* BENCH_NAMESPACE = "cli_bench";
+static constexpr const char* BENCH_KEY       = "bench_u32";
+
+static NvsStore& bench_store()
+{
+    static NvsStore store(BENCH_NAMESPACE);
+    return store;
+}
+
+/* ================================================================== */
+/*  NVS                                                                */
+/* ================================================================== */
+
+static uint32_t s_nvs_counter = 0;
+
+static void run_nvs_save(void*)
+{
+    bench_store().save(BENCH_KEY, s_nvs_counter++);
+}
+
+static esp_err_t setup_nvs_load(void*)
+{
+    return bench_store().save(BENCH_KEY, static_cast<uint32_t>(0x5A5A5A5A));
+}
+
+static void run_nvs_load(void*)
+{
+    uint32_t v = 0;
+    bench_store().load(BENCH_KEY, v);
+}
+
+static void teardown_nvs(void*)
+{
+    bench_store().erase(BENCH_KEY);
+}
+
+/* ================================================================== */
+/*  JSON — same shape and calls as web_server_base's /api/status reply  */
+/* ================================================================== */
+
+static void run_json_status(void*)
+{
+    cJSON* root = cJSON_CreateObject();
+    if (!root) return;
+    cJSON_AddStringToObject(root, "firmware",   "v0.0.0");
+    cJSON_AddNumberToObject(root, "uptime_sec", (double)(int64_t)(esp_timer_get_time() / 1000000LL));
+    cJSON_AddNumberToObject(root, "free_heap",  (double)esp_get_free_heap_size());
+    cJSON_AddStringToObject(root, "wifi",       "connected");
+    cJSON_AddStringToObject(root, "ssid",       "bench-network");
+    cJSON_AddStringToObject(root, "hostname",   "bench-a1b2c3");
+    cJSON_AddStringToObject(root, "ip",         "192.168.100.200");
+    cJSON_AddNumberToObject(root, "rssi",       -61);
+    cJSON_AddBoolToObject(root,   "zb_joined",  true);
+
+    char* str = cJSON_PrintUnformatted(root);
+    free(str);
+    cJSON_Delete(root);
+}
+
+static const CliBenchCase STOCK_BENCHES[] = {
+    { "nvs-save",    "NvsStore::save<uint32_t> (open/set/commit/close)",
+      nullptr, run_nvs_save, teardown_nvs, nullptr },
+    { "nvs-load",    "NvsStore::load<uint32_t> (open/get/close)",
+      setup_nvs_load, run_nvs_load, teardown_nvs, nullptr },
+    { "json-status", "cJSON build + PrintUnformatted + free of a /api/status reply",
+      nullptr, run_json_status, nullptr, nullptr },
+};
+
+esp_err_t cli_bench_add_stock()
+{
+    for (const CliBenchCase& b : STOCK_BENCHES) {
+        esp_err_t err = CliBench::add(b);
+        if (err != ESP_OK) return err;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,386 @@
+/**
+ * @file cli_framework.cpp
+ * @brief Command registry, in-place tokenizer and binary-search dispatch
+ */
+
+#include "cli_framework.hpp"
+#include "cli_batch.hpp"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+static const char* TAG = "Cli";
+
+static int cmd_help(int argc, char** argv);
+
+static constexpr CliCommand BUILTIN_COMMANDS[] = {
+    { "batch", "batch begin [--quiet] ... batch end - run a script", CliBatch::cmd_batch },
+    { "help", "help [command] - list commands or describe one", cmd_help },
+};
+static constexpr size_t BUILTIN_COUNT = sizeof(BUILTIN_COMMANDS) / sizeof(BUILTIN_COMMANDS[0]);
+
+// Slot 0 always holds the builtins
+Cli::TableRef Cli::s_tables[Cli::MAX_TABLES] = { { BUILTIN_COMMANDS, BUILTIN_COUNT, nullptr } };
+size_t        Cli::s_table_count = 1;
+CliCommand    Cli::s_dynamic[Cli::MAX_DYNAMIC_COMMANDS] = {};
+size_t        Cli::s_dynamic_count = 0;
+FILE*         Cli::s_out = nullptr;
+bool          Cli::s_in_batch = false;
+
+// Serialises command execution across sessions (one command runs at a time).
+// Function-local static: C++ guarantees one-time, thread-safe creation.
+static SemaphoreHandle_t exec_lock()
+{
+    static StaticSemaphore_t buf;
+    static SemaphoreHandle_t lock = xSemaphoreCreateMutexStatic(&buf);
+    return lock;
+}
+
+void Cli::lock()
+{
+    xSemaphoreTake(exec_lock(), portMAX_DELAY);
+}
+
+void Cli::unlock()
+{
+    xSemaphoreGive(exec_lock());
+}
+
+void Cli::wait(uint32_t ms)
+{
+    // Cli::execute() may also be called directly, without the lock
+    bool held = xSemaphoreGetMutexHolder(exec_lock()) == xTaskGetCurrentTaskHandle();
+    if (!held || s_in_batch) {
+        vTaskDelay(pdMS_TO_TICKS(ms));
+        return;
+    }
+    FILE* out = s_out;
+    unlock();
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    lock();
+    s_out = out;
+}
+
+const CliCommand* Cli::search(const CliCommand* cmds, size_t count, const char* name)
+{
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int c = strcmp(cmds[mid].name, name);
+        if (c == 0) return &cmds[mid];
+        if (c < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return nullptr;
+}
+
+const CliCommand* Cli::find(const char* name)
+{
+    for (size_t t = 0; t < s_table_count; ++t) {
+        const CliCommand* c = search(s_tables[t].cmds, s_tables[t].count, name);
+        if (c) return c;
+    }
+    return search(s_dynamic, s_dynamic_count, name);
+}
+
+esp_err_t Cli::register_table(const CliCommand* cmds, size_t count, const CliTrieNode* trie)
+{
+    if (!cmds || count == 0) return ESP_ERR_INVALID_ARG;
+    if (s_table_count >= MAX_TABLES) {
+        ESP_LOGE(TAG, "No free table slot (max %u)", (unsigned)MAX_TABLES);
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!cmds[i].name || !cmds[i].name[0] || !cmds[i].handler) {
+            ESP_LOGE(TAG, "Table entry %u is incomplete", (unsigned)i);
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (i > 0 && strcmp(cmds[i - 1].name, cmds[i].name) >= 0) {
+            ESP_LOGE(TAG, "Table not sorted/unique at '%s'", cmds[i].name);
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (find(cmds[i].name)) {
+            ESP_LOGE(TAG, "Command '%s' already registered", cmds[i].name);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    s_tables[s_table_count++] = { cmds, count, trie };
+    ESP_LOGD(TAG, "Registered table of %u commands", (unsigned)count);
+    return ESP_OK;
+}
+
+esp_err_t Cli::register_command(const char* name, const char* description, CliHandler handler)
+{
+    if (!name || !name[0] || strchr(name, ' ') || !handler) return ESP_ERR_INVALID_ARG;
+    if (find(name)) {
+        ESP_LOGE(TAG, "Command '%s' already registered", name);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_dynamic_count >= MAX_DYNAMIC_COMMANDS) {
+        ESP_LOGE(TAG, "Command capacity reached (max %u)", (unsigned)MAX_DYNAMIC_COMMANDS);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Keep the array sorted so find() can binary search it
+    size_t pos = s_dynamic_count;
+    while (pos > 0 && strcmp(s_dynamic[pos - 1].name, name) > 0) {
+        s_dynamic[pos] = s_dynamic[pos - 1];
+        --pos;
+    }
+    s_dynamic[pos] = { name, description ? description : "", handler };
+    s_dynamic_count++;
+    return ESP_OK;
+}
+
+int Cli::tokenize(char* line, char** argv, size_t max_args)
+{
+    int argc = 0;
+    char* rd = line;
+    char* wr = line;
+
+    while (true) {
+        while (*rd == ' ' || *rd == '\t' || *rd == '\r' || *rd == '\n') ++rd;
+        if (*rd == '\0') break;
+
+        if (static_cast<size_t>(argc) >= max_args) return ERR_TOO_MANY_ARGS;
+        argv[argc++] = wr;
+
+        // Copy one token, compacting quotes/escapes out of it; wr never overtakes rd
+        char quote = '\0';
+        while (*rd) {
+            char c = *rd;
+            if (quote == '\'') {
+                if (c == '\'') {
+                    quote = '\0';
+                } else {
+                    *wr++ = c;
+                }
+                ++rd;
+            } else if (quote == '"') {
+                if (c == '"') {
+                    quote = '\0';
+                } else if (c == '\\' && (rd[1] == '"' || rd[1] == '\\')) {
+                    *wr++ = rd[1];
+                    ++rd;
+                } else {
+                    *wr++ = c;
+                }
+                ++rd;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+                ++rd;
+            } else if (c == '\\') {
+                if (rd[1] == '\0') return ERR_SYNTAX;
+                *wr++ = rd[1];
+                rd += 2;
+            } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                ++rd;
+                break;
+            } else {
+                *wr++ = c;
+                ++rd;
+            }
+        }
+        if (quote) return ERR_SYNTAX;
+        *wr++ = '\0';
+    }
+    return argc;
+}
+
+int Cli::execute(char* line)
+{
+    char* argv[MAX_ARGS];
+    int argc = tokenize(line, argv, MAX_ARGS);
+    if (argc == ERR_SYNTAX) {
+        printf("error: unterminated quote or escape\n");
+        return argc;
+    }
+    if (argc == ERR_TOO_MANY_ARGS) {
+        printf("error: too many arguments (max %u)\n", (unsigned)MAX_ARGS);
+        return argc;
+    }
+    if (argc == 0) return 0;
+
+    const CliCommand* cmd = find(argv[0]);
+    if (!cmd) {
+        printf("Unknown command '%s' - try 'help'\n", argv[0]);
+        return ERR_NOT_FOUND;
+    }
+    return cmd->handler(argc, argv);
+}
+
+int Cli::printf(const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vfprintf(out(), fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+void Cli::write(const char* data, size_t len)
+{
+    fwrite(data, 1, len, out());
+}
+
+FILE* Cli::out()
+{
+    return s_out ? s_out : stdout;
+}
+
+void Cli::for_each(void (*fn)(const CliCommand& cmd, void* ctx), void* ctx)
+{
+    // k-way merge of the sorted tables (plus the dynamic array) by name
+    size_t pos[MAX_TABLES + 1] = {};
+    while (true) {
+        const CliCommand* best = nullptr;
+        size_t best_src = 0;
+        for (size_t t = 0; t <= s_table_count; ++t) {
+            const CliCommand* cmds = (t < s_table_count) ? s_tables[t].cmds : s_dynamic;
+            size_t count = (t < s_table_count) ? s_tables[t].count : s_dynamic_count;
+            if (pos[t] < count && (!best || strcmp(cmds[pos[t]].name, best->name) < 0)) {
+                best = &cmds[pos[t]];
+                best_src = t;
+            }
+        }
+        if (!best) break;
+        pos[best_src]++;
+        fn(*best, ctx);
+    }
+}
+
+size_t Cli::complete_scan(const CliCommand* cmds, size_t count, const char* prefix, size_t len,
+                          void (*fn)(const CliCommand& cmd, void* ctx), void* ctx)
+{
+    // Lower bound of the prefix, then walk forward while it still matches
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strncmp(cmds[mid].name, prefix, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    size_t n = 0;
+    for (size_t i = lo; i < count && strncmp(cmds[i].name, prefix, len) == 0; ++i, ++n) {
+        fn(cmds[i], ctx);
+    }
+    return n;
+}
+
+// Pre-order walk of a subtree: visits commands in name order
+static size_t trie_visit(const CliCommand* cmds, const CliTrieNode* trie, uint16_t node,
+                         void (*fn)(const CliCommand& cmd, void* ctx), void* ctx)
+{
+    size_t n = 0;
+    if (trie[node].cmd != CliTrieNode::NO_CMD) {
+        fn(cmds[trie[node].cmd], ctx);
+        n++;
+    }
+    for (uint16_t c = trie[node].child; c; c = trie[c].sibling) {
+        n += trie_visit(cmds, trie, c, fn, ctx);
+    }
+    return n;
+}
+
+size_t Cli::complete_trie(const CliCommand* cmds, const CliTrieNode* trie,
+                          const char* prefix, size_t len,
+                          void (*fn)(const CliCommand& cmd, void* ctx), void* ctx)
+{
+    uint16_t node = 0;
+    for (size_t i = 0; i < len; ++i) {
+        uint16_t c = trie[node].child;
+        while (c && trie[c].ch != prefix[i]) c = trie[c].sibling;
+        if (!c) return 0;
+        node = c;
+    }
+    return trie_visit(cmds, trie, node, fn, ctx);
+}
+
+size_t Cli::complete(const char* prefix, size_t len,
+                     void (*fn)(const CliCommand& cmd, void* ctx), void* ctx)
+{
+    size_t n = 0;
+    for (size_t t = 0; t < s_table_count; ++t) {
+        const TableRef& ref = s_tables[t];
+        n += ref.trie ? complete_trie(ref.cmds, ref.trie, prefix, len, fn, ctx)
+                      : complete_scan(ref.cmds, ref.count, prefix, len, fn, ctx);
+    }
+    return n + complete_scan(s_dynamic, s_dynamic_count, prefix, len, fn, ctx);
+}
+
+uint32_t CliHistory::entry_start(uint32_t end) const
+{
+    // end points one past an entry's NUL; scan back to the previous NUL
+    uint32_t pos = end - 1;
+    while (pos != m_tail && at(pos - 1) != '\0') --pos;
+    return pos;
+}
+
+void CliHistory::add(const char* line, size_t len)
+{
+    if (len == 0 || len + 1 > BYTES) return;
+
+    char newest[Cli::LINE_MAX];
+    int newest_len = get(0, newest, sizeof(newest));
+    if (newest_len == static_cast<int>(len) && memcmp(newest, line, len) == 0) return;
+
+    // Evict oldest entries until the new one (plus NUL) fits
+    while (m_count > 0 && (m_head - m_tail) + len + 1 > BYTES) {
+        while (at(m_tail) != '\0') ++m_tail;
+        ++m_tail;
+        --m_count;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        m_buf[m_head++ % BYTES] = line[i];
+    }
+    m_buf[m_head++ % BYTES] = '\0';
+    ++m_count;
+}
+
+int CliHistory::get(size_t age, char* out, size_t cap) const
+{
+    if (age >= m_count) return -1;
+    uint32_t end = m_head;
+    uint32_t start = entry_start(end);
+    for (size_t i = 0; i < age; ++i) {
+        end = start;
+        start = entry_start(end);
+    }
+    size_t len = end - 1 - start;
+    if (len + 1 > cap) return -1;
+    for (size_t i = 0; i < len; ++i) {
+        out[i] = at(start + i);
+    }
+    out[len] = '\0';
+    return static_cast<int>(len);
+}
+
+static int cmd_help(int argc, char** argv)
+{
+    if (argc > 1) {
+        const CliCommand* cmd = Cli::find(argv[1]);
+        if (!cmd) {
+            Cli::printf("Unknown command '%s'\n", argv[1]);
+            return 1;
+        }
+        Cli::printf("%s - %s\n", cmd->name, cmd->description);
+        return 0;
+    }
+    Cli::for_each([](const CliCommand& cmd, void*) {
+        Cli::printf("  %-14s %s\n", cmd.name, cmd.description);
+    }, nullptr);
+    return 0;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file cli_output_ring.cpp
+ * @brief SPSC output ring with a low-priority drain task
+ *
+ * The producer only ever advances m_head and the drain task only m_tail, so
+ * neither side takes a lock; acquire/release ordering on the indices publishes
+ * the bytes between them.
+ */
+
+#include "cli_output_ring.hpp"
+#include "esp_log.h"
+#include <cstring>
+
+static const char* TAG = "CliOutRing";
+
+CliOutputRing::CliOutputRing(uint8_t* storage, size_t size, const CliOutputRingConfig& cfg)
+    : m_buf(storage)
+    , m_mask(0)
+    , m_cfg(cfg)
+    , m_head(0)
+    , m_tail(0)
+    , m_waiting(false)
+    , m_stats{}
+    , m_drain(nullptr)
+    , m_drain_ctx(nullptr)
+    , m_task(nullptr)
+    , m_space(nullptr)
+{
+    if (!storage || size < 2 || (size & (size - 1)) != 0) {
+        ESP_LOGE(TAG, "Ring size %u is not a power of two", (unsigned)size);
+        m_buf = nullptr;
+        return;
+    }
+    m_mask = static_cast<uint32_t>(size - 1);
+    m_space = xSemaphoreCreateBinaryStatic(&m_space_buf);
+}
+
+CliOutputRing::~CliOutputRing()
+{
+    if (m_task) {
+        vTaskDelete(m_task);
+    }
+}
+
+esp_err_t CliOutputRing::start_drain(DrainFn fn, void* ctx)
+{
+    if (m_task || !m_buf || !fn) return ESP_ERR_INVALID_STATE;
+    m_drain = fn;
+    m_drain_ctx = ctx;
+    if (xTaskCreate(drain_task, "cli_tx", m_cfg.drain_stack, this,
+                    m_cfg.drain_priority, &m_task) != pdPASS) {
+        m_task = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+    // Anything queued before the task existed
+    xTaskNotifyGive(m_task);
+    return ESP_OK;
+}
+
+size_t CliOutputRing::used() const
+{
+    uint32_t head = __atomic_load_n(&m_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE);
+    return head - tail;
+}
+
+bool CliOutputRing::wait_for_space(size_t len)
+{
+    const size_t size = m_mask + 1;
+    const TickType_t limit = pdMS_TO_TICKS(m_cfg.block_ms);
+    const TickType_t start = xTaskGetTickCount();
+    m_stats.block_events++;
+
+    while (true) {
+        // Publish "waiting" before re-checking, so a concurrent consume() either
+        // sees the flag and signals, or its new tail is seen here
+        __atomic_store_n(&m_waiting, true, __ATOMIC_SEQ_CST);
+        if (size - used() >= len) break;
+
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= limit) {
+            __atomic_store_n(&m_waiting, false, __ATOMIC_SEQ_CST);
+            return false;
+        }
+        xSemaphoreTake(m_space, limit - elapsed);
+    }
+    __atomic_store_n(&m_waiting, false, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+bool CliOutputRing::write(const char* data, size_t len)
+{
+    if (len == 0) return true;
+    const size_t size = m_mask + 1;
+
+    bool fits = m_buf && len <= size;
+    if (fits && size - used() < len) {
+        // Blocking is only meaningful once a drain task exists to make room
+        fits = m_cfg.policy == CliOverflow::BLOCK && m_task && wait_for_space(len);
+    }
+    if (!fits) {
+        m_stats.dropped += len;
+        m_stats.drop_events++;
+        return false;
+    }
+
+    uint32_t head = m_head;
+    size_t off   = head & m_mask;
+    size_t first = size - off;
+    if (first > len) first = len;
+    memcpy(m_buf + off, data, first);
+    memcpy(m_buf, data + first, len - first);
+    __atomic_store_n(&m_head, head + static_cast<uint32_t>(len), __ATOMIC_RELEASE);
+
+    m_stats.written += len;
+    uint32_t fill = static_cast<uint32_t>(used());
+    if (fill > m_stats.high_water) m_stats.high_water = fill;
+
+    if (m_task) xTaskNotifyGive(m_task);
+    return true;
+}
+
+bool CliOutputRing::flush(TickType_t timeout)
+{
+    const TickType_t start = xTaskGetTickCount();
+    while (used() > 0) {
+        if (!m_task || xTaskGetTickCount() - start >= timeout) return false;
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+void CliOutputRing::reset_stats()
+{
+    m_stats = {};
+}
+
+void CliOutputRing::drain_task(void* arg)
+{
+    auto* self = static_cast<CliOutputRing*>(arg);
+    const size_t size = self->m_mask + 1;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (true) {
+            uint32_t head = __atomic_load_n(&self->m_head, __ATOMIC_ACQUIRE);
+            uint32_t tail = self->m_tail;
+            if (head == tail) break;
+
+            // Hand out the contiguous run up to the wrap point
+            size_t off = tail & self->m_mask;
+            size_t n   = head - tail;
+            if (n > size - off) n = size - off;
+            self->m_drain(self->m_drain_ctx, reinterpret_cast<const char*>(self->m_buf + off), n);
+
+            __atomic_store_n(&self->m_tail, tail + static_cast<uint32_t>(n), __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&self->m_waiting, __ATOMIC_SEQ_CST)) {
+                xSemaphoreGive(self->m_space);
+            }
+        }
+    }
+}
@@ -0,0 +1,405 @@
+/**
+ * @file cli_session.cpp
+ * @brief Line assembly and chunked output routing for one CLI connection
+ */
+
+#include "cli_framework.hpp"
+#include "cli_batch.hpp"
+#include "esp_log.h"
+#include <cstring>
+
+static const char* TAG = "CliSession";
+
+CliSession::CliSession(CliSink sink, const char* prompt, bool echo)
+    : m_sink(sink)
+    , m_prompt(prompt)
+    , m_echo(echo)
+    , m_discarding(false)
+    , m_batching(false)
+    , m_batch_quiet(false)
+    , m_last('\0')
+    , m_esc(Esc::NONE)
+    , m_esc_param(0)
+    , m_len(0)
+    , m_cursor(0)
+    , m_hist_pos(-1)
+    , m_out(nullptr)
+{
+    // A FILE* over the sink lets Cli::printf/vfprintf and FILE*-based IDF dump
+    // APIs write here; full buffering on m_chunk turns that into sink writes of
+    // at most OUTPUT_CHUNK bytes, however much a command prints.
+    cookie_io_functions_t io = {};
+    io.write = stream_write;
+    m_out = fopencookie(this, "w", io);
+    if (m_out) {
+        setvbuf(m_out, m_chunk, _IOFBF, sizeof(m_chunk));
+    } else {
+        ESP_LOGE(TAG, "Failed to open output stream");
+    }
+}
+
+CliSession::~CliSession()
+{
+    if (m_batching) {
+        CliBatch::cancel_collect(this);
+    }
+    if (m_out) {
+        fclose(m_out);
+    }
+}
+
+ssize_t CliSession::stream_write(void* cookie, const char* buf, size_t size)
+{
+    auto* self = static_cast<CliSession*>(cookie);
+    // stdio hands over whole buffers; honour the chunk contract for direct writes too
+    size_t done = 0;
+    while (done < size) {
+        size_t n = size - done;
+        if (n > OUTPUT_CHUNK) n = OUTPUT_CHUNK;
+        self->m_sink.write(self->m_sink.ctx, buf + done, n);
+        done += n;
+    }
+    return static_cast<ssize_t>(size);
+}
+
+void CliSession::write(const char* data, size_t len)
+{
+    if (!m_out) return;
+    fwrite(data, 1, len, m_out);
+    fflush(m_out);
+}
+
+void CliSession::show_prompt()
+{
+    if (m_prompt) {
+        write(m_prompt, strlen(m_prompt));
+    }
+}
+
+void CliSession::reset()
+{
+    m_len = 0;
+    m_cursor = 0;
+    m_hist_pos = -1;
+    m_esc = Esc::NONE;
+    m_discarding = false;
+}
+
+int CliSession::execute(char* line)
+{
+    if (!m_out) return Cli::execute(line);
+
+    Cli::lock();
+    FILE* prev = Cli::s_out;
+    Cli::s_out = m_out;
+    int ret = Cli::execute(line);
+    fflush(m_out);
+    Cli::s_out = prev;
+    Cli::unlock();
+    return ret;
+}
+
+int CliSession::run_batch(char* script, bool quiet)
+{
+    FILE* prev = nullptr;
+    Cli::lock();
+    if (m_out) {
+        prev = Cli::s_out;
+        Cli::s_out = m_out;
+    }
+    int ret = script ? CliBatch::run(script, quiet) : CliBatch::end_collect(this, quiet);
+    if (m_out) {
+        fflush(m_out);
+        Cli::s_out = prev;
+    }
+    Cli::unlock();
+    return ret;
+}
+
+void CliSession::echo(const char* data, size_t len)
+{
+    if (echoing()) {
+        write(data, len);
+    }
+}
+
+// Reprint from the cursor to the end of the line, blank out `erased` stale
+// characters beyond it, and put the terminal cursor back at m_cursor
+void CliSession::redraw_tail(size_t erased)
+{
+    if (!echoing()) return;
+    char seq[16];
+    fwrite(m_line + m_cursor, 1, m_len - m_cursor, m_out);
+    for (size_t i = 0; i < erased; ++i) fputc(' ', m_out);
+    size_t back = m_len - m_cursor + erased;
+    if (back) {
+        int n = snprintf(seq, sizeof(seq), "\x1b[%uD", (unsigned)back);
+        fwrite(seq, 1, n, m_out);
+    }
+    fflush(m_out);
+}
+
+void CliSession::move_cursor(size_t pos)
+{
+    if (pos > m_len || pos == m_cursor) return;
+    char seq[16];
+    int n = (pos < m_cursor) ? snprintf(seq, sizeof(seq), "\x1b[%uD", (unsigned)(m_cursor - pos))
+                             : snprintf(seq, sizeof(seq), "\x1b[%uC", (unsigned)(pos - m_cursor));
+    m_cursor = pos;
+    echo(seq, n);
+}
+
+void CliSession::insert(const char* text, size_t n)
+{
+    if (m_discarding) return;
+    if (m_len + n + 1 > sizeof(m_line)) {
+        m_discarding = true;
+        return;
+    }
+    memmove(m_line + m_cursor + n, m_line + m_cursor, m_len - m_cursor);
+    memcpy(m_line + m_cursor, text, n);
+    m_len += n;
+    m_cursor += n;
+    echo(text, n);
+    if (m_cursor < m_len) redraw_tail(0);  // mid-line: shift the rest along
+}
+
+void CliSession::erase_before_cursor()
+{
+    if (m_cursor == 0 || m_discarding) return;
+    memmove(m_line + m_cursor - 1, m_line + m_cursor, m_len - m_cursor);
+    m_cursor--;
+    m_len--;
+    echo("\b", 1);
+    redraw_tail(1);
+}
+
+void CliSession::erase_at_cursor()
+{
+    if (m_cursor == m_len || m_discarding) return;
+    memmove(m_line + m_cursor, m_line + m_cursor + 1, m_len - m_cursor - 1);
+    m_len--;
+    redraw_tail(1);
+}
+
+void CliSession::replace_line(const char* text, size_t n)
+{
+    if (n + 1 > sizeof(m_line)) n = sizeof(m_line) - 1;
+    memmove(m_line, text, n);
+    m_len = n;
+    m_cursor = n;
+    m_discarding = false;
+    if (!echoing()) return;
+    echo("\r", 1);
+    if (m_prompt) echo(m_prompt, strlen(m_prompt));
+    echo(m_line, m_len);
+    echo("\x1b[K", 3);
+}
+
+void CliSession::recall(int pos)
+{
+    if (pos < -1 || pos >= static_cast<int>(m_history.count())) return;
+    m_hist_pos = pos;
+    if (pos < 0) {
+        replace_line("", 0);
+        return;
+    }
+    char entry[Cli::LINE_MAX];
+    int n = m_history.get(static_cast<size_t>(pos), entry, sizeof(entry));
+    if (n >= 0) replace_line(entry, static_cast<size_t>(n));
+}
+
+// Completes the command word only, and only with the cursor at the end
+void CliSession::complete()
+{
+    if (m_cursor != m_len || m_discarding) return;
+    for (size_t i = 0; i < m_len; ++i) {
+        if (m_line[i] == ' ') return;
+    }
+
+    struct Match {
+        const char* first;
+        size_t      common;  ///< Length shared by every candidate so far
+        size_t      count;
+    } match = { nullptr, 0, 0 };
+
+    Cli::complete(m_line, m_len, [](const CliCommand& cmd, void* ctx) {
+        auto* m = static_cast<Match*>(ctx);
+        if (m->count++ == 0) {
+            m->first = cmd.name;
+            m->common = strlen(cmd.name);
+        } else {
+            size_t k = 0;
+            while (k < m->common && m->first[k] == cmd.name[k]) ++k;
+            m->common = k;
+        }
+    }, &match);
+
+    if (match.count == 0) {
+        echo("\a", 1);
+        return;
+    }
+    if (match.common > m_len) {
+        insert(match.first + m_len, match.common - m_len);
+        if (match.count == 1) insert(" ", 1);
+        return;
+    }
+
+    // Ambiguous with nothing left to add: list the candidates, restore the line
+    echo("\r\n", 2);
+    Cli::complete(m_line, m_len, [](const CliCommand& cmd, void* ctx) {
+        fprintf(static_cast<FILE*>(ctx), "%s  ", cmd.name);
+    }, m_out);
+    echo("\r\n", 2);
+    replace_line(m_line, m_len);
+}
+
+// Handles `batch begin [--quiet]` / `batch end`; true if the line was one of them
+bool CliSession::batch_line(const char* line)
+{
+    char buf[Cli::LINE_MAX];
+    strcpy(buf, line);
+    char* argv[4];
+    int argc = Cli::tokenize(buf, argv, 4);
+    if (argc < 2 || strcmp(argv[0], "batch") != 0) return false;
+
+    if (m_batching) {
+        if (argc != 2 || strcmp(argv[1], "end") != 0) return false;
+        m_batching = false;
+        run_batch(nullptr, m_batch_quiet);
+        return true;
+    }
+
+    if (strcmp(argv[1], "begin") != 0) return false;
+    bool quiet = argc == 3 && strcmp(argv[2], "--quiet") == 0;
+    if (argc > 3 || (argc == 3 && !quiet)) return false;  // let `batch` print its usage
+    if (!CliBatch::begin_collect(this)) {
+        static const char msg[] = "error: another session is collecting a batch\n";
+        write(msg, sizeof(msg) - 1);
+        return true;
+    }
+    m_batching = true;
+    m_batch_quiet = quiet;
+    return true;
+}
+
+void CliSession::end_line()
+{
+    echo("\r\n", 2);
+    m_line[m_len] = '\0';
+    if (m_batching) {
+        // Collecting: no echo, history or prompt until `batch end`
+        if (m_discarding) {
+            // A truncated line would run as something else: spoil the script
+            CliBatch::append(this, m_line, CliBatch::SCRIPT_MAX);
+        } else if (!batch_line(m_line)) {
+            CliBatch::append(this, m_line, m_len);
+        }
+        reset();
+        if (!m_batching) show_prompt();
+        return;
+    }
+
+    if (m_discarding) {
+        static const char msg[] = "error: line too long\n";
+        write(msg, sizeof(msg) - 1);
+    } else if (batch_line(m_line)) {
+        reset();
+        if (!m_batching) show_prompt();
+        return;
+    } else {
+        // Record before executing: the tokenizer rewrites the buffer in place
+        m_history.add(m_line, m_len);
+        execute(m_line);
+    }
+    reset();
+    show_prompt();
+}
+
+void CliSession::handle_escape(char c)
+{
+    if (m_esc == Esc::ESC) {
+        m_esc = (c == '[') ? Esc::CSI : (c == 'O') ? Esc::SS3 : Esc::NONE;
+        m_esc_param = 0;
+        return;
+    }
+    if (m_esc == Esc::CSI && c >= '0' && c <= '9') {
+        m_esc_param = static_cast<uint8_t>(m_esc_param * 10 + (c - '0'));
+        return;
+    }
+    if (m_esc == Esc::CSI && c == ';') return;
+
+    m_esc = Esc::NONE;
+    switch (c) {
+        case 'A': recall(m_hist_pos + 1); break;
+        case 'B': recall(m_hist_pos - 1); break;
+        case 'C': move_cursor(m_cursor + 1); break;
+        case 'D': if (m_cursor > 0) move_cursor(m_cursor - 1); break;
+        case 'H': move_cursor(0); break;
+        case 'F': move_cursor(m_len); break;
+        case '~':
+            // VT220 keys: 1/7 Home, 4/8 End, 3 Delete
+            if (m_esc_param == 1 || m_esc_param == 7) move_cursor(0);
+            else if (m_esc_param == 4 || m_esc_param == 8) move_cursor(m_len);
+            else if (m_esc_param == 3) erase_at_cursor();
+            break;
+        default: break;
+    }
+}
+
+void CliSession::feed(const char* data, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        char c = data[i];
+        char last = m_last;
+        m_last = c;
+
+        if (m_esc != Esc::NONE) {
+            handle_escape(c);
+            continue;
+        }
+        if (c == '\n' && last == '\r') continue;  // CR LF is one line end
+
+        switch (c) {
+            case '\r':
+            case '\n':
+                end_line();
+                break;
+            case '\x1b':
+                m_esc = Esc::ESC;
+                break;
+            case '\b':
+            case 0x7f:
+                erase_before_cursor();
+                break;
+            case 0x01:  // Ctrl-A
+                move_cursor(0);
+                break;
+            case 0x05:  // Ctrl-E
+                move_cursor(m_len);
+                break;
+            case 0x15:  // Ctrl-U
+                replace_line("", 0);
+                break;
+            case 0x03:  // Ctrl-C
+                if (m_batching) {
+                    m_batching = false;
+                    CliBatch::cancel_collect(this);
+                }
+                echo("^C\r\n", 4);
+                reset();
+                show_prompt();
+                break;
+            case '\t':
+                if (echoing()) {
+                    complete();
+                } else {
+                    insert(&c, 1);
+                }
+                break;
+            default:
+                if (static_cast<unsigned char>(c) >= 0x20) insert(&c, 1);
+                break;
+        }
+    }
+}
@@ -0,0 +1,279 @@
+/**
+ * @file cli_sys_commands.cpp
+ * @brief top / heap / stacks / timers / nvs-stats commands
+ */
+
+#include "cli_sys_commands.hpp"
+#include "cli_args.hpp"
+#include "cli_framework.hpp"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+#include <cstring>
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+
+// Two preallocated snapshots: `top` diffs them, `stacks` uses the first.
+// Commands are serialised by the CLI, so one set is enough (top keeps what
+// it needs across its unlocked wait in s_top_before).
+static TaskStatus_t s_snap_a[CLI_SYS_MAX_TASKS];
+static TaskStatus_t s_snap_b[CLI_SYS_MAX_TASKS];
+static uint8_t      s_order[CLI_SYS_MAX_TASKS];
+
+static UBaseType_t take_snapshot(TaskStatus_t* snap, uint32_t* total_runtime)
+{
+    uint32_t total = 0;
+    UBaseType_t n = uxTaskGetSystemState(snap, CLI_SYS_MAX_TASKS, &total);
+    if (total_runtime) *total_runtime = total;
+    return n;
+}
+
+static char task_state_char(eTaskState st)
+{
+    switch (st) {
+        case eRunning:   return 'X';
+        case eReady:     return 'R';
+        case eBlocked:   return 'B';
+        case eSuspended: return 'S';
+        case eDeleted:   return 'D';
+        default:         return '?';
+    }
+}
+
+// Insertion sort of s_order[0..n) by key, descending or ascending
+static void sort_order(UBaseType_t n, const uint32_t* key, bool descending)
+{
+    for (UBaseType_t i = 0; i < n; ++i) {
+        uint8_t v = static_cast<uint8_t>(i);
+        UBaseType_t j = i;
+        while (j > 0 && (descending ? key[s_order[j - 1]] < key[v] : key[s_order[j - 1]] > key[v])) {
+            s_order[j] = s_order[j - 1];
+            --j;
+        }
+        s_order[j] = v;
+    }
+}
+
+static int cmd_stacks(int, char**)
+{
+    UBaseType_t n = take_snapshot(s_snap_a, nullptr);
+    if (n == 0) {
+        Cli::printf("More than %u tasks - raise CLI_SYS_MAX_TASKS\n", (unsigned)CLI_SYS_MAX_TASKS);
+        return 1;
+    }
+
+    static uint32_t free_bytes[CLI_SYS_MAX_TASKS];
+    for (UBaseType_t i = 0; i < n; ++i) {
+        // High-water mark is in StackType_t units (bytes on ESP-IDF)
+        free_bytes[i] = s_snap_a[i].usStackHighWaterMark * sizeof(StackType_t);
+    }
+    sort_order(n, free_bytes, false);
+
+    Cli::printf("%-16s %3s %4s %10s\n", "task", "st", "prio", "min_free_B");
+    for (UBaseType_t k = 0; k < n; ++k) {
+        const TaskStatus_t& t = s_snap_a[s_order[k]];
+        Cli::printf("%-16s %3c %4u %10u\n", t.pcTaskName, task_state_char(t.eCurrentState),
+                    (unsigned)t.uxCurrentPriority, (unsigned)free_bytes[s_order[k]]);
+    }
+    return 0;
+}
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+struct TopArgs {
+    uint32_t window_ms;
+};
+
+static constexpr auto TOP_ARGS = cli_args<TopArgs>("top",
+    cli_int(&TopArgs::window_ms, "ms", 10, 60000, 1000));
+static_assert(TOP_ARGS.is_valid(), "bad top argument spec");
+
+// Run-time counters at the start of the window. top waits with the CLI lock
+// released, so other sessions may run `stacks` (reusing s_snap_a) meanwhile;
+// only these survive the wait, and one top runs at a time.
+struct TopBefore {
+    UBaseType_t task_number;
+    uint32_t    run_time;
+};
+static TopBefore s_top_before[CLI_SYS_MAX_TASKS];
+static bool      s_top_busy = false;
+
+static int cmd_top(int argc, char** argv)
+{
+    TopArgs args;
+    if (!TOP_ARGS.parse(argc, argv, args)) return 1;
+    const uint32_t window_ms = args.window_ms;
+
+    if (s_top_busy) {
+        Cli::printf("top is already running in another session\n");
+        return 1;
+    }
+
+    uint32_t total_a = 0, total_b = 0;
+    UBaseType_t na = take_snapshot(s_snap_a, &total_a);
+    for (UBaseType_t i = 0; i < na; ++i) {
+        s_top_before[i] = { s_snap_a[i].xTaskNumber, s_snap_a[i].ulRunTimeCounter };
+    }
+    s_top_busy = true;
+    Cli::wait(window_ms);
+    s_top_busy = false;
+    UBaseType_t nb = take_snapshot(s_snap_b, &total_b);
+    if (na == 0 || nb == 0) {
+        Cli::printf("More than %u tasks - raise CLI_SYS_MAX_TASKS\n", (unsigned)CLI_SYS_MAX_TASKS);
+        return 1;
+    }
+
+    // Run-time counters are per core; the window holds that much time on each
+    uint32_t window = (total_b - total_a) * portNUM_PROCESSORS;
+    if (window == 0) window = 1;
+
+    // Delta per task in snapshot B, matched to A by task number (tasks may
+    // have been created or deleted in between)
+    static uint32_t delta[CLI_SYS_MAX_TASKS];
+    for (UBaseType_t i = 0; i < nb; ++i) {
+        uint32_t before = 0;
+        for (UBaseType_t j = 0; j < na; ++j) {
+            if (s_top_before[j].task_number == s_snap_b[i].xTaskNumber) {
+                before = s_top_before[j].run_time;
+                break;
+            }
+        }
+        delta[i] = s_snap_b[i].ulRunTimeCounter - before;
+    }
+    sort_order(nb, delta, true);
+
+    Cli::printf("%-16s %3s %4s %4s %7s %12s\n", "task", "st", "prio", "core", "cpu%", "run_us");
+    for (UBaseType_t k = 0; k < nb; ++k) {
+        const TaskStatus_t& t = s_snap_b[s_order[k]];
+        uint32_t d = delta[s_order[k]];
+        int core = (t.xCoreID == tskNO_AFFINITY) ? -1 : static_cast<int>(t.xCoreID);
+        Cli::printf("%-16s %3c %4u %4d %6.1f%% %12u\n", t.pcTaskName,
+                    task_state_char(t.eCurrentState), (unsigned)t.uxCurrentPriority, core,
+                    100.0 * d / window, (unsigned)d);
+    }
+    Cli::printf("window %u ms, %u tasks\n", (unsigned)window_ms, (unsigned)nb);
+    return 0;
+}
+
+#endif // CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+#endif // CONFIG_FREERTOS_USE_TRACE_FACILITY
+
+#if !(CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS)
+static int cmd_top(int, char**)
+{
+    Cli::printf("top needs CONFIG_FREERTOS_USE_TRACE_FACILITY and "
+                "CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS\n");
+    return 1;
+}
+#endif
+
+#if !CONFIG_FREERTOS_USE_TRACE_FACILITY
+static int cmd_stacks(int, char**)
+{
+    Cli::printf("stacks needs CONFIG_FREERTOS_USE_TRACE_FACILITY\n");
+    return 1;
+}
+#endif
+
+static int cmd_heap(int, char**)
+{
+    struct CapRow {
+        const char* name;
+        uint32_t    caps;
+    };
+    static constexpr CapRow ROWS[] = {
+        { "default",  MALLOC_CAP_DEFAULT },
+        { "internal", MALLOC_CAP_INTERNAL },
+        { "dma",      MALLOC_CAP_DMA },
+        { "32bit",    MALLOC_CAP_32BIT },
+#if CONFIG_SPIRAM
+        { "spiram",   MALLOC_CAP_SPIRAM },
+#endif
+    };
+
+    Cli::printf("%-9s %9s %9s %9s %9s %7s\n", "caps", "total", "free", "min_free", "largest", "blocks");
+    for (const CapRow& row : ROWS) {
+        multi_heap_info_t info;
+        heap_caps_get_info(&info, row.caps);
+        size_t total = info.total_free_bytes + info.total_allocated_bytes;
+        if (total == 0) continue;
+        Cli::printf("%-9s %9u %9u %9u %9u %7u\n", row.name, (unsigned)total,
+                    (unsigned)info.total_free_bytes, (unsigned)info.minimum_free_bytes,
+                    (unsigned)info.largest_free_block, (unsigned)info.allocated_blocks);
+    }
+    return 0;
+}
+
+static int cmd_timers(int, char**)
+{
+    fflush(Cli::out());
+    esp_err_t err = esp_timer_dump(Cli::out());
+    if (err != ESP_OK) {
+        Cli::printf("esp_timer_dump: %s\n", esp_err_to_name(err));
+        return 1;
+    }
+    return 0;
+}
+
+struct NvsStatsArgs {
+    const char* ns;
+};
+
+static constexpr auto NVS_STATS_ARGS = cli_args<NvsStatsArgs>("nvs-stats",
+    cli_str(&NvsStatsArgs::ns, "namespace", nullptr));
+static_assert(NVS_STATS_ARGS.is_valid(), "bad nvs-stats argument spec");
+
+static int cmd_nvs_stats(int argc, char** argv)
+{
+    NvsStatsArgs args;
+    if (!NVS_STATS_ARGS.parse(argc, argv, args)) return 1;
+
+    nvs_stats_t st;
+    esp_err_t err = nvs_get_stats(nullptr, &st);
+    if (err != ESP_OK) {
+        Cli::printf("nvs_get_stats: %s\n", esp_err_to_name(err));
+        return 1;
+    }
+    Cli::printf("entries: used %u  free %u  available %u  total %u  (%u%% used)\n",
+                (unsigned)st.used_entries, (unsigned)st.free_entries,
+                (unsigned)st.available_entries, (unsigned)st.total_entries,
+                st.total_entries ? (unsigned)(100 * st.used_entries / st.total_entries) : 0u);
+    Cli::printf("namespaces: %u\n", (unsigned)st.namespace_count);
+
+    if (args.ns) {
+        nvs_handle_t h;
+        err = nvs_open(args.ns, NVS_READONLY, &h);
+        if (err != ESP_OK) {
+            Cli::printf("nvs_open '%s': %s\n", args.ns, esp_err_to_name(err));
+            return 1;
+        }
+        size_t used = 0;
+        err = nvs_get_used_entry_count(h, &used);
+        nvs_close(h);
+        if (err != ESP_OK) {
+            Cli::printf("nvs_get_used_entry_count: %s\n", esp_err_to_name(err));
+            return 1;
+        }
+        Cli::printf("'%s': %u entries\n", args.ns, (unsigned)used);
+    }
+    return 0;
+}
+
+static constexpr CliCommand SYS_COMMANDS[] = {
+    { "top",       "top [ms] - per-task CPU usage over a window",        cmd_top },
+    { "heap",      "Heap free / min free / largest block per capability", cmd_heap },
+    { "stacks",    "Per-task stack high-water marks",                     cmd_stacks },
+    { "timers",    "Dump active esp_timers",                              cmd_timers },
+    { "nvs-stats", "nvs-stats [namespace] - NVS entry usage",             cmd_nvs_stats },
+};
+static constexpr auto SYS_TABLE = cli_make_table(SYS_COMMANDS);
+static_assert(cli_table_is_valid(SYS_TABLE), "duplicate or empty system command");
+static constexpr auto SYS_TRIE = cli_make_trie<cli_trie_size(SYS_TABLE)>(SYS_TABLE);
+
+esp_err_t cli_register_system_commands()
+{
+    return Cli::register_table(SYS_TABLE, SYS_TRIE);
+}
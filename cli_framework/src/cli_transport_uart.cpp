@@ -0,0 +1,79 @@
+/**
+ * @file cli_transport_uart.cpp
+ * @brief UART CLI transport
+ */
+
+#include "cli_transport.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "CliUart";
+
+static constexpr int    UART_RX_BUF  = 256;
+static constexpr size_t READ_CHUNK   = 64;
+
+CliUartTransport::CliUartTransport(uart_port_t port, const char* prompt,
+                                   const CliOutputRingConfig& tx_cfg)
+    : m_port(port)
+    , m_tx(m_tx_buf, sizeof(m_tx_buf), tx_cfg)
+    , m_session({ sink_write, this }, prompt, true)
+    , m_task(nullptr)
+{
+}
+
+CliUartTransport::~CliUartTransport()
+{
+    if (m_task) {
+        vTaskDelete(m_task);
+    }
+}
+
+void CliUartTransport::sink_write(void* ctx, const char* data, size_t len)
+{
+    static_cast<CliUartTransport*>(ctx)->m_tx.write(data, len);
+}
+
+// Runs on the ring's low-priority drain task: the only place that waits on TX
+void CliUartTransport::tx_drain(void* ctx, const char* data, size_t len)
+{
+    auto* self = static_cast<CliUartTransport*>(ctx);
+    uart_write_bytes(self->m_port, data, len);
+}
+
+void CliUartTransport::reader_task(void* arg)
+{
+    auto* self = static_cast<CliUartTransport*>(arg);
+    char buf[READ_CHUNK];
+
+    self->m_session.show_prompt();
+    while (true) {
+        int n = uart_read_bytes(self->m_port, buf, sizeof(buf), pdMS_TO_TICKS(20));
+        if (n > 0) {
+            self->m_session.feed(buf, static_cast<size_t>(n));
+        }
+    }
+}
+
+esp_err_t CliUartTransport::start(uint32_t stack_size, UBaseType_t priority)
+{
+    if (m_task) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t err;
+    // The console may already own the driver; only install if nobody has
+    if (!uart_is_driver_installed(m_port)) {
+        err = uart_driver_install(m_port, UART_RX_BUF, 0, 0, nullptr, 0);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "uart_driver_install failed: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    err = m_tx.start_drain(tx_drain, this);
+    if (err != ESP_OK) return err;
+
+    if (xTaskCreate(reader_task, "cli_uart", stack_size, this, priority, &m_task) != pdPASS) {
+        m_task = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "CLI on UART%d", (int)m_port);
+    return ESP_OK;
+}
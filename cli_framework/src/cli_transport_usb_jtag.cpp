@@ -0,0 +1,81 @@
+/**
+ * @file cli_transport_usb_jtag.cpp
+ * @brief USB-Serial-JTAG CLI transport
+ */
+
+#include "cli_transport.hpp"
+
+#if SOC_USB_SERIAL_JTAG_SUPPORTED
+
+#include "driver/usb_serial_jtag.h"
+#include "esp_log.h"
+
+static const char* TAG = "CliUsbJtag";
+
+static constexpr size_t READ_CHUNK = 64;
+
+CliUsbJtagTransport::CliUsbJtagTransport(const char* prompt, const CliOutputRingConfig& tx_cfg)
+    : m_tx(m_tx_buf, sizeof(m_tx_buf), tx_cfg)
+    , m_session({ sink_write, this }, prompt, true)
+    , m_task(nullptr)
+{
+}
+
+CliUsbJtagTransport::~CliUsbJtagTransport()
+{
+    if (m_task) {
+        vTaskDelete(m_task);
+    }
+}
+
+void CliUsbJtagTransport::sink_write(void* ctx, const char* data, size_t len)
+{
+    static_cast<CliUsbJtagTransport*>(ctx)->m_tx.write(data, len);
+}
+
+void CliUsbJtagTransport::tx_drain(void*, const char* data, size_t len)
+{
+    // Short timeout: with no host attached the TX FIFO never drains
+    usb_serial_jtag_write_bytes(data, len, pdMS_TO_TICKS(50));
+}
+
+void CliUsbJtagTransport::reader_task(void* arg)
+{
+    auto* self = static_cast<CliUsbJtagTransport*>(arg);
+    char buf[READ_CHUNK];
+
+    self->m_session.show_prompt();
+    while (true) {
+        int n = usb_serial_jtag_read_bytes(buf, sizeof(buf), pdMS_TO_TICKS(20));
+        if (n > 0) {
+            self->m_session.feed(buf, static_cast<size_t>(n));
+        }
+    }
+}
+
+esp_err_t CliUsbJtagTransport::start(uint32_t stack_size, UBaseType_t priority)
+{
+    if (m_task) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t err;
+    if (!usb_serial_jtag_is_driver_installed()) {
+        usb_serial_jtag_driver_config_t cfg = USB_SERIAL_JTAG_DRIVER_CONFIG_DEFAULT();
+        err = usb_serial_jtag_driver_install(&cfg);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "usb_serial_jtag_driver_install failed: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    err = m_tx.start_drain(tx_drain, this);
+    if (err != ESP_OK) return err;
+
+    if (xTaskCreate(reader_task, "cli_usb", stack_size, this, priority, &m_task) != pdPASS) {
+        m_task = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "CLI on USB-Serial-JTAG");
+    return ESP_OK;
+}
+
+#endif // SOC_USB_SERIAL_JTAG_SUPPORTED
@@ -0,0 +1,161 @@
+/**
+ * @file cli_transport_ws.cpp
+ * @brief WebSocket CLI transport on top of web_server_base
+ */
+
+#include "cli_transport.hpp"
+#include "cli_batch.hpp"
+#include "sdkconfig.h"
+
+#if CONFIG_IDF_TARGET_ESP32C6
+
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "web_server_base.h"
+#include <cstring>
+#include <new>
+
+static const char* TAG = "CliWs";
+
+struct WsClient {
+    int          fd;         ///< Socket this slot serves, -1 when free
+    httpd_req_t* req;        ///< Request being answered (valid during dispatch only)
+    bool         msg_open;   ///< A fragmented reply message has been started
+    CliSession*  session;
+};
+
+static WsClient s_clients[CliWsTransport::MAX_CLIENTS];
+alignas(CliSession) static uint8_t s_session_mem[CliWsTransport::MAX_CLIENTS][sizeof(CliSession)];
+static bool s_started = false;
+
+// Frames are handled one at a time on the httpd task, so one buffer serves
+// every client; sized for a whole batch script
+static char s_frame[CliBatch::SCRIPT_MAX];
+
+// Each output chunk goes out as one fragment of the reply message
+static void ws_sink(void* ctx, const char* data, size_t len)
+{
+    auto* c = static_cast<WsClient*>(ctx);
+    if (!c->req) return;
+    httpd_ws_frame_t frame = {};
+    frame.final      = false;
+    frame.fragmented = true;
+    frame.type       = c->msg_open ? HTTPD_WS_TYPE_CONTINUE : HTTPD_WS_TYPE_TEXT;
+    frame.payload    = reinterpret_cast<uint8_t*>(const_cast<char*>(data));
+    frame.len        = len;
+    if (httpd_ws_send_frame(c->req, &frame) == ESP_OK) {
+        c->msg_open = true;
+    }
+}
+
+static void ws_finish_message(WsClient* c)
+{
+    httpd_ws_frame_t frame = {};
+    frame.final      = true;
+    frame.fragmented = c->msg_open;
+    frame.type       = c->msg_open ? HTTPD_WS_TYPE_CONTINUE : HTTPD_WS_TYPE_TEXT;
+    httpd_ws_send_frame(c->req, &frame);
+    c->msg_open = false;
+}
+
+static WsClient* find_client(int fd)
+{
+    for (auto& c : s_clients) {
+        if (c.fd == fd) return &c;
+    }
+    return nullptr;
+}
+
+// Sessions are never torn down on close (there is no close hook); instead a
+// slot whose socket is no longer an open WebSocket is reused.
+static WsClient* claim_client(httpd_req_t* req, int fd)
+{
+    for (auto& c : s_clients) {
+        if (c.fd < 0 || httpd_ws_get_fd_info(req->handle, c.fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            c.fd = fd;
+            c.msg_open = false;
+            c.session->reset();
+            return &c;
+        }
+    }
+    return nullptr;
+}
+
+static esp_err_t ws_handler(httpd_req_t* req)
+{
+    int fd = httpd_req_to_sockfd(req);
+
+    if (req->method == HTTP_GET) {
+        // Handshake
+        if (!find_client(fd) && !claim_client(req, fd)) {
+            ESP_LOGW(TAG, "All %u CLI slots busy", (unsigned)CliWsTransport::MAX_CLIENTS);
+            return ESP_FAIL;
+        }
+        return ESP_OK;
+    }
+
+    httpd_ws_frame_t frame = {};
+    esp_err_t err = httpd_ws_recv_frame(req, &frame, 0);
+    if (err != ESP_OK) return err;
+    if (frame.type != HTTPD_WS_TYPE_TEXT) return ESP_OK;
+
+    WsClient* c = find_client(fd);
+    if (!c) c = claim_client(req, fd);
+    if (!c) return ESP_FAIL;
+
+    if (frame.len >= sizeof(s_frame)) {
+        // Unread payload would desync the socket — drop the connection
+        ESP_LOGW(TAG, "Command frame too long (%u bytes)", (unsigned)frame.len);
+        return ESP_FAIL;
+    }
+    frame.payload = reinterpret_cast<uint8_t*>(s_frame);
+    err = httpd_ws_recv_frame(req, &frame, sizeof(s_frame) - 1);
+    if (err != ESP_OK) return err;
+    s_frame[frame.len] = '\0';
+
+    c->req = req;
+    c->msg_open = false;
+    if (memchr(s_frame, '\n', frame.len)) {
+        // Multi-line frame: a batch script, answered with one reply message
+        c->session->run_batch(s_frame, false);
+    } else if (frame.len >= Cli::LINE_MAX) {
+        static const char msg[] = "error: line too long\n";
+        c->session->write(msg, sizeof(msg) - 1);
+    } else {
+        c->session->execute(s_frame);
+    }
+    ws_finish_message(c);
+    c->req = nullptr;
+    return ESP_OK;
+}
+
+esp_err_t CliWsTransport::start(const char* uri)
+{
+    if (!s_started) {
+        for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+            s_clients[i].fd = -1;
+            s_clients[i].req = nullptr;
+            s_clients[i].msg_open = false;
+            s_clients[i].session = new (s_session_mem[i])
+                CliSession({ ws_sink, &s_clients[i] }, nullptr, false);
+        }
+        s_started = true;
+    }
+
+    esp_err_t err = web_server_base_register(uri, HTTP_GET, ws_handler, true);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Register %s failed: %s", uri, esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "CLI on ws://<host>%s", uri);
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t CliWsTransport::start(const char*)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_IDF_TARGET_ESP32C6
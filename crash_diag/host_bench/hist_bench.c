@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: MIT
+/**
+ * @file hist_bench.c
+ * @brief Host-side accuracy and throughput benchmark for crash_diag_hist.
+ *
+ * Accuracy: records samples from several latency-like distributions, sorts
+ * the raw samples for exact nearest-rank percentiles and compares them with
+ * what the histogram reports. The worst relative error must stay within the
+ * 1/16 bound documented in crash_diag_hist.h; the exit code says whether it
+ * did.
+ *
+ * Throughput: mean cost of record, snapshot, merge and summary.
+ *
+ * Usage:
+ *   make run
+ *   ./hist_bench -n 2000000    # samples per distribution
+ *
+ * Host critical sections are no-ops, so record cost here excludes the
+ * interrupt disable/enable it pays on target.
+ */
+
+#include "crash_diag_hist.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ERROR_BOUND (1.0 / 16)
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* xorshift32: deterministic across runs and hosts */
+static uint32_t s_rng = 0x12345678;
+
+static inline uint32_t rng_u32(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static double rng_unit(void)
+{
+    return (rng_u32() + 0.5) / 4294967296.0;
+}
+
+/* ================================================================== */
+/*  Distributions (values in µs)                                       */
+/* ================================================================== */
+
+static uint32_t dist_uniform(void)    { return 1 + rng_u32() % 100000; }
+static uint32_t dist_small(void)      { return rng_u32() % 40; }
+static uint32_t dist_exponential(void){ return (uint32_t)(-2000.0 * log(rng_unit())); }
+
+static uint32_t dist_lognormal(void)
+{
+    /* Box-Muller; median ~3 ms, long right tail like HTTP handlers */
+    double z = sqrt(-2.0 * log(rng_unit())) * cos(2 * M_PI * rng_unit());
+    double v = exp(8.0 + 1.2 * z);
+    return v > 4e9 ? 4000000000u : (uint32_t)v;
+}
+
+static uint32_t dist_bimodal(void)
+{
+    /* Fast cache hits plus slow flash writes, like NVS operations */
+    return (rng_u32() % 10) ? 50 + rng_u32() % 30 : 8000 + rng_u32() % 4000;
+}
+
+typedef struct {
+    const char *name;
+    uint32_t (*next)(void);
+} dist_t;
+
+static const dist_t s_dists[] = {
+    { "uniform 1..100000",  dist_uniform     },
+    { "small 0..39",        dist_small       },
+    { "exponential m=2000", dist_exponential },
+    { "lognormal m~3000",   dist_lognormal   },
+    { "bimodal 50/10000",   dist_bimodal     },
+};
+
+/* ================================================================== */
+/*  Accuracy                                                           */
+/* ================================================================== */
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t exact_percentile(const uint32_t *sorted, uint32_t n, uint32_t permille)
+{
+    uint64_t rank = ((uint64_t)n * permille + 999) / 1000;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+static double rel_error(uint32_t got, uint32_t want)
+{
+    if (want == 0) {
+        return got == 0 ? 0.0 : 1.0;
+    }
+    return fabs((double)got - want) / want;
+}
+
+/* Returns the worst relative error over p50/p90/p99/max */
+static double check_dist(const dist_t *d, uint32_t n, uint32_t *samples)
+{
+    static crash_diag_hist_t h;
+    crash_diag_hist_reset(&h);
+    for (uint32_t i = 0; i < n; i++) {
+        samples[i] = d->next();
+        crash_diag_hist_record(&h, samples[i]);
+    }
+    qsort(samples, n, sizeof(*samples), cmp_u32);
+
+    crash_diag_hist_summary_t s;
+    crash_diag_hist_summary(&h, &s);
+    const uint32_t got[]  = { s.p50, s.p90, s.p99, s.max };
+    const uint32_t want[] = {
+        exact_percentile(samples, n, 500), exact_percentile(samples, n, 900),
+        exact_percentile(samples, n, 990), samples[n - 1],
+    };
+    double worst = 0;
+    printf("%-20s", d->name);
+    for (int i = 0; i < 4; i++) {
+        double e = rel_error(got[i], want[i]);
+        if (e > worst) worst = e;
+        printf(" %9u/%-9u", got[i], want[i]);
+    }
+    printf(" %7.3f%%\n", worst * 100);
+    return worst;
+}
+
+/* ================================================================== */
+/*  Throughput                                                         */
+/* ================================================================== */
+
+static void bench_ops(uint32_t n, const uint32_t *values)
+{
+    static crash_diag_hist_t h, snap, total;
+    crash_diag_hist_reset(&h);
+
+    uint64_t t0 = now_ns();
+    for (uint32_t i = 0; i < n; i++) {
+        crash_diag_hist_record(&h, values[i]);
+    }
+    double rec_ns = (double)(now_ns() - t0) / n;
+
+    const uint32_t reps = 10000;
+    crash_diag_hist_summary_t s;
+    t0 = now_ns();
+    for (uint32_t i = 0; i < reps; i++) {
+        crash_diag_hist_snapshot(&h, &snap, false);
+    }
+    double snap_ns = (double)(now_ns() - t0) / reps;
+
+    t0 = now_ns();
+    for (uint32_t i = 0; i < reps; i++) {
+        crash_diag_hist_merge(&total, &snap);
+    }
+    double merge_ns = (double)(now_ns() - t0) / reps;
+
+    t0 = now_ns();
+    volatile uint32_t sink = 0;
+    for (uint32_t i = 0; i < reps; i++) {
+        crash_diag_hist_summary(&snap, &s);
+        sink += s.p99;
+    }
+    double sum_ns = (double)(now_ns() - t0) / reps;
+    (void)sink;
+
+    printf("\n%-12s %10s\n", "op", "ns/op");
+    printf("%-12s %10.1f  (%.0f M records/s)\n", "record", rec_ns, 1e3 / rec_ns);
+    printf("%-12s %10.1f\n", "snapshot", snap_ns);
+    printf("%-12s %10.1f\n", "merge", merge_ns);
+    printf("%-12s %10.1f\n", "summary", sum_ns);
+    printf("\nsizeof(crash_diag_hist_t) = %zu bytes, %u buckets\n",
+           sizeof(crash_diag_hist_t), (unsigned)CRASH_DIAG_HIST_BUCKETS);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t n = 1000000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-n samples]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (n == 0) n = 1;
+
+    uint32_t *samples = malloc(n * sizeof(*samples));
+    if (!samples) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+
+    printf("%-20s %19s %19s %19s %19s %8s\n", "distribution",
+           "p50 hist/exact", "p90 hist/exact", "p99 hist/exact", "max hist/exact", "worst");
+    double worst = 0;
+    for (size_t i = 0; i < sizeof(s_dists) / sizeof(s_dists[0]); i++) {
+        double e = check_dist(&s_dists[i], n, samples);
+        if (e > worst) worst = e;
+    }
+    printf("worst relative error %.3f%% (bound %.3f%%)\n", worst * 100, ERROR_BOUND * 100);
+
+    /* Throughput on fresh, unsorted samples */
+    for (uint32_t i = 0; i < n; i++) {
+        samples[i] = dist_lognormal();
+    }
+    bench_ops(n, samples);
+    free(samples);
+
+    if (worst > ERROR_BOUND) {
+        fprintf(stderr, "FAIL: percentile error above bound\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,6 @@
+// SPDX-License-Identifier: MIT
+/* Host stub of esp_attr.h */
+#pragma once
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
@@ -0,0 +1,12 @@
+// SPDX-License-Identifier: MIT
+/* Host stub of FreeRTOS.h: the benchmark is single-threaded, so critical
+ * sections compile out (on target they are an interrupt disable/enable). */
+#pragma once
+
+#include <stdint.h>
+
+typedef struct { uint32_t owner; } portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL_SAFE(mux) do { (void)(mux); } while (0)
+#define portEXIT_CRITICAL_SAFE(mux)  do { (void)(mux); } while (0)
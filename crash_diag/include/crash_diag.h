@@ -1,7 +1,10 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include "crash_diag_trace.h"
 #include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -22,8 +25,100 @@ extern "C" {
  * Usage:
  *   1. Call crash_diag_init() early in app_main(), after nvs_flash_init().
  *   2. Call crash_diag_get_data() during Zigbee cluster creation to seed attrs.
- *   3. Call crash_diag_update_uptime() periodically (e.g. every poll cycle).
+ *   3. Optionally call crash_diag_update_uptime() at points of interest; an
+ *      internal timer already keeps the RTC uptime current.
+ *
+ * Crash history: a panic hook (linker-wrapped esp_panic_handler) records the
+ * faulting task, uptime and a short backtrace into a ring in RTC memory, so a
+ * crash loop keeps every event rather than only the last one. The next
+ * crash_diag_init() moves new records into NVS; crash_diag_get_history()
+ * returns them newest first.
+ */
+
+/** Crash records kept (RTC ring and NVS history) */
+#define CRASH_DIAG_HISTORY_LEN   8
+/** Code addresses captured per crash */
+#define CRASH_DIAG_BT_DEPTH      8
+/** Task name bytes per record, NUL included (configMAX_TASK_NAME_LEN default) */
+#define CRASH_DIAG_TASK_NAME_LEN 16
+
+/** Heap samples kept (one hour at the default period) */
+#define CRASH_DIAG_HEAP_SAMPLES  60
+/** Most recent allocation failures kept */
+#define CRASH_DIAG_ALLOC_FAILS   4
+
+/** Tasks tracked by the sampler */
+#define CRASH_DIAG_MAX_TASKS     24
+/** Offenders kept per category (stack headroom, CPU) */
+#define CRASH_DIAG_TOP_TASKS     4
+
+/** Record was written by the panic hook (otherwise inferred at boot from the reset reason) */
+#define CRASH_DIAG_REC_PANIC     0x01
+/** Panic raised by the task watchdog; `task` names the task that stopped feeding it */
+#define CRASH_DIAG_REC_STALL     0x02
+
+/** Trace events copied into a stall record */
+#define CRASH_DIAG_STALL_TRACE   4
+
+/**
+ * Boot phases for crash_diag_mark(). The shared components mark the ones
+ * they own; APP_* and USER_* are for the application.
  */
+typedef enum {
+    CRASH_DIAG_PHASE_APP_MAIN = 0,      /**< app_main() entered (application) */
+    CRASH_DIAG_PHASE_DIAG_INIT,         /**< crash_diag_init() (automatic) */
+    CRASH_DIAG_PHASE_WIFI_START,        /**< Wi-Fi STA started (wifi_manager) */
+    CRASH_DIAG_PHASE_WIFI_GOT_IP,       /**< STA got an IP (wifi_manager) */
+    CRASH_DIAG_PHASE_HTTP_READY,        /**< HTTP server serving (web_server_base) */
+    CRASH_DIAG_PHASE_ZB_STACK_UP,       /**< Zigbee stack started (zigbee_core) */
+    CRASH_DIAG_PHASE_ZB_STEERING,       /**< Network steering begun (zigbee_core) */
+    CRASH_DIAG_PHASE_ZB_JOINED,         /**< Joined / rejoined the network (zigbee_core) */
+    CRASH_DIAG_PHASE_APP_READY,         /**< Application considers itself up */
+    CRASH_DIAG_PHASE_USER_0,
+    CRASH_DIAG_PHASE_USER_1,
+    CRASH_DIAG_PHASE_USER_2,
+    CRASH_DIAG_PHASE_USER_3,
+    CRASH_DIAG_PHASE_COUNT
+} crash_diag_phase_t;
+
+/**
+ * Boot phase timestamps of one boot
+ */
+typedef struct {
+    uint32_t boot_count;
+    char     fw_version[32];                    /**< App version of that boot */
+    uint32_t at_us[CRASH_DIAG_PHASE_COUNT];     /**< esp_timer time of the first mark, 0 = not reached */
+} crash_diag_boot_profile_t;
+
+/**
+ * Task watchdog timeout, captured in the TWDT interrupt (96 bytes, RTC memory)
+ */
+typedef struct {
+    uint32_t boot_count;
+    uint32_t uptime_sec;
+    char     task[CRASH_DIAG_TASK_NAME_LEN];    /**< First task or TWDT user that missed its reset */
+    uint32_t stack_free;                        /**< Its lowest stack headroom seen by the task
+                                                     sampler, bytes; UINT32_MAX if unknown */
+    uint8_t  cpu;                               /**< CPU the task was pinned to, 0xFF if any/unknown */
+    uint8_t  trace_count;
+    uint8_t  reserved[2];
+    crash_diag_trace_event_t trace[CRASH_DIAG_STALL_TRACE];  /**< Last trace events, oldest first */
+} crash_diag_stall_t;
+
+/** State blobs saved on brownout */
+#define CRASH_DIAG_BROWNOUT_BLOBS    4
+/** Bytes kept per blob */
+#define CRASH_DIAG_BROWNOUT_BLOB_MAX 32
+
+/**
+ * Brownout seen by the detector interrupt, recovered at the next boot
+ */
+typedef struct {
+    uint32_t boot_count;        /**< Boot the power dip ended */
+    uint32_t uptime_ms;         /**< When the detector fired */
+    uint8_t  blob_count;        /**< Blobs saved (read with crash_diag_brownout_blob()) */
+    uint8_t  blob_ids[CRASH_DIAG_BROWNOUT_BLOBS];
+} crash_diag_brownout_t;
 
 /**
  * Diagnostic data collected at boot
@@ -35,6 +130,139 @@ typedef struct {
     uint32_t min_free_heap;     /**< Minimum free heap size since last boot */
 } crash_diag_data_t;
 
+/**
+ * One failed heap allocation
+ */
+typedef struct {
+    uint32_t size;          /**< Requested bytes */
+    uint32_t caps;          /**< Requested MALLOC_CAP_* */
+    uint32_t uptime_sec;    /**< When it failed */
+} crash_diag_alloc_fail_t;
+
+/**
+ * Heap state now, plus allocation-failure counters since boot
+ *
+ * Fragmentation shows as largest_* far below free_*: an allocation larger
+ * than the largest free block fails however much memory is free in total.
+ */
+typedef struct {
+    uint32_t free_internal;         /**< Free internal RAM */
+    uint32_t largest_internal;      /**< Largest free internal block */
+    uint32_t min_free_internal;     /**< Internal low-water mark since boot */
+    uint32_t free_dma;              /**< Free DMA-capable RAM */
+    uint32_t largest_dma;           /**< Largest free DMA-capable block */
+    uint32_t alloc_fail_count;      /**< Failed allocations since boot */
+    uint32_t alloc_fail_max_size;   /**< Largest failed request */
+    uint8_t  recent_count;          /**< Valid entries in recent */
+    crash_diag_alloc_fail_t recent[CRASH_DIAG_ALLOC_FAILS];   /**< Newest first */
+} crash_diag_heap_stats_t;
+
+/**
+ * One periodic heap sample (16 bytes)
+ */
+typedef struct {
+    uint32_t uptime_sec;
+    uint32_t free_internal;
+    uint32_t largest_internal;
+    uint16_t free_dma_kb;           /**< Free DMA-capable RAM in KiB */
+    uint16_t alloc_fails;           /**< Failures since the previous sample (saturating) */
+} crash_diag_heap_sample_t;
+
+/**
+ * Per-task figures from the sampler (24 bytes)
+ */
+typedef struct {
+    char     name[CRASH_DIAG_TASK_NAME_LEN];
+    uint32_t min_stack_free;    /**< Stack headroom low-water mark, bytes */
+    uint16_t cpu_permille;      /**< CPU share over the last window, 1000 = one core */
+    uint8_t  priority;
+    uint8_t  alive;             /**< Present in the last snapshot */
+} crash_diag_task_stat_t;
+
+/**
+ * Worst tasks at the last sample; kept in RTC memory so the previous boot's
+ * list survives a stack-overflow or WDT reset
+ */
+typedef struct {
+    uint32_t boot_count;        /**< Boot the sample was taken in */
+    uint32_t uptime_sec;        /**< When */
+    uint8_t  stack_count;
+    uint8_t  cpu_count;
+    uint8_t  reserved[2];
+    crash_diag_task_stat_t stack[CRASH_DIAG_TOP_TASKS];   /**< Least headroom first */
+    crash_diag_task_stat_t cpu[CRASH_DIAG_TOP_TASKS];     /**< Busiest first (idle tasks excluded) */
+} crash_diag_task_offenders_t;
+
+/**
+ * One crash, as kept in the history (60 bytes)
+ */
+typedef struct {
+    uint32_t boot_count;                        /**< Boot during which the crash happened */
+    uint32_t uptime_sec;                        /**< Uptime at the crash */
+    uint32_t backtrace[CRASH_DIAG_BT_DEPTH];    /**< Faulting PC, RA, then return-address candidates from the stack */
+    char     task[CRASH_DIAG_TASK_NAME_LEN];    /**< Running task, "" if unknown */
+    uint8_t  reset_reason;                      /**< esp_reset_reason() of the boot that followed */
+    uint8_t  bt_depth;                          /**< Valid backtrace entries */
+    uint8_t  flags;                             /**< CRASH_DIAG_REC_* */
+    uint8_t  reserved;
+} crash_diag_record_t;
+
+/** Default RTC uptime refresh period */
+#define CRASH_DIAG_DEFAULT_UPTIME_PERIOD_SEC 10
+/** Default task sampler period */
+#define CRASH_DIAG_DEFAULT_TASK_PERIOD_SEC   10
+/** Default heap sample period */
+#define CRASH_DIAG_DEFAULT_HEAP_PERIOD_SEC   60
+/** Default crash loop: this many boots in a row ... */
+#define CRASH_DIAG_DEFAULT_SAFE_MODE_CRASHES    3
+/** ... each dying within this many seconds of boot */
+#define CRASH_DIAG_DEFAULT_SAFE_MODE_UPTIME_SEC 120
+
+/**
+ * Options for crash_diag_init_ex()
+ */
+typedef struct {
+    /**
+     * RTC uptime refresh period in seconds, 0 to disable (then only
+     * crash_diag_update_uptime() and the panic hook update it).
+     *
+     * The timer never wakes the chip from light sleep: while asleep its
+     * expiries are skipped and it runs on the next wakeup that happens
+     * anyway, so sleepy devices pay nothing extra.
+     */
+    uint32_t uptime_period_sec;
+
+    /**
+     * Heap sample period in seconds, 0 to disable the sample ring.
+     * Same sleep behaviour as the uptime timer.
+     */
+    uint32_t heap_period_sec;
+
+    /**
+     * Task sampler period in seconds, 0 to disable. Needs
+     * CONFIG_FREERTOS_USE_TRACE_FACILITY; CPU figures also need
+     * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS.
+     */
+    uint32_t task_period_sec;
+
+    /**
+     * Crash loop detection: the boot starts in safe mode (see
+     * crash_diag_in_safe_mode()) when the last `safe_mode_crashes` boots
+     * all crashed less than `safe_mode_uptime_sec` after starting.
+     * 0 disables it; at most CRASH_DIAG_HISTORY_LEN.
+     */
+    uint8_t  safe_mode_crashes;
+    uint32_t safe_mode_uptime_sec;
+} crash_diag_config_t;
+
+#define CRASH_DIAG_CONFIG_DEFAULT() { \
+    .uptime_period_sec    = CRASH_DIAG_DEFAULT_UPTIME_PERIOD_SEC, \
+    .heap_period_sec      = CRASH_DIAG_DEFAULT_HEAP_PERIOD_SEC, \
+    .task_period_sec      = CRASH_DIAG_DEFAULT_TASK_PERIOD_SEC, \
+    .safe_mode_crashes    = CRASH_DIAG_DEFAULT_SAFE_MODE_CRASHES, \
+    .safe_mode_uptime_sec = CRASH_DIAG_DEFAULT_SAFE_MODE_UPTIME_SEC, \
+}
+
 /**
  * Initialize crash diagnostics system.
  *
@@ -47,11 +275,20 @@ typedef struct {
  * - Reads last_uptime from RTC memory
  * - Initializes heap monitoring
  * - Stores current data in RTC memory for next boot
+ * - Starts the uptime refresh timer (CRASH_DIAG_CONFIG_DEFAULT())
  *
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t crash_diag_init(void);
 
+/**
+ * Initialize crash diagnostics with explicit options.
+ *
+ * @param config  Options, or NULL for CRASH_DIAG_CONFIG_DEFAULT()
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t crash_diag_init_ex(const crash_diag_config_t *config);
+
 /**
  * Get current diagnostic data.
  *
@@ -71,9 +308,9 @@ const char *crash_diag_reset_reason_str(uint8_t reason);
 /**
  * Update uptime in RTC memory.
  *
- * Should be called periodically (e.g. every poll cycle) to keep uptime
- * current in case of unexpected reset. If not called, last_uptime_sec
- * will be 0 on the next boot.
+ * No longer required: the refresh timer started by crash_diag_init() and
+ * the panic hook keep the value current. Calling it still works and gives
+ * finer resolution at points the application cares about.
  *
  * Only has meaningful value after a software reset (esp_restart, panic,
  * WDT). Power loss always clears LP RAM regardless.
@@ -91,6 +328,212 @@ void crash_diag_update_uptime(uint32_t uptime_sec);
  */
 void crash_diag_reset_boot_count(void);
 
+/**
+ * True when crash_diag_init() found a crash loop in the crash history.
+ *
+ * Decided once at init and fixed for the whole boot. Check it before
+ * bringing up heavy or risky subsystems (radio stacks, file systems,
+ * background sync) and start only what is needed to recover: a local
+ * console, a setup AP, an OTA path. The next boot leaves safe mode by
+ * itself unless this one also crashes early, because a boot that
+ * survives the uptime threshold breaks the streak.
+ *
+ * @code
+ * static esp_err_t step_zigbee(void *arg)
+ * {
+ *     if (crash_diag_in_safe_mode()) {
+ *         return ESP_OK;      // skipped until the crash loop is fixed
+ *     }
+ *     ...
+ * }
+ * @endcode
+ */
+bool crash_diag_in_safe_mode(void);
+
+/**
+ * Get the crash history, newest first.
+ *
+ * Covers crashes up to the current boot (records of a crash are moved from
+ * RTC memory to NVS by crash_diag_init() on the following boot). Backtrace
+ * entries are raw code addresses; decode them with addr2line against the
+ * firmware ELF. Entries after the first two come from a stack scan and may
+ * include stale return addresses.
+ *
+ * @param[out] out    Records to fill (may be NULL when max is 0)
+ * @param      max    Capacity of out
+ * @param[out] count  Number of records written
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG if count is NULL
+ */
+esp_err_t crash_diag_get_history(crash_diag_record_t *out, size_t max, size_t *count);
+
+/**
+ * Get current heap state and allocation-failure counters.
+ *
+ * Failures are counted through heap_caps_register_failed_alloc_callback(),
+ * which holds a single callback. crash_diag_init() replaces any callback the
+ * application registered before it, and one registered after it silently
+ * stops these counters. Use crash_diag_set_alloc_failed_handler() instead.
+ *
+ * @param[out] stats  Filled on success
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG if stats is NULL
+ */
+esp_err_t crash_diag_get_heap_stats(crash_diag_heap_stats_t *stats);
+
+/** Application failed-allocation hook, same arguments as esp_alloc_failed_hook_t */
+typedef void (*crash_diag_alloc_failed_handler_t)(size_t size, uint32_t caps, const char *function_name);
+
+/**
+ * Chain an application handler behind crash_diag's failed-allocation hook.
+ *
+ * Registering with heap_caps_register_failed_alloc_callback() directly
+ * would replace crash_diag's counters. The handler runs after they are
+ * updated, in whatever context the allocation failed (possibly an ISR), so
+ * it must be IRAM-safe and must not allocate or block.
+ *
+ * @param handler  Called on every failed allocation, or NULL to remove it
+ */
+void crash_diag_set_alloc_failed_handler(crash_diag_alloc_failed_handler_t handler);
+
+/**
+ * Get the periodic heap samples, oldest first.
+ *
+ * @param[out] out    Samples to fill
+ * @param      max    Capacity of out
+ * @param[out] count  Number of samples written
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG if count is NULL
+ */
+esp_err_t crash_diag_get_heap_samples(crash_diag_heap_sample_t *out, size_t max, size_t *count);
+
+/**
+ * Get the sampler's per-task table (tasks seen since boot, deleted ones
+ * included until their slot is reused).
+ *
+ * @param[out] out    Entries to fill
+ * @param      max    Capacity of out
+ * @param[out] count  Number of entries written
+ * @return ESP_OK, ESP_ERR_INVALID_ARG if count is NULL,
+ *         ESP_ERR_NOT_SUPPORTED without CONFIG_FREERTOS_USE_TRACE_FACILITY
+ */
+esp_err_t crash_diag_get_task_stats(crash_diag_task_stat_t *out, size_t max, size_t *count);
+
+/**
+ * Get the top stack/CPU offenders.
+ *
+ * @param[out] out            Filled on success
+ * @param      previous_boot  true: the last sample before the previous reset
+ *                            (from RTC memory); false: the latest sample now
+ * @return ESP_OK, ESP_ERR_INVALID_ARG if out is NULL,
+ *         ESP_ERR_NOT_FOUND if there is no such sample
+ */
+esp_err_t crash_diag_get_task_offenders(crash_diag_task_offenders_t *out, bool previous_boot);
+
+/**
+ * Record that a boot phase was reached.
+ *
+ * Only the first mark of a phase counts, so retry paths can mark freely.
+ * Costs one timer read and a store; safe to call before crash_diag_init()
+ * (the marks are carried over) and from any task.
+ */
+void crash_diag_mark(crash_diag_phase_t phase);
+
+/**
+ * Get boot phase timestamps.
+ *
+ * @param[out] out            Filled on success
+ * @param      previous_boot  true: the boot before this one (kept in RTC
+ *                            memory, so lost on power loss); false: this boot
+ * @return ESP_OK, ESP_ERR_INVALID_ARG if out is NULL,
+ *         ESP_ERR_NOT_FOUND if there is no previous-boot table
+ */
+esp_err_t crash_diag_get_boot_profile(crash_diag_boot_profile_t *out, bool previous_boot);
+
+/**
+ * Short name of a boot phase ("wifi_ip", "zb_joined", ...)
+ */
+const char *crash_diag_phase_name(crash_diag_phase_t phase);
+
+/**
+ * Get the most recent task watchdog stall.
+ *
+ * crash_diag defines esp_task_wdt_isr_user_handler(), so every TWDT timeout
+ * stores the starved task, its stack headroom and the last trace events in
+ * RTC memory before the (optional) panic; the record survives that reset.
+ * With CONFIG_ESP_TASK_WDT_PANIC the crash history entry also names the
+ * task and carries CRASH_DIAG_REC_STALL.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NOT_FOUND if no stall was
+ *         recorded since power-on
+ */
+esp_err_t crash_diag_get_last_stall(crash_diag_stall_t *out);
+
+/** Application task watchdog hook, see crash_diag_set_twdt_user_handler() */
+typedef void (*crash_diag_twdt_handler_t)(void);
+
+/**
+ * Chain an application handler behind crash_diag's task watchdog hook.
+ *
+ * esp_system has a single weak esp_task_wdt_isr_user_handler(), and
+ * crash_diag defines it. An application that defines its own fails to link
+ * with a duplicate symbol; it should register the handler here instead.
+ * The handler runs from the TWDT interrupt after the stall is recorded,
+ * under the same rules as the IDF hook: no logging, no blocking.
+ *
+ * @param handler  Called on every TWDT timeout, or NULL to remove it
+ */
+void crash_diag_set_twdt_user_handler(crash_diag_twdt_handler_t handler);
+
+/**
+ * Have a RAM region copied into RTC memory when the brownout detector fires.
+ *
+ * crash_diag wraps esp_reset_reason_set_hint(), which the brownout interrupt
+ * calls before it restarts the chip, and copies every watched region there:
+ * a few microseconds, while the supply is still above the reset threshold.
+ * The next boot keeps the copies for crash_diag_brownout_blob(). Meant for
+ * small state that has not reached flash yet (a dirty setting, a counter,
+ * the step of an operation in progress). The region is read from interrupt
+ * context with no lock, so keep it valid for as long as it is watched and
+ * lay it out so a torn read is detectable (a sequence number, a checksum).
+ *
+ * @param id    Caller-chosen, non-zero, unique among the watched regions
+ * @param data  Region to copy; must stay valid until unwatched
+ * @param len   1..CRASH_DIAG_BROWNOUT_BLOB_MAX bytes
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM when all slots are taken
+ */
+esp_err_t crash_diag_brownout_watch(uint8_t id, const void *data, size_t len);
+
+/**
+ * Stop copying a region on brownout.
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND
+ */
+esp_err_t crash_diag_brownout_unwatch(uint8_t id);
+
+/**
+ * Get the brownout that ended the previous boot.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NOT_FOUND if the previous boot
+ *         did not end in a brownout caught by the detector interrupt
+ */
+esp_err_t crash_diag_get_brownout(crash_diag_brownout_t *out);
+
+/**
+ * Get a blob saved by the brownout that ended the previous boot, so its
+ * owner can reconcile: re-apply the setting, resume or roll back the step.
+ *
+ * @param id   As passed to crash_diag_brownout_watch()
+ * @param out  Receives up to `max` bytes
+ * @param len  Saved length (may exceed max)
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NOT_FOUND
+ */
+esp_err_t crash_diag_brownout_blob(uint8_t id, void *out, size_t max, size_t *len);
+
+/**
+ * Erase the crash history from RAM and NVS.
+ *
+ * @return ESP_OK or the NVS error
+ */
+esp_err_t crash_diag_clear_history(void);
+
 #ifdef __cplusplus
 }
 #endif
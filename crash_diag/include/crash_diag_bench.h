@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: MIT
+#pragma once
+
+/**
+ * @file crash_diag_bench.h
+ * @brief `bench` cases comparing the JSON and CBOR diagnostics encodings
+ *
+ * Built with CONFIG_CRASH_DIAG_JSON. Both cases serialise every section
+ * (CRASH_DIAG_CBOR_ALL), so `bench diag` compares the encodings alone:
+ *
+ *   diag-json   crash_diag_json_add() + cJSON_PrintUnformatted() + free, the
+ *               same build as GET /api/diag without web_server_base's fields
+ *   diag-cbor   crash_diag_encode_cbor() into a static 4 KiB buffer; setup
+ *               fails the case if the data does not fit
+ *
+ * crash_diag does not depend on cli_framework: the run functions below have
+ * CliBenchCase signatures, and crash_diag_bench_add() is compiled in the
+ * caller, which already uses the CLI:
+ *
+ *   crash_diag_bench_add();
+ *   CliBench::register_command();
+ */
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void      crash_diag_bench_json(void *ctx);
+esp_err_t crash_diag_bench_cbor_setup(void *ctx);
+void      crash_diag_bench_cbor(void *ctx);
+
+#ifdef __cplusplus
+}
+
+#include "cli_bench.hpp"
+
+/**
+ * Add diag-json and diag-cbor to the CliBench table.
+ * ESP_ERR_NO_MEM if the table is full.
+ */
+inline esp_err_t crash_diag_bench_add()
+{
+    static const CliBenchCase cases[] = {
+        { "diag-json", "crash_diag_json_add(ALL) + print + free, as GET /api/diag",
+          nullptr, crash_diag_bench_json, nullptr, nullptr },
+        { "diag-cbor", "crash_diag_encode_cbor(ALL) into a static buffer",
+          crash_diag_bench_cbor_setup, crash_diag_bench_cbor, nullptr, nullptr },
+    };
+    for (const CliBenchCase& b : cases) {
+        esp_err_t err = CliBench::add(b);
+        if (err != ESP_OK) return err;
+    }
+    return ESP_OK;
+}
+#endif
@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: MIT
+#pragma once
+
+/**
+ * @file crash_diag_cbor.h
+ * @brief Compact CBOR (RFC 8949) encoding of the diagnostics
+ *
+ * The same data /api/diag returns as JSON, as a CBOR map with small integer
+ * keys and positional arrays instead of named objects. A typical healthy
+ * device encodes its summary, heap and task tables in a few hundred bytes,
+ * several times smaller than the JSON, and nothing is allocated: the writer
+ * fills a caller buffer, and a sink callback can drain it whenever it fills
+ * (HTTP chunked responses) so the buffer only needs to be a few hundred bytes.
+ *
+ * Into a flat buffer, e.g. for nvs_set_blob() or a Zigbee long octet string
+ * (whose first two bytes are the little-endian length):
+ *
+ *   uint8_t buf[256];
+ *   size_t len;
+ *   if (crash_diag_encode_cbor(buf + 2, sizeof(buf) - 2,
+ *                              CRASH_DIAG_CBOR_SUMMARY | CRASH_DIAG_CBOR_STALL, &len) == ESP_OK) {
+ *       buf[0] = len & 0xFF;
+ *       buf[1] = len >> 8;
+ *   }
+ *
+ * ESP_ERR_INVALID_SIZE means the buffer was too small, and `len` is then the
+ * size it needed.
+ *
+ * Top-level map (keys 32 and up are left to the application):
+ *
+ *   0  format version (1)
+ *   1  boot_count             2  reset_reason        3  last_uptime_sec
+ *   4  min_free_heap          5  uptime_sec (now)
+ *   6  crashes, newest first: [[boot, uptime_sec, reset_reason, flags, task, [pc, ...]], ...]
+ *   7  heap: [free_internal, largest_internal, min_free_internal, free_dma, largest_dma,
+ *             alloc_fail_count, alloc_fail_max_size, [[size, caps, uptime_sec], ...]]
+ *   8  heap samples, oldest first: [[uptime_sec, free_internal, largest_internal,
+ *                                    free_dma_kb, alloc_fails], ...]
+ *   9  tasks: [[name, min_stack_free, cpu_permille, priority, alive], ...]
+ *   10 previous boot's offenders: [boot, uptime_sec, [[name, min_stack_free], ...],
+ *                                  [[name, cpu_permille], ...]]
+ *   11 this boot's profile, 12 the previous one: [boot, fw_version, [ms | null per phase]]
+ *   13 last stall: [boot, uptime_sec, task, stack_free | null, cpu,
+ *                   [[ts_us, id, core, arg0, arg1], ...]]
+ *   14 brownout that ended the previous boot: [boot, uptime_ms, [blob_id, ...]]
+ *   15 safe mode (bool, with the summary)
+ *
+ * Entries whose data is missing (no previous boot profile, no stall or brownout, task
+ * sampler off) are left out rather than sent empty.
+ */
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Bumped when a key changes meaning or an array changes layout */
+#define CRASH_DIAG_CBOR_VERSION 1
+
+/** Top-level keys */
+enum {
+    CRASH_DIAG_CBOR_KEY_VERSION = 0,
+    CRASH_DIAG_CBOR_KEY_BOOT_COUNT,
+    CRASH_DIAG_CBOR_KEY_RESET_REASON,
+    CRASH_DIAG_CBOR_KEY_LAST_UPTIME,
+    CRASH_DIAG_CBOR_KEY_MIN_FREE_HEAP,
+    CRASH_DIAG_CBOR_KEY_UPTIME,
+    CRASH_DIAG_CBOR_KEY_CRASHES,
+    CRASH_DIAG_CBOR_KEY_HEAP,
+    CRASH_DIAG_CBOR_KEY_HEAP_SAMPLES,
+    CRASH_DIAG_CBOR_KEY_TASKS,
+    CRASH_DIAG_CBOR_KEY_PREV_TASKS,
+    CRASH_DIAG_CBOR_KEY_BOOT_PROFILE,
+    CRASH_DIAG_CBOR_KEY_PREV_BOOT_PROFILE,
+    CRASH_DIAG_CBOR_KEY_LAST_STALL,
+    CRASH_DIAG_CBOR_KEY_BROWNOUT,
+    CRASH_DIAG_CBOR_KEY_SAFE_MODE,
+    CRASH_DIAG_CBOR_KEY_APP = 32,       /**< First key free for the application */
+};
+
+/** Sections for crash_diag_encode_cbor(); the version key is always written */
+#define CRASH_DIAG_CBOR_SUMMARY      0x01   /**< Keys 1-5 and 15 (crash_diag_data_t, uptime, safe mode) */
+#define CRASH_DIAG_CBOR_HISTORY      0x02   /**< Key 6 */
+#define CRASH_DIAG_CBOR_HEAP         0x04   /**< Key 7 */
+#define CRASH_DIAG_CBOR_HEAP_SAMPLES 0x08   /**< Key 8 (up to ~1 KB) */
+#define CRASH_DIAG_CBOR_TASKS        0x10   /**< Keys 9 and 10 */
+#define CRASH_DIAG_CBOR_BOOT         0x20   /**< Keys 11 and 12 */
+#define CRASH_DIAG_CBOR_STALL        0x40   /**< Key 13 */
+#define CRASH_DIAG_CBOR_BROWNOUT     0x80   /**< Key 14 */
+#define CRASH_DIAG_CBOR_ALL          0xFF
+
+/**
+ * Called with the buffered bytes when the writer's buffer is full, and by
+ * crash_diag_cbor_finish(). A non-ESP_OK return stops the encoding.
+ */
+typedef esp_err_t (*crash_diag_cbor_sink_t)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * Writer state. Errors are sticky: every call after the first failure is a
+ * no-op apart from counting, and crash_diag_cbor_finish() reports it.
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t   cap;
+    size_t   len;                   /**< Bytes in buf not yet handed to the sink */
+    size_t   total;                 /**< Bytes encoded so far, including any that did not fit */
+    crash_diag_cbor_sink_t sink;
+    void    *sink_ctx;
+    esp_err_t err;
+} crash_diag_cbor_t;
+
+/**
+ * @brief Write into a flat buffer; overflowing it fails with ESP_ERR_INVALID_SIZE
+ */
+void crash_diag_cbor_init(crash_diag_cbor_t *w, uint8_t *buf, size_t cap);
+
+/**
+ * @brief Write through a buffer that is handed to `sink` whenever it fills
+ */
+void crash_diag_cbor_init_stream(crash_diag_cbor_t *w, uint8_t *buf, size_t cap,
+                                 crash_diag_cbor_sink_t sink, void *ctx);
+
+void crash_diag_cbor_uint(crash_diag_cbor_t *w, uint64_t v);
+void crash_diag_cbor_int(crash_diag_cbor_t *w, int64_t v);
+void crash_diag_cbor_bool(crash_diag_cbor_t *w, bool v);
+void crash_diag_cbor_null(crash_diag_cbor_t *w);
+/** UTF-8 text string, NUL-terminated */
+void crash_diag_cbor_text(crash_diag_cbor_t *w, const char *s);
+void crash_diag_cbor_bytes(crash_diag_cbor_t *w, const void *data, size_t len);
+/** Definite-length array header; `n` items follow */
+void crash_diag_cbor_array(crash_diag_cbor_t *w, size_t n);
+/** Definite-length map header; `n` key/value pairs follow */
+void crash_diag_cbor_map(crash_diag_cbor_t *w, size_t n);
+/** Indefinite-length array / map, closed by crash_diag_cbor_end() */
+void crash_diag_cbor_array_begin(crash_diag_cbor_t *w);
+void crash_diag_cbor_map_begin(crash_diag_cbor_t *w);
+void crash_diag_cbor_end(crash_diag_cbor_t *w);
+
+/**
+ * @brief Hand remaining bytes to the sink (stream mode) and report the result
+ *
+ * @param len  Optional: bytes encoded, the required size after ESP_ERR_INVALID_SIZE
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE (flat buffer too small), or the sink's error
+ */
+esp_err_t crash_diag_cbor_finish(crash_diag_cbor_t *w, size_t *len);
+
+/**
+ * @brief Write the selected sections as key/value pairs into an open map
+ *
+ * For callers adding their own keys: open the map with
+ * crash_diag_cbor_map_begin(), call this, write keys from
+ * CRASH_DIAG_CBOR_KEY_APP up, then crash_diag_cbor_end().
+ *
+ * Tables are read one row at a time, so stack use stays at a few hundred
+ * bytes whatever their size.
+ */
+void crash_diag_cbor_write_fields(crash_diag_cbor_t *w, uint32_t sections);
+
+/**
+ * @brief Encode the selected sections as one complete map into `buf`
+ *
+ * @param sections  CRASH_DIAG_CBOR_* flags
+ * @param len       Bytes written, or the size needed when the result is ESP_ERR_INVALID_SIZE
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_SIZE
+ */
+esp_err_t crash_diag_encode_cbor(uint8_t *buf, size_t cap, uint32_t sections, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
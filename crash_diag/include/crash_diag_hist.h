@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: MIT
+#pragma once
+
+/**
+ * @file crash_diag_hist.h
+ * @brief Fixed-size log-linear latency histogram
+ *
+ * HDR-style buckets: values below 16 are exact, and above that every power of
+ * two is split into 8 linear sub-buckets. A percentile is reported as the
+ * middle of its bucket, so it is within 1/16 (6.25 %) of the true sample
+ * value. Values are unsigned 32-bit, normally microseconds, and are counted
+ * exactly up to CRASH_DIAG_HIST_MAX_VALUE (~16.7 s); larger ones go into the
+ * top bucket, and `max` still records them exactly.
+ *
+ * Recording is a count-leading-zeros, a few integer operations and a short
+ * critical section. It takes constant time, does not allocate and is safe
+ * from ISRs. A zero-initialised histogram is ready to use:
+ *
+ *   static crash_diag_hist_t s_nvs_write_us;
+ *
+ *   int64_t t0 = esp_timer_get_time();
+ *   nvs_commit(h);
+ *   crash_diag_hist_record(&s_nvs_write_us, (uint32_t)(esp_timer_get_time() - t0));
+ *
+ *   crash_diag_hist_summary_t s;
+ *   crash_diag_hist_summary(&s_nvs_write_us, &s);   // s.p50, s.p99, ...
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** log2 of the linear sub-buckets per power of two */
+#define CRASH_DIAG_HIST_SUB_BITS   3
+#define CRASH_DIAG_HIST_SUB_COUNT  (1u << CRASH_DIAG_HIST_SUB_BITS)
+/** Highest value counted exactly (2^24 - 1 µs ~ 16.7 s) */
+#define CRASH_DIAG_HIST_MAX_BITS   24
+#define CRASH_DIAG_HIST_MAX_VALUE  ((1u << CRASH_DIAG_HIST_MAX_BITS) - 1)
+/** Bucket count: exact range plus SUB_COUNT per octave up to MAX_BITS */
+#define CRASH_DIAG_HIST_BUCKETS \
+    ((CRASH_DIAG_HIST_MAX_BITS - CRASH_DIAG_HIST_SUB_BITS + 1) * CRASH_DIAG_HIST_SUB_COUNT)
+
+/**
+ * Histogram (720 bytes). Zero-initialise, or call crash_diag_hist_reset().
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[CRASH_DIAG_HIST_BUCKETS];
+} crash_diag_hist_t;
+
+/**
+ * Extracted statistics; all zero for an empty histogram
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t mean;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t max;
+} crash_diag_hist_summary_t;
+
+/** Add one value. Constant time, no allocation, ISR-safe. */
+void crash_diag_hist_record(crash_diag_hist_t *h, uint32_t value);
+
+/** Clear all counts */
+void crash_diag_hist_reset(crash_diag_hist_t *h);
+
+/**
+ * Copy a consistent snapshot, for reading while other tasks record.
+ *
+ * @param reset  Also clear h, so consecutive snapshots cover disjoint windows
+ */
+void crash_diag_hist_snapshot(crash_diag_hist_t *h, crash_diag_hist_t *out, bool reset);
+
+/** Add src's counts into dst (e.g. per-handler histograms into a total) */
+void crash_diag_hist_merge(crash_diag_hist_t *dst, const crash_diag_hist_t *src);
+
+/**
+ * Value at a percentile.
+ *
+ * @param permille  0..1000 (500 = median, 990 = p99)
+ * @return Bucket midpoint, never above the recorded max; 0 if empty
+ */
+uint32_t crash_diag_hist_percentile(const crash_diag_hist_t *h, uint32_t permille);
+
+/**
+ * count, mean, p50, p90, p99 and max in one pass. Reads h without locking:
+ * pass a snapshot if other tasks may be recording.
+ */
+void crash_diag_hist_summary(const crash_diag_hist_t *h, crash_diag_hist_summary_t *out);
+
+#ifdef __cplusplus
+}
+#endif
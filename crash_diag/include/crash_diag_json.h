@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: MIT
+#pragma once
+
+/**
+ * @file crash_diag_json.h
+ * @brief cJSON encoding of the diagnostics (CONFIG_CRASH_DIAG_JSON)
+ *
+ * The JSON form of the data crash_diag_cbor.h encodes, with named objects
+ * instead of integer keys. GET /api/diag is built with it, and the sections
+ * are the CRASH_DIAG_CBOR_* flags, so both encodings of one selection carry
+ * the same data:
+ *
+ *   cJSON *root = cJSON_CreateObject();
+ *   crash_diag_json_add(root, CRASH_DIAG_CBOR_ALL);
+ *   char *str = cJSON_PrintUnformatted(root);
+ *
+ * Fields added per section:
+ *
+ *   SUMMARY       boot_count, reset_reason, reset_reason_str, last_uptime_sec,
+ *                 min_free_heap, uptime_sec, safe_mode
+ *   HISTORY       crashes: [{boot, uptime_sec, reset_reason, task, panic, backtrace: ["0x..."]}]
+ *   HEAP          heap: {free_internal, largest_internal, min_free_internal, free_dma,
+ *                        largest_dma, frag_pct, alloc_fail_count, alloc_fail_max_size,
+ *                        recent_fails: [{size, caps, uptime_sec}]}
+ *   HEAP_SAMPLES  heap.samples: [[uptime_sec, free_internal, largest_internal,
+ *                                 free_dma_kb, alloc_fails]]
+ *   TASKS         tasks: [{name, min_stack_free, cpu_permille, prio, alive}],
+ *                 prev_boot_tasks: {boot, uptime_sec, stack: [{name, min_stack_free}],
+ *                                   cpu: [{name, cpu_permille}]}
+ *   BOOT          boot_profile: {current, previous: {boot, fw_version, phases_ms: {phase: ms}}}
+ *   STALL         last_stall: {boot, uptime_sec, task, stack_free, trace: [[ts_us, id, core, arg0, arg1]]}
+ *   BROWNOUT      last_brownout: {boot, uptime_ms, blobs: [id]}
+ *
+ * As in the CBOR form, data that does not exist (no previous boot profile,
+ * stall or brownout, task sampler not built) is left out. Tables are read a
+ * row at a time, so nothing large goes on the caller's stack.
+ */
+
+#include "crash_diag_cbor.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct cJSON;
+
+/**
+ * Add the selected sections (CRASH_DIAG_CBOR_* flags) to a cJSON object.
+ * Items cJSON fails to allocate are left out.
+ */
+void crash_diag_json_add(struct cJSON *root, uint32_t sections);
+
+#ifdef __cplusplus
+}
+#endif
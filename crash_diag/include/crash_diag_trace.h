@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: MIT
+#pragma once
+
+/**
+ * @file crash_diag_trace.h
+ * @brief Lightweight event trace that survives panic and watchdog resets
+ *
+ * CD_TRACE(id, arg0, arg1) appends a 16-byte event (timestamp, id, two
+ * arguments) to a per-core ring in RTC_NOINIT memory. Slots are claimed with
+ * an atomic increment, so it takes no lock and is safe from tasks and ISRs;
+ * an emit is a timer read, an atomic increment and a few stores.
+ *
+ * Events emitted before crash_diag_init() are dropped: until then the ring
+ * still holds the previous boot's trace. If that boot ended in a panic,
+ * watchdog or brownout reset, init keeps a copy, readable with
+ * crash_diag_get_trace(..., true).
+ *
+ * With CONFIG_CRASH_DIAG_TRACE off, CD_TRACE() expands to nothing and the
+ * arguments are not evaluated.
+ */
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Trace IDs: high byte is the source, low byte the event. 0 is reserved. */
+#define CD_TRACE_BROWNOUT     0x0001    /**< arg0 watched blobs saved (crash_diag) */
+#define CD_TRACE_WIFI_EVENT   0x0101    /**< arg0 event_id, arg1 0 = WIFI_EVENT, 1 = IP_EVENT */
+#define CD_TRACE_WIFI_DISC    0x0102    /**< arg0 disconnect reason, arg1 retry count */
+#define CD_TRACE_ZB_SIGNAL    0x0201    /**< arg0 ZDO/BDB signal, arg1 esp_err_t status */
+#define CD_TRACE_HTTP_BEGIN   0x0301    /**< arg0 HTTP method, arg1 handler index */
+#define CD_TRACE_HTTP_END     0x0302    /**< arg0 esp_err_t result, arg1 handler index */
+#define CD_TRACE_APP_BASE     0x8000    /**< 0x8000-0xFFFF are free for the application */
+
+/**
+ * One trace event (16 bytes)
+ */
+typedef struct {
+    uint32_t ts_us;     /**< esp_timer time, low 32 bits (wraps after ~71 min) */
+    uint16_t id;
+    uint8_t  core;
+    uint8_t  reserved;
+    uint32_t arg0;
+    uint32_t arg1;
+} crash_diag_trace_event_t;
+
+#if CONFIG_CRASH_DIAG_TRACE
+#define CD_TRACE(id, arg0, arg1) crash_diag_trace((id), (uint32_t)(arg0), (uint32_t)(arg1))
+#else
+#define CD_TRACE(id, arg0, arg1) do { } while (0)
+#endif
+
+/**
+ * Append an event; use CD_TRACE() so disabled builds drop the call.
+ */
+void crash_diag_trace(uint16_t id, uint32_t arg0, uint32_t arg1);
+
+/**
+ * Get the newest trace events, oldest first (cores merged by timestamp).
+ *
+ * @param[out] out            Array of at least max entries
+ * @param      max            Capacity of out
+ * @param[out] count          Number of entries written
+ * @param      previous_boot  true: the trace left by a boot that ended in a
+ *                            panic, watchdog or brownout reset; false: this boot so far
+ * @return ESP_OK, ESP_ERR_INVALID_ARG,
+ *         ESP_ERR_NOT_FOUND if the previous boot did not crash (or power was lost),
+ *         ESP_ERR_NOT_SUPPORTED with CONFIG_CRASH_DIAG_TRACE off
+ */
+esp_err_t crash_diag_get_trace(crash_diag_trace_event_t *out, size_t max, size_t *count,
+                               bool previous_boot);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,8 +1,11 @@
 // SPDX-License-Identifier: MIT
 #include "crash_diag.h"
+#include "crash_diag_priv.h"
 
+#include "esp_attr.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "esp_heap_caps.h"
 #include "nvs_flash.h"
 #include "nvs.h"
@@ -10,8 +13,6 @@
 
 static const char *TAG = "crash_diag";
 
-/* NVS namespace for crash diagnostics (separate from main app config) */
-#define CRASH_DIAG_NVS_NAMESPACE "crash_diag"
 #define CRASH_DIAG_NVS_BOOT_COUNT "boot_count"
 
 /**
@@ -35,6 +36,8 @@ typedef struct {
 
 static RTC_NOINIT_ATTR rtc_diag_data_t rtc_data;
 static crash_diag_data_t s_current_diag;
+static esp_timer_handle_t s_uptime_timer;
+static bool s_safe_mode;
 
 /* ================================================================== */
 /*  Internal helpers                                                   */
@@ -78,13 +81,58 @@ static esp_err_t load_and_increment_boot_count(uint32_t *out_count)
     return ESP_OK;
 }
 
+static void uptime_timer_cb(void *arg)
+{
+    (void)arg;
+    rtc_data.uptime_sec = (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+static esp_err_t start_uptime_timer(uint32_t period_sec)
+{
+    if (period_sec == 0 || s_uptime_timer) {
+        return ESP_OK;
+    }
+    /* skip_unhandled_events keeps this timer out of the light-sleep wakeup
+     * calculation: it only runs when something else woke the chip */
+    const esp_timer_create_args_t args = {
+        .callback = uptime_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "crash_diag_up",
+        .skip_unhandled_events = true,
+    };
+    esp_err_t err = esp_timer_create(&args, &s_uptime_timer);
+    if (err == ESP_OK) {
+        err = esp_timer_start_periodic(s_uptime_timer, (uint64_t)period_sec * 1000000);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Uptime timer unavailable: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+void IRAM_ATTR crash_diag_rtc_uptime_now(void)
+{
+    rtc_data.uptime_sec = (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
 /* ================================================================== */
 /*  Public API                                                         */
 /* ================================================================== */
 
 esp_err_t crash_diag_init(void)
 {
+    return crash_diag_init_ex(NULL);
+}
+
+esp_err_t crash_diag_init_ex(const crash_diag_config_t *config)
+{
+    const crash_diag_config_t defaults = CRASH_DIAG_CONFIG_DEFAULT();
+    if (!config) {
+        config = &defaults;
+    }
+
     memset(&s_current_diag, 0, sizeof(s_current_diag));
+    crash_diag_mark(CRASH_DIAG_PHASE_DIAG_INIT);
 
     esp_reset_reason_t reset_reason = esp_reset_reason();
 
@@ -113,12 +161,36 @@ esp_err_t crash_diag_init(void)
 
     s_current_diag.min_free_heap = esp_get_minimum_free_heap_size();
 
+    uint32_t prev_boot = rtc_valid ? rtc_data.boot_count_copy
+                                   : (s_current_diag.boot_count ? s_current_diag.boot_count - 1 : 0);
+    crash_diag_history_init((uint8_t)reset_reason, s_current_diag.boot_count,
+                            prev_boot, s_current_diag.last_uptime_sec);
+
+    if (config->safe_mode_crashes) {
+        uint8_t streak = crash_diag_history_crash_streak(prev_boot, config->safe_mode_uptime_sec);
+        s_safe_mode = streak >= config->safe_mode_crashes;
+        if (s_safe_mode) {
+            ESP_LOGE(TAG, "Crash loop: the last %u boots crashed within %lu s, starting in safe mode",
+                     streak, config->safe_mode_uptime_sec);
+        }
+    }
+
     /* Prepare RTC memory for next boot */
     rtc_data.magic           = RTC_DIAG_MAGIC;
     rtc_data.reset_reason    = (uint8_t)reset_reason;
     rtc_data.uptime_sec      = 0;
     rtc_data.boot_count_copy = s_current_diag.boot_count;
 
+    crash_diag_boot_init(s_current_diag.boot_count);
+    crash_diag_trace_init((uint8_t)reset_reason);
+    crash_diag_stall_init(s_current_diag.boot_count, prev_boot);
+    crash_diag_brownout_init(s_current_diag.boot_count, (uint8_t)reset_reason);
+
+    /* Not fatal: crash_diag_update_uptime() and the panic hook still work */
+    start_uptime_timer(config->uptime_period_sec);
+    crash_diag_heap_init(config->heap_period_sec);
+    crash_diag_tasks_init(config->task_period_sec, s_current_diag.boot_count);
+
     return ESP_OK;
 }
 
@@ -132,6 +204,11 @@ esp_err_t crash_diag_get_data(crash_diag_data_t *data)
     return ESP_OK;
 }
 
+bool crash_diag_in_safe_mode(void)
+{
+    return s_safe_mode;
+}
+
 const char *crash_diag_reset_reason_str(uint8_t reason)
 {
     switch ((esp_reset_reason_t)reason) {
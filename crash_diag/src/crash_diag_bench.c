@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: MIT
+#include "crash_diag_bench.h"
+#include "crash_diag_cbor.h"
+#include "crash_diag_json.h"
+
+#include "cJSON.h"
+#include <stdlib.h>
+
+static uint8_t s_cbor[4096];
+
+void crash_diag_bench_json(void *ctx)
+{
+    (void)ctx;
+    cJSON *root = cJSON_CreateObject();
+    if (!root) {
+        return;
+    }
+    crash_diag_json_add(root, CRASH_DIAG_CBOR_ALL);
+    char *str = cJSON_PrintUnformatted(root);
+    free(str);
+    cJSON_Delete(root);
+}
+
+esp_err_t crash_diag_bench_cbor_setup(void *ctx)
+{
+    (void)ctx;
+    size_t len;
+    return crash_diag_encode_cbor(s_cbor, sizeof(s_cbor), CRASH_DIAG_CBOR_ALL, &len);
+}
+
+void crash_diag_bench_cbor(void *ctx)
+{
+    (void)ctx;
+    size_t len;
+    crash_diag_encode_cbor(s_cbor, sizeof(s_cbor), CRASH_DIAG_CBOR_ALL, &len);
+}
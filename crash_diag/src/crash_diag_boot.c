@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: MIT
+#include "crash_diag_priv.h"
+
+#include "esp_app_desc.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static const char *TAG = "crash_diag";
+
+/**
+ * Phase table of the running boot, mirrored to RTC memory so the next boot
+ * can report it. RTC_NOINIT like the other crash_diag RTC blocks: survives
+ * panics, watchdogs and software resets, not power loss.
+ */
+typedef struct {
+    uint32_t magic;
+    crash_diag_boot_profile_t profile;
+} rtc_boot_data_t;
+
+#define RTC_BOOT_MAGIC 0xB0075EED
+
+static RTC_NOINIT_ATTR rtc_boot_data_t s_rtc;
+static crash_diag_boot_profile_t s_cur;
+static crash_diag_boot_profile_t s_prev;
+static bool s_prev_valid;
+static bool s_mirror;   /* s_rtc belongs to this boot (set by crash_diag_boot_init) */
+
+static const char *const s_phase_names[CRASH_DIAG_PHASE_COUNT] = {
+    [CRASH_DIAG_PHASE_APP_MAIN]    = "app_main",
+    [CRASH_DIAG_PHASE_DIAG_INIT]   = "diag_init",
+    [CRASH_DIAG_PHASE_WIFI_START]  = "wifi_start",
+    [CRASH_DIAG_PHASE_WIFI_GOT_IP] = "wifi_ip",
+    [CRASH_DIAG_PHASE_HTTP_READY]  = "http_ready",
+    [CRASH_DIAG_PHASE_ZB_STACK_UP] = "zb_stack_up",
+    [CRASH_DIAG_PHASE_ZB_STEERING] = "zb_steering",
+    [CRASH_DIAG_PHASE_ZB_JOINED]   = "zb_joined",
+    [CRASH_DIAG_PHASE_APP_READY]   = "app_ready",
+    [CRASH_DIAG_PHASE_USER_0]      = "user0",
+    [CRASH_DIAG_PHASE_USER_1]      = "user1",
+    [CRASH_DIAG_PHASE_USER_2]      = "user2",
+    [CRASH_DIAG_PHASE_USER_3]      = "user3",
+};
+
+void crash_diag_boot_init(uint32_t boot_count)
+{
+    if (s_rtc.magic == RTC_BOOT_MAGIC) {
+        s_prev = s_rtc.profile;
+        s_prev.fw_version[sizeof(s_prev.fw_version) - 1] = '\0';
+        s_prev_valid = true;
+    }
+
+    s_cur.boot_count = boot_count;
+    const esp_app_desc_t *app = esp_app_get_description();
+    strncpy(s_cur.fw_version, app->version, sizeof(s_cur.fw_version) - 1);
+
+    s_rtc.magic = 0;
+    s_rtc.profile = s_cur;
+    s_rtc.magic = RTC_BOOT_MAGIC;
+    s_mirror = true;
+
+    if (s_prev_valid) {
+        const uint32_t *p = s_prev.at_us;
+        ESP_LOGI(TAG, "Previous boot (%s): wifi_ip %lu ms, http_ready %lu ms, zb_joined %lu ms",
+                 s_prev.fw_version,
+                 p[CRASH_DIAG_PHASE_WIFI_GOT_IP] / 1000, p[CRASH_DIAG_PHASE_HTTP_READY] / 1000,
+                 p[CRASH_DIAG_PHASE_ZB_JOINED] / 1000);
+    }
+}
+
+/* ================================================================== */
+/*  Public API                                                         */
+/* ================================================================== */
+
+void crash_diag_mark(crash_diag_phase_t phase)
+{
+    if ((unsigned)phase >= CRASH_DIAG_PHASE_COUNT || s_cur.at_us[phase]) {
+        return;
+    }
+    /* 32-bit microseconds cover the first 71 minutes, plenty for boot;
+     * 0 means "not reached", so a mark at t=0 is nudged to 1 */
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    s_cur.at_us[phase] = now ? now : 1;
+    if (s_mirror) {
+        s_rtc.profile.at_us[phase] = s_cur.at_us[phase];
+    }
+}
+
+esp_err_t crash_diag_get_boot_profile(crash_diag_boot_profile_t *out, bool previous_boot)
+{
+    if (!out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (previous_boot) {
+        if (!s_prev_valid) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        *out = s_prev;
+        return ESP_OK;
+    }
+    *out = s_cur;
+    return ESP_OK;
+}
+
+const char *crash_diag_phase_name(crash_diag_phase_t phase)
+{
+    if ((unsigned)phase >= CRASH_DIAG_PHASE_COUNT) {
+        return "unknown";
+    }
+    return s_phase_names[phase];
+}
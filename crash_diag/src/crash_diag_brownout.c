@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: MIT
+#include "crash_diag_priv.h"
+#include "crash_diag_trace.h"
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_private/system_internal.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+static const char *TAG = "crash_diag";
+
+/**
+ * State saved by the brownout interrupt (RTC_NOINIT, see crash_diag.c).
+ * Cleared at every boot, so a valid block always belongs to the boot that
+ * just ended.
+ */
+typedef struct {
+    uint8_t id;
+    uint8_t len;
+    uint8_t data[CRASH_DIAG_BROWNOUT_BLOB_MAX];
+} brownout_blob_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t boot_count;
+    uint32_t uptime_ms;
+    uint8_t  count;
+    uint8_t  reserved[3];
+    brownout_blob_t blob[CRASH_DIAG_BROWNOUT_BLOBS];
+} rtc_brownout_t;
+
+#define RTC_BROWNOUT_MAGIC 0xB0DEAD00
+
+static RTC_NOINIT_ATTR rtc_brownout_t s_rtc;
+static rtc_brownout_t s_last;           /* previous boot's block, if it browned out */
+static bool s_last_valid;
+static uint32_t s_boot_count;
+
+/* Watched regions. Read lock-free by the interrupt: a slot's id is set last
+ * when it is added and cleared first when it is removed. */
+typedef struct {
+    uint8_t     id;
+    uint8_t     len;
+    const void *data;
+} watch_t;
+
+static watch_t s_watch[CRASH_DIAG_BROWNOUT_BLOBS];
+static portMUX_TYPE s_watch_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* ================================================================== */
+/*  Brownout interrupt hook                                            */
+/* ================================================================== */
+
+/* Runs in the detector's IRAM interrupt with the supply already sagging:
+ * RTC stores only, nothing that can touch flash or block */
+static void IRAM_ATTR save_state(void)
+{
+    s_rtc.magic = 0;
+    s_rtc.boot_count = s_boot_count;
+    s_rtc.uptime_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    uint8_t n = 0;
+    for (int i = 0; i < CRASH_DIAG_BROWNOUT_BLOBS; i++) {
+        const watch_t *w = &s_watch[i];
+        if (w->id) {
+            brownout_blob_t *b = &s_rtc.blob[n++];
+            b->id = w->id;
+            b->len = w->len;
+            memcpy(b->data, w->data, w->len);
+        }
+    }
+    s_rtc.count = n;
+    s_rtc.magic = RTC_BROWNOUT_MAGIC;
+    crash_diag_rtc_uptime_now();
+    CD_TRACE(CD_TRACE_BROWNOUT, n, 0);
+}
+
+void __real_esp_reset_reason_set_hint(esp_reset_reason_t hint);
+
+/* The brownout ISR sets this hint right before esp_restart_noos() */
+void IRAM_ATTR __wrap_esp_reset_reason_set_hint(esp_reset_reason_t hint)
+{
+    if (hint == ESP_RST_BROWNOUT) {
+        save_state();
+    }
+    __real_esp_reset_reason_set_hint(hint);
+}
+
+/* ================================================================== */
+/*  Boot                                                               */
+/* ================================================================== */
+
+void crash_diag_brownout_init(uint32_t boot_count, uint8_t reset_reason)
+{
+    s_boot_count = boot_count;
+    if (s_rtc.magic == RTC_BROWNOUT_MAGIC && reset_reason == ESP_RST_BROWNOUT &&
+        s_rtc.count <= CRASH_DIAG_BROWNOUT_BLOBS) {
+        s_last = s_rtc;
+        s_last_valid = true;
+        ESP_LOGW(TAG, "Brownout in boot #%lu at %lu ms, %u state blob(s) saved",
+                 s_last.boot_count, s_last.uptime_ms, s_last.count);
+    }
+    s_rtc.magic = 0;
+}
+
+/* ================================================================== */
+/*  Public API                                                         */
+/* ================================================================== */
+
+esp_err_t crash_diag_brownout_watch(uint8_t id, const void *data, size_t len)
+{
+    if (id == 0 || !data || len == 0 || len > CRASH_DIAG_BROWNOUT_BLOB_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&s_watch_lock);
+    watch_t *slot = NULL;
+    for (int i = 0; i < CRASH_DIAG_BROWNOUT_BLOBS; i++) {
+        if (s_watch[i].id == id) {
+            slot = NULL;
+            err = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        if (!s_watch[i].id && !slot) {
+            slot = &s_watch[i];
+        }
+    }
+    if (slot) {
+        slot->data = data;
+        slot->len = (uint8_t)len;
+        slot->id = id;
+        err = ESP_OK;
+    }
+    portEXIT_CRITICAL(&s_watch_lock);
+    return err;
+}
+
+esp_err_t crash_diag_brownout_unwatch(uint8_t id)
+{
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&s_watch_lock);
+    for (int i = 0; id && i < CRASH_DIAG_BROWNOUT_BLOBS; i++) {
+        if (s_watch[i].id == id) {
+            s_watch[i].id = 0;
+            err = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_watch_lock);
+    return err;
+}
+
+esp_err_t crash_diag_get_brownout(crash_diag_brownout_t *out)
+{
+    if (!out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_last_valid) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    memset(out, 0, sizeof(*out));
+    out->boot_count = s_last.boot_count;
+    out->uptime_ms = s_last.uptime_ms;
+    out->blob_count = s_last.count;
+    for (uint8_t i = 0; i < s_last.count; i++) {
+        out->blob_ids[i] = s_last.blob[i].id;
+    }
+    return ESP_OK;
+}
+
+esp_err_t crash_diag_brownout_blob(uint8_t id, void *out, size_t max, size_t *len)
+{
+    if (!len || (max && !out)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (uint8_t i = 0; s_last_valid && i < s_last.count; i++) {
+        const brownout_blob_t *b = &s_last.blob[i];
+        if (b->id == id) {
+            size_t saved = b->len < CRASH_DIAG_BROWNOUT_BLOB_MAX ? b->len : CRASH_DIAG_BROWNOUT_BLOB_MAX;
+            memcpy(out, b->data, saved < max ? saved : max);
+            *len = saved;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
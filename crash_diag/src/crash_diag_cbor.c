@@ -0,0 +1,413 @@
+// SPDX-License-Identifier: MIT
+#include "crash_diag_cbor.h"
+#include "crash_diag_priv.h"
+
+#include "esp_timer.h"
+#include <string.h>
+
+/* CBOR major types (RFC 8949 §3.1), pre-shifted into the initial byte */
+#define MT_UINT   0x00
+#define MT_NEG    0x20
+#define MT_BYTES  0x40
+#define MT_TEXT   0x60
+#define MT_ARRAY  0x80
+#define MT_MAP    0xA0
+
+#define CBOR_FALSE      0xF4
+#define CBOR_TRUE       0xF5
+#define CBOR_NULL       0xF6
+#define CBOR_INDEF_ARR  0x9F
+#define CBOR_INDEF_MAP  0xBF
+#define CBOR_BREAK      0xFF
+
+/* ================================================================== */
+/*  Writer                                                             */
+/* ================================================================== */
+
+static void put(crash_diag_cbor_t *w, const void *data, size_t n)
+{
+    const uint8_t *p = data;
+    w->total += n;
+    while (n && w->err == ESP_OK) {
+        if (w->len == w->cap) {
+            if (!w->sink) {
+                w->err = ESP_ERR_INVALID_SIZE;
+                break;
+            }
+            w->err = w->sink(w->sink_ctx, w->buf, w->len);
+            w->len = 0;
+            continue;
+        }
+        size_t k = w->cap - w->len < n ? w->cap - w->len : n;
+        memcpy(w->buf + w->len, p, k);
+        w->len += k;
+        p += k;
+        n -= k;
+    }
+}
+
+static void put_byte(crash_diag_cbor_t *w, uint8_t b)
+{
+    put(w, &b, 1);
+}
+
+/* Initial byte plus the shortest big-endian argument that holds v */
+static void head(crash_diag_cbor_t *w, uint8_t major, uint64_t v)
+{
+    uint8_t h[9];
+    size_t n;
+    if (v < 24) {
+        h[0] = (uint8_t)(major | v);
+        n = 1;
+    } else if (v <= UINT8_MAX) {
+        h[0] = major | 24;
+        n = 2;
+    } else if (v <= UINT16_MAX) {
+        h[0] = major | 25;
+        n = 3;
+    } else if (v <= UINT32_MAX) {
+        h[0] = major | 26;
+        n = 5;
+    } else {
+        h[0] = major | 27;
+        n = 9;
+    }
+    for (size_t i = n - 1; i > 0; i--) {
+        h[i] = (uint8_t)v;
+        v >>= 8;
+    }
+    put(w, h, n);
+}
+
+void crash_diag_cbor_init(crash_diag_cbor_t *w, uint8_t *buf, size_t cap)
+{
+    crash_diag_cbor_init_stream(w, buf, cap, NULL, NULL);
+}
+
+void crash_diag_cbor_init_stream(crash_diag_cbor_t *w, uint8_t *buf, size_t cap,
+                                 crash_diag_cbor_sink_t sink, void *ctx)
+{
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->cap = buf ? cap : 0;
+    w->sink = sink;
+    w->sink_ctx = ctx;
+    if (sink && w->cap == 0) {
+        w->err = ESP_ERR_INVALID_ARG;
+    }
+}
+
+void crash_diag_cbor_uint(crash_diag_cbor_t *w, uint64_t v)
+{
+    head(w, MT_UINT, v);
+}
+
+void crash_diag_cbor_int(crash_diag_cbor_t *w, int64_t v)
+{
+    if (v < 0) {
+        head(w, MT_NEG, (uint64_t)(-1 - v));
+    } else {
+        head(w, MT_UINT, (uint64_t)v);
+    }
+}
+
+void crash_diag_cbor_bool(crash_diag_cbor_t *w, bool v)
+{
+    put_byte(w, v ? CBOR_TRUE : CBOR_FALSE);
+}
+
+void crash_diag_cbor_null(crash_diag_cbor_t *w)
+{
+    put_byte(w, CBOR_NULL);
+}
+
+static void text_n(crash_diag_cbor_t *w, const char *s, size_t max)
+{
+    size_t n = strnlen(s, max);
+    head(w, MT_TEXT, n);
+    put(w, s, n);
+}
+
+void crash_diag_cbor_text(crash_diag_cbor_t *w, const char *s)
+{
+    text_n(w, s ? s : "", SIZE_MAX);
+}
+
+void crash_diag_cbor_bytes(crash_diag_cbor_t *w, const void *data, size_t len)
+{
+    head(w, MT_BYTES, len);
+    put(w, data, len);
+}
+
+void crash_diag_cbor_array(crash_diag_cbor_t *w, size_t n)
+{
+    head(w, MT_ARRAY, n);
+}
+
+void crash_diag_cbor_map(crash_diag_cbor_t *w, size_t n)
+{
+    head(w, MT_MAP, n);
+}
+
+void crash_diag_cbor_array_begin(crash_diag_cbor_t *w)
+{
+    put_byte(w, CBOR_INDEF_ARR);
+}
+
+void crash_diag_cbor_map_begin(crash_diag_cbor_t *w)
+{
+    put_byte(w, CBOR_INDEF_MAP);
+}
+
+void crash_diag_cbor_end(crash_diag_cbor_t *w)
+{
+    put_byte(w, CBOR_BREAK);
+}
+
+esp_err_t crash_diag_cbor_finish(crash_diag_cbor_t *w, size_t *len)
+{
+    if (w->err == ESP_OK && w->sink && w->len) {
+        w->err = w->sink(w->sink_ctx, w->buf, w->len);
+        w->len = 0;
+    }
+    if (len) {
+        *len = w->total;
+    }
+    return w->err;
+}
+
+/* ================================================================== */
+/*  Diagnostics sections (layouts documented in crash_diag_cbor.h)     */
+/* ================================================================== */
+
+static void task_name(crash_diag_cbor_t *w, const char *name)
+{
+    text_n(w, name, CRASH_DIAG_TASK_NAME_LEN);
+}
+
+static void write_summary(crash_diag_cbor_t *w)
+{
+    crash_diag_data_t d;
+    crash_diag_get_data(&d);
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_BOOT_COUNT);
+    crash_diag_cbor_uint(w, d.boot_count);
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_RESET_REASON);
+    crash_diag_cbor_uint(w, d.reset_reason);
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_LAST_UPTIME);
+    crash_diag_cbor_uint(w, d.last_uptime_sec);
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_MIN_FREE_HEAP);
+    crash_diag_cbor_uint(w, d.min_free_heap);
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_UPTIME);
+    crash_diag_cbor_uint(w, (uint64_t)(esp_timer_get_time() / 1000000));
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_SAFE_MODE);
+    crash_diag_cbor_bool(w, crash_diag_in_safe_mode());
+}
+
+static void write_history(crash_diag_cbor_t *w)
+{
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_CRASHES);
+    crash_diag_cbor_array_begin(w);
+    const crash_diag_record_t *r;
+    for (size_t i = 0; (r = crash_diag_history_at(i)) != NULL; i++) {
+        uint8_t depth = r->bt_depth < CRASH_DIAG_BT_DEPTH ? r->bt_depth : CRASH_DIAG_BT_DEPTH;
+        crash_diag_cbor_array(w, 6);
+        crash_diag_cbor_uint(w, r->boot_count);
+        crash_diag_cbor_uint(w, r->uptime_sec);
+        crash_diag_cbor_uint(w, r->reset_reason);
+        crash_diag_cbor_uint(w, r->flags);
+        task_name(w, r->task);
+        crash_diag_cbor_array(w, depth);
+        for (uint8_t k = 0; k < depth; k++) {
+            crash_diag_cbor_uint(w, r->backtrace[k]);
+        }
+    }
+    crash_diag_cbor_end(w);
+}
+
+static void write_heap(crash_diag_cbor_t *w)
+{
+    crash_diag_heap_stats_t hs;
+    crash_diag_get_heap_stats(&hs);
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_HEAP);
+    crash_diag_cbor_array(w, 8);
+    crash_diag_cbor_uint(w, hs.free_internal);
+    crash_diag_cbor_uint(w, hs.largest_internal);
+    crash_diag_cbor_uint(w, hs.min_free_internal);
+    crash_diag_cbor_uint(w, hs.free_dma);
+    crash_diag_cbor_uint(w, hs.largest_dma);
+    crash_diag_cbor_uint(w, hs.alloc_fail_count);
+    crash_diag_cbor_uint(w, hs.alloc_fail_max_size);
+    crash_diag_cbor_array(w, hs.recent_count);
+    for (uint8_t i = 0; i < hs.recent_count; i++) {
+        crash_diag_cbor_array(w, 3);
+        crash_diag_cbor_uint(w, hs.recent[i].size);
+        crash_diag_cbor_uint(w, hs.recent[i].caps);
+        crash_diag_cbor_uint(w, hs.recent[i].uptime_sec);
+    }
+}
+
+static void write_heap_samples(crash_diag_cbor_t *w)
+{
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_HEAP_SAMPLES);
+    crash_diag_cbor_array_begin(w);
+    crash_diag_heap_sample_t s;
+    for (size_t i = 0; crash_diag_heap_sample_at(i, &s); i++) {
+        crash_diag_cbor_array(w, 5);
+        crash_diag_cbor_uint(w, s.uptime_sec);
+        crash_diag_cbor_uint(w, s.free_internal);
+        crash_diag_cbor_uint(w, s.largest_internal);
+        crash_diag_cbor_uint(w, s.free_dma_kb);
+        crash_diag_cbor_uint(w, s.alloc_fails);
+    }
+    crash_diag_cbor_end(w);
+}
+
+static void write_tasks(crash_diag_cbor_t *w)
+{
+    crash_diag_task_stat_t t;
+    if (crash_diag_tasks_at(0, &t)) {
+        crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_TASKS);
+        crash_diag_cbor_array_begin(w);
+        for (size_t i = 0; crash_diag_tasks_at(i, &t); i++) {
+            crash_diag_cbor_array(w, 5);
+            task_name(w, t.name);
+            crash_diag_cbor_uint(w, t.min_stack_free);
+            crash_diag_cbor_uint(w, t.cpu_permille);
+            crash_diag_cbor_uint(w, t.priority);
+            crash_diag_cbor_bool(w, t.alive);
+        }
+        crash_diag_cbor_end(w);
+    }
+
+    crash_diag_task_offenders_t prev;
+    if (crash_diag_get_task_offenders(&prev, true) != ESP_OK) {
+        return;
+    }
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_PREV_TASKS);
+    crash_diag_cbor_array(w, 4);
+    crash_diag_cbor_uint(w, prev.boot_count);
+    crash_diag_cbor_uint(w, prev.uptime_sec);
+    crash_diag_cbor_array(w, prev.stack_count);
+    for (uint8_t i = 0; i < prev.stack_count; i++) {
+        crash_diag_cbor_array(w, 2);
+        task_name(w, prev.stack[i].name);
+        crash_diag_cbor_uint(w, prev.stack[i].min_stack_free);
+    }
+    crash_diag_cbor_array(w, prev.cpu_count);
+    for (uint8_t i = 0; i < prev.cpu_count; i++) {
+        crash_diag_cbor_array(w, 2);
+        task_name(w, prev.cpu[i].name);
+        crash_diag_cbor_uint(w, prev.cpu[i].cpu_permille);
+    }
+}
+
+static void write_boot_profile(crash_diag_cbor_t *w, bool previous_boot)
+{
+    crash_diag_boot_profile_t p;
+    if (crash_diag_get_boot_profile(&p, previous_boot) != ESP_OK) {
+        return;
+    }
+    crash_diag_cbor_uint(w, previous_boot ? CRASH_DIAG_CBOR_KEY_PREV_BOOT_PROFILE
+                                          : CRASH_DIAG_CBOR_KEY_BOOT_PROFILE);
+    crash_diag_cbor_array(w, 3);
+    crash_diag_cbor_uint(w, p.boot_count);
+    text_n(w, p.fw_version, sizeof(p.fw_version));
+    crash_diag_cbor_array(w, CRASH_DIAG_PHASE_COUNT);
+    for (int i = 0; i < CRASH_DIAG_PHASE_COUNT; i++) {
+        if (p.at_us[i]) {
+            crash_diag_cbor_uint(w, p.at_us[i] / 1000);
+        } else {
+            crash_diag_cbor_null(w);
+        }
+    }
+}
+
+static void write_stall(crash_diag_cbor_t *w)
+{
+    crash_diag_stall_t s;
+    if (crash_diag_get_last_stall(&s) != ESP_OK) {
+        return;
+    }
+    uint8_t n = s.trace_count < CRASH_DIAG_STALL_TRACE ? s.trace_count : CRASH_DIAG_STALL_TRACE;
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_LAST_STALL);
+    crash_diag_cbor_array(w, 6);
+    crash_diag_cbor_uint(w, s.boot_count);
+    crash_diag_cbor_uint(w, s.uptime_sec);
+    task_name(w, s.task);
+    if (s.stack_free != UINT32_MAX) {
+        crash_diag_cbor_uint(w, s.stack_free);
+    } else {
+        crash_diag_cbor_null(w);
+    }
+    crash_diag_cbor_uint(w, s.cpu);
+    crash_diag_cbor_array(w, n);
+    for (uint8_t i = 0; i < n; i++) {
+        const crash_diag_trace_event_t *e = &s.trace[i];
+        crash_diag_cbor_array(w, 5);
+        crash_diag_cbor_uint(w, e->ts_us);
+        crash_diag_cbor_uint(w, e->id);
+        crash_diag_cbor_uint(w, e->core);
+        crash_diag_cbor_uint(w, e->arg0);
+        crash_diag_cbor_uint(w, e->arg1);
+    }
+}
+
+static void write_brownout(crash_diag_cbor_t *w)
+{
+    crash_diag_brownout_t b;
+    if (crash_diag_get_brownout(&b) != ESP_OK) {
+        return;
+    }
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_BROWNOUT);
+    crash_diag_cbor_array(w, 3);
+    crash_diag_cbor_uint(w, b.boot_count);
+    crash_diag_cbor_uint(w, b.uptime_ms);
+    crash_diag_cbor_array(w, b.blob_count);
+    for (uint8_t i = 0; i < b.blob_count; i++) {
+        crash_diag_cbor_uint(w, b.blob_ids[i]);
+    }
+}
+
+void crash_diag_cbor_write_fields(crash_diag_cbor_t *w, uint32_t sections)
+{
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_KEY_VERSION);
+    crash_diag_cbor_uint(w, CRASH_DIAG_CBOR_VERSION);
+    if (sections & CRASH_DIAG_CBOR_SUMMARY) {
+        write_summary(w);
+    }
+    if (sections & CRASH_DIAG_CBOR_HISTORY) {
+        write_history(w);
+    }
+    if (sections & CRASH_DIAG_CBOR_HEAP) {
+        write_heap(w);
+    }
+    if (sections & CRASH_DIAG_CBOR_HEAP_SAMPLES) {
+        write_heap_samples(w);
+    }
+    if (sections & CRASH_DIAG_CBOR_TASKS) {
+        write_tasks(w);
+    }
+    if (sections & CRASH_DIAG_CBOR_BOOT) {
+        write_boot_profile(w, false);
+        write_boot_profile(w, true);
+    }
+    if (sections & CRASH_DIAG_CBOR_STALL) {
+        write_stall(w);
+    }
+    if (sections & CRASH_DIAG_CBOR_BROWNOUT) {
+        write_brownout(w);
+    }
+}
+
+esp_err_t crash_diag_encode_cbor(uint8_t *buf, size_t cap, uint32_t sections, size_t *len)
+{
+    if (!len || (cap && !buf)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    crash_diag_cbor_t w;
+    crash_diag_cbor_init(&w, buf, cap);
+    crash_diag_cbor_map_begin(&w);
+    crash_diag_cbor_write_fields(&w, sections);
+    crash_diag_cbor_end(&w);
+    return crash_diag_cbor_finish(&w, len);
+}
@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: MIT
+#include "crash_diag_priv.h"
+
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+static const char *TAG = "crash_diag";
+
+/* Failure counters: written from whatever context an allocation fails in */
+static portMUX_TYPE s_fail_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_fail_count;
+static uint32_t s_fail_max_size;
+static uint32_t s_fail_at_last_sample;
+static uint8_t  s_fail_head;
+static crash_diag_alloc_fail_t s_fails[CRASH_DIAG_ALLOC_FAILS];
+/* Application's failed-alloc handler, called after the counters */
+static volatile crash_diag_alloc_failed_handler_t s_user_handler;
+
+/* Sample ring: written by the esp_timer task only */
+static crash_diag_heap_sample_t s_samples[CRASH_DIAG_HEAP_SAMPLES];
+static uint16_t s_sample_head;
+static uint16_t s_sample_count;
+static esp_timer_handle_t s_sample_timer;
+
+/* ================================================================== */
+/*  Allocation-failure hook                                            */
+/* ================================================================== */
+
+static void IRAM_ATTR alloc_failed_cb(size_t size, uint32_t caps, const char *function_name)
+{
+    uint32_t now = (uint32_t)(esp_timer_get_time() / 1000000);
+
+    portENTER_CRITICAL_SAFE(&s_fail_lock);
+    s_fail_count++;
+    if (size > s_fail_max_size) {
+        s_fail_max_size = (uint32_t)size;
+    }
+    crash_diag_alloc_fail_t *f = &s_fails[s_fail_head];
+    f->size       = (uint32_t)size;
+    f->caps       = caps;
+    f->uptime_sec = now;
+    s_fail_head = (uint8_t)((s_fail_head + 1) % CRASH_DIAG_ALLOC_FAILS);
+    portEXIT_CRITICAL_SAFE(&s_fail_lock);
+
+    crash_diag_alloc_failed_handler_t user = s_user_handler;
+    if (user) {
+        user(size, caps, function_name);
+    }
+}
+
+void crash_diag_set_alloc_failed_handler(crash_diag_alloc_failed_handler_t handler)
+{
+    s_user_handler = handler;
+}
+
+/* ================================================================== */
+/*  Periodic samples                                                   */
+/* ================================================================== */
+
+static void sample_timer_cb(void *arg)
+{
+    (void)arg;
+    portENTER_CRITICAL_SAFE(&s_fail_lock);
+    uint32_t fails = s_fail_count - s_fail_at_last_sample;
+    s_fail_at_last_sample = s_fail_count;
+    portEXIT_CRITICAL_SAFE(&s_fail_lock);
+
+    crash_diag_heap_sample_t *s = &s_samples[s_sample_head];
+    s->uptime_sec       = (uint32_t)(esp_timer_get_time() / 1000000);
+    s->free_internal    = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    s->largest_internal = (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+    s->free_dma_kb      = (uint16_t)(heap_caps_get_free_size(MALLOC_CAP_DMA) / 1024);
+    s->alloc_fails      = (uint16_t)(fails > UINT16_MAX ? UINT16_MAX : fails);
+
+    s_sample_head = (uint16_t)((s_sample_head + 1) % CRASH_DIAG_HEAP_SAMPLES);
+    if (s_sample_count < CRASH_DIAG_HEAP_SAMPLES) {
+        s_sample_count++;
+    }
+}
+
+void crash_diag_heap_init(uint32_t period_sec)
+{
+    esp_err_t err = heap_caps_register_failed_alloc_callback(alloc_failed_cb);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed-alloc hook unavailable: %s", esp_err_to_name(err));
+    }
+
+    if (period_sec == 0 || s_sample_timer) {
+        return;
+    }
+    const esp_timer_create_args_t args = {
+        .callback = sample_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "crash_diag_heap",
+        .skip_unhandled_events = true,
+    };
+    err = esp_timer_create(&args, &s_sample_timer);
+    if (err == ESP_OK) {
+        err = esp_timer_start_periodic(s_sample_timer, (uint64_t)period_sec * 1000000);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Heap sampler unavailable: %s", esp_err_to_name(err));
+        return;
+    }
+    sample_timer_cb(NULL);  /* first sample at boot, not one period later */
+}
+
+/* ================================================================== */
+/*  Public API                                                         */
+/* ================================================================== */
+
+esp_err_t crash_diag_get_heap_stats(crash_diag_heap_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->free_internal     = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    stats->largest_internal  = (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+    stats->min_free_internal = (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    stats->free_dma          = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DMA);
+    stats->largest_dma       = (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_DMA);
+
+    portENTER_CRITICAL_SAFE(&s_fail_lock);
+    stats->alloc_fail_count    = s_fail_count;
+    stats->alloc_fail_max_size = s_fail_max_size;
+    uint32_t n = s_fail_count < CRASH_DIAG_ALLOC_FAILS ? s_fail_count : CRASH_DIAG_ALLOC_FAILS;
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t slot = (uint8_t)((s_fail_head + CRASH_DIAG_ALLOC_FAILS - 1 - i) % CRASH_DIAG_ALLOC_FAILS);
+        stats->recent[i] = s_fails[slot];
+    }
+    stats->recent_count = (uint8_t)n;
+    portEXIT_CRITICAL_SAFE(&s_fail_lock);
+    return ESP_OK;
+}
+
+esp_err_t crash_diag_get_heap_samples(crash_diag_heap_sample_t *out, size_t max, size_t *count)
+{
+    if (!count || (max && !out)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* Snapshot the indices; a sample landing mid-copy only shifts the window */
+    uint16_t head = s_sample_head;
+    uint16_t have = s_sample_count;
+    size_t n = have < max ? have : max;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = s_samples[(head + CRASH_DIAG_HEAP_SAMPLES - n + i) % CRASH_DIAG_HEAP_SAMPLES];
+    }
+    *count = n;
+    return ESP_OK;
+}
+
+size_t crash_diag_heap_sample_count(void)
+{
+    return s_sample_count;
+}
+
+bool crash_diag_heap_sample_at(size_t i, crash_diag_heap_sample_t *out)
+{
+    uint16_t head = s_sample_head;
+    uint16_t have = s_sample_count;
+    if (i >= have) {
+        return false;
+    }
+    *out = s_samples[(head + CRASH_DIAG_HEAP_SAMPLES - have + i) % CRASH_DIAG_HEAP_SAMPLES];
+    return true;
+}
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: MIT
+#include "crash_diag_hist.h"
+
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+#define SUB_BITS  CRASH_DIAG_HIST_SUB_BITS
+#define SUB_COUNT CRASH_DIAG_HIST_SUB_COUNT
+
+/* One lock for every histogram: the sections are a handful of instructions */
+static portMUX_TYPE s_hist_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/*
+ * Bucket layout. Below 2 * SUB_COUNT a bucket is one value wide. From there
+ * each power of two [2^m, 2^(m+1)) gets SUB_COUNT buckets of width
+ * 2^(m - SUB_BITS), indexed by the SUB_BITS bits below the leading one.
+ */
+static inline uint32_t bucket_of(uint32_t v)
+{
+    if (v < 2 * SUB_COUNT) {
+        return v;
+    }
+    if (v > CRASH_DIAG_HIST_MAX_VALUE) {
+        return CRASH_DIAG_HIST_BUCKETS - 1;
+    }
+    uint32_t msb = 31 - (uint32_t)__builtin_clz(v);
+    uint32_t shift = msb - SUB_BITS;
+    return (shift + 1) * SUB_COUNT + ((v >> shift) - SUB_COUNT);
+}
+
+/* Middle of a bucket's value range */
+static uint32_t bucket_mid(uint32_t idx)
+{
+    if (idx < 2 * SUB_COUNT) {
+        return idx;
+    }
+    uint32_t shift = idx / SUB_COUNT - 1;
+    uint32_t low = (SUB_COUNT + idx % SUB_COUNT) << shift;
+    return low + ((1u << shift) >> 1);
+}
+
+void IRAM_ATTR crash_diag_hist_record(crash_diag_hist_t *h, uint32_t value)
+{
+    uint32_t idx = bucket_of(value);
+    portENTER_CRITICAL_SAFE(&s_hist_lock);
+    h->buckets[idx]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max) {
+        h->max = value;
+    }
+    portEXIT_CRITICAL_SAFE(&s_hist_lock);
+}
+
+void crash_diag_hist_reset(crash_diag_hist_t *h)
+{
+    portENTER_CRITICAL_SAFE(&s_hist_lock);
+    memset(h, 0, sizeof(*h));
+    portEXIT_CRITICAL_SAFE(&s_hist_lock);
+}
+
+void crash_diag_hist_snapshot(crash_diag_hist_t *h, crash_diag_hist_t *out, bool reset)
+{
+    portENTER_CRITICAL_SAFE(&s_hist_lock);
+    memcpy(out, h, sizeof(*out));
+    if (reset) {
+        memset(h, 0, sizeof(*h));
+    }
+    portEXIT_CRITICAL_SAFE(&s_hist_lock);
+}
+
+void crash_diag_hist_merge(crash_diag_hist_t *dst, const crash_diag_hist_t *src)
+{
+    portENTER_CRITICAL_SAFE(&s_hist_lock);
+    for (uint32_t i = 0; i < CRASH_DIAG_HIST_BUCKETS; i++) {
+        dst->buckets[i] += src->buckets[i];
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+    portEXIT_CRITICAL_SAFE(&s_hist_lock);
+}
+
+/* 1-based rank of the sample at a percentile (nearest-rank method) */
+static uint32_t rank_of(uint32_t count, uint32_t permille)
+{
+    uint64_t r = ((uint64_t)count * permille + 999) / 1000;
+    return r ? (uint32_t)r : 1;
+}
+
+static uint32_t clamp_max(const crash_diag_hist_t *h, uint32_t v)
+{
+    return v < h->max ? v : h->max;
+}
+
+uint32_t crash_diag_hist_percentile(const crash_diag_hist_t *h, uint32_t permille)
+{
+    if (h->count == 0) {
+        return 0;
+    }
+    if (permille >= 1000) {
+        return h->max;
+    }
+    uint32_t rank = rank_of(h->count, permille);
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < CRASH_DIAG_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            return clamp_max(h, bucket_mid(i));
+        }
+    }
+    return h->max;
+}
+
+void crash_diag_hist_summary(const crash_diag_hist_t *h, crash_diag_hist_summary_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (h->count == 0) {
+        return;
+    }
+    out->count = h->count;
+    out->max   = h->max;
+    out->mean  = (uint32_t)(h->sum / h->count);
+
+    static const uint16_t permille[] = { 500, 900, 990 };
+    uint32_t *dest[] = { &out->p50, &out->p90, &out->p99 };
+    uint32_t seen = 0;
+    size_t next = 0;
+    for (uint32_t i = 0; i < CRASH_DIAG_HIST_BUCKETS && next < 3; i++) {
+        seen += h->buckets[i];
+        while (next < 3 && seen >= rank_of(h->count, permille[next])) {
+            *dest[next++] = clamp_max(h, bucket_mid(i));
+        }
+    }
+}
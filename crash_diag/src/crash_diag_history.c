@@ -0,0 +1,311 @@
+// SPDX-License-Identifier: MIT
+#include "crash_diag_priv.h"
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_memory_utils.h"
+#include "esp_private/panic_internal.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+#include <stddef.h>
+#include <string.h>
+
+#if CONFIG_IDF_TARGET_ARCH_RISCV
+#include "riscv/rvruntime-frames.h"
+#endif
+
+static const char *TAG = "crash_diag";
+
+#define CRASH_DIAG_NVS_HISTORY "crash_hist"
+
+/* Stack words scanned for return-address candidates after PC and RA */
+#define STACK_SCAN_WORDS 64
+
+/**
+ * Crash ring in RTC memory (see rtc_diag_data_t in crash_diag.c for why
+ * RTC_NOINIT_ATTR). Written by the panic hook, drained into NVS by the next
+ * crash_diag_init(); records pile up here when the device crashes before
+ * reaching init, which is exactly the crash-loop case.
+ */
+typedef struct {
+    uint32_t magic;             /**< RTC_RING_MAGIC when valid */
+    uint32_t cur_boot;          /**< Boot count of the running boot, for the panic hook
+                                     (still the previous one until crash_diag_init() runs) */
+    uint8_t  head;              /**< Next slot to write */
+    uint8_t  count;             /**< Records not yet moved to NVS */
+    uint8_t  pending;           /**< Newest record still needs its reset reason */
+    uint8_t  reserved;
+    crash_diag_record_t rec[CRASH_DIAG_HISTORY_LEN];
+} rtc_crash_ring_t;
+
+#define RTC_RING_MAGIC 0xC4A5E001
+
+/* NVS blob: header followed by `count` records, newest first */
+typedef struct {
+    uint8_t version;
+    uint8_t count;
+    uint8_t reserved[2];
+    crash_diag_record_t rec[CRASH_DIAG_HISTORY_LEN];
+} crash_hist_blob_t;
+
+#define CRASH_HIST_VERSION 1
+#define CRASH_HIST_HEADER_SIZE offsetof(crash_hist_blob_t, rec)
+
+static RTC_NOINIT_ATTR rtc_crash_ring_t s_ring;
+static crash_hist_blob_t s_hist;
+
+/* ================================================================== */
+/*  Panic hook                                                         */
+/* ================================================================== */
+
+static void IRAM_ATTR ring_reset(void)
+{
+    memset(&s_ring, 0, sizeof(s_ring));
+    s_ring.magic = RTC_RING_MAGIC;
+}
+
+static uint8_t IRAM_ATTR capture_backtrace(const panic_info_t *info, uint32_t *bt)
+{
+    uint8_t n = 0;
+#if CONFIG_IDF_TARGET_ARCH_RISCV
+    /* No frame pointers by default on RISC-V, so after PC and RA take code
+     * addresses found on the stack, like the panic handler's stack dump */
+    const RvExcFrame *frame = (const RvExcFrame *)info->frame;
+    if (!frame) {
+        return 0;
+    }
+    bt[n++] = frame->mepc;
+    if (esp_ptr_executable((void *)frame->ra) && frame->ra != frame->mepc) {
+        bt[n++] = frame->ra;
+    }
+    const uint32_t *sp = (const uint32_t *)frame->sp;
+    for (int i = 0; i < STACK_SCAN_WORDS && n < CRASH_DIAG_BT_DEPTH; i++) {
+        if (!esp_stack_ptr_is_sane((uint32_t)&sp[i])) {
+            break;
+        }
+        uint32_t v = sp[i];
+        if (esp_ptr_executable((void *)v) && v != bt[n - 1]) {
+            bt[n++] = v;
+        }
+    }
+#else
+    (void)info;
+    (void)bt;
+#endif
+    return n;
+}
+
+/* Runs inside the panic handler: short, IRAM-resident, no locks */
+static void IRAM_ATTR record_panic(const panic_info_t *info)
+{
+    if (s_ring.magic != RTC_RING_MAGIC || s_ring.head >= CRASH_DIAG_HISTORY_LEN ||
+        s_ring.count > CRASH_DIAG_HISTORY_LEN) {
+        ring_reset();
+    }
+
+    crash_diag_record_t *r = &s_ring.rec[s_ring.head];
+    memset(r, 0, sizeof(*r));
+    r->boot_count   = s_ring.cur_boot;
+    r->uptime_sec   = (uint32_t)(esp_timer_get_time() / 1000000);
+    r->reset_reason = ESP_RST_PANIC;    /* provisional; the next boot knows better (e.g. TASK_WDT) */
+    r->flags        = CRASH_DIAG_REC_PANIC;
+
+    /* After a TWDT timeout the running task is just whoever was preempted;
+     * name the one that starved instead */
+    const char *name = crash_diag_stall_culprit();
+    if (name) {
+        r->flags |= CRASH_DIAG_REC_STALL;
+    } else {
+        TaskHandle_t task = xTaskGetCurrentTaskHandle();
+        name = task ? pcTaskGetName(task) : NULL;
+    }
+    for (int i = 0; name && name[i] && i < CRASH_DIAG_TASK_NAME_LEN - 1; i++) {
+        r->task[i] = name[i];
+    }
+    r->bt_depth = capture_backtrace(info, r->backtrace);
+
+    s_ring.head = (uint8_t)((s_ring.head + 1) % CRASH_DIAG_HISTORY_LEN);
+    if (s_ring.count < CRASH_DIAG_HISTORY_LEN) {
+        s_ring.count++;
+    }
+    s_ring.pending = 1;
+}
+
+/* Linked in with -Wl,--wrap=esp_panic_handler (see CMakeLists.txt) */
+void __real_esp_panic_handler(panic_info_t *info);
+
+void IRAM_ATTR __wrap_esp_panic_handler(panic_info_t *info)
+{
+    crash_diag_rtc_uptime_now();
+    record_panic(info);
+    __real_esp_panic_handler(info);
+}
+
+/* ================================================================== */
+/*  Boot-time persistence                                              */
+/* ================================================================== */
+
+/* Resets that mean the previous boot died rather than ended on purpose */
+bool crash_diag_is_crash_reset(uint8_t reason)
+{
+    switch ((esp_reset_reason_t)reason) {
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+        case ESP_RST_BROWNOUT:
+        case ESP_RST_CPU_LOCKUP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void load_history(void)
+{
+    memset(&s_hist, 0, sizeof(s_hist));
+    s_hist.version = CRASH_HIST_VERSION;
+
+    nvs_handle_t nvs;
+    if (nvs_open(CRASH_DIAG_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(s_hist);
+    esp_err_t err = nvs_get_blob(nvs, CRASH_DIAG_NVS_HISTORY, &s_hist, &len);
+    nvs_close(nvs);
+
+    if (err != ESP_OK || len < CRASH_HIST_HEADER_SIZE || s_hist.version != CRASH_HIST_VERSION ||
+        s_hist.count > CRASH_DIAG_HISTORY_LEN ||
+        len != CRASH_HIST_HEADER_SIZE + s_hist.count * sizeof(crash_diag_record_t)) {
+        if (err == ESP_OK) {
+            ESP_LOGW(TAG, "Discarding incompatible crash history blob (%u bytes)", (unsigned)len);
+        }
+        memset(&s_hist, 0, sizeof(s_hist));
+        s_hist.version = CRASH_HIST_VERSION;
+    }
+}
+
+static esp_err_t save_history(void)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(CRASH_DIAG_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    /* Only the used records: an empty history is 4 bytes */
+    err = nvs_set_blob(nvs, CRASH_DIAG_NVS_HISTORY, &s_hist,
+                       CRASH_HIST_HEADER_SIZE + s_hist.count * sizeof(crash_diag_record_t));
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return err;
+}
+
+/* Put a record at the front of the NVS history, dropping the oldest */
+static void history_push(const crash_diag_record_t *r)
+{
+    size_t keep = s_hist.count < CRASH_DIAG_HISTORY_LEN ? s_hist.count : CRASH_DIAG_HISTORY_LEN - 1;
+    memmove(&s_hist.rec[1], &s_hist.rec[0], keep * sizeof(crash_diag_record_t));
+    s_hist.rec[0] = *r;
+    s_hist.count = (uint8_t)(keep + 1);
+}
+
+void crash_diag_history_init(uint8_t reset_reason, uint32_t boot_count,
+                             uint32_t prev_boot, uint32_t prev_uptime)
+{
+    if (s_ring.magic != RTC_RING_MAGIC || s_ring.head >= CRASH_DIAG_HISTORY_LEN ||
+        s_ring.count > CRASH_DIAG_HISTORY_LEN) {
+        ring_reset();
+    }
+
+    if (s_ring.pending) {
+        uint8_t newest = (uint8_t)((s_ring.head + CRASH_DIAG_HISTORY_LEN - 1) % CRASH_DIAG_HISTORY_LEN);
+        s_ring.rec[newest].reset_reason = reset_reason;
+        s_ring.pending = 0;
+    } else if (crash_diag_is_crash_reset(reset_reason)) {
+        /* Died without passing through the panic handler (brownout, RTC WDT, ...) */
+        crash_diag_record_t *r = &s_ring.rec[s_ring.head];
+        memset(r, 0, sizeof(*r));
+        r->boot_count   = prev_boot;
+        r->uptime_sec   = prev_uptime;
+        r->reset_reason = reset_reason;
+        s_ring.head = (uint8_t)((s_ring.head + 1) % CRASH_DIAG_HISTORY_LEN);
+        if (s_ring.count < CRASH_DIAG_HISTORY_LEN) {
+            s_ring.count++;
+        }
+    }
+
+    load_history();
+
+    if (s_ring.count) {
+        /* Oldest unpersisted first, so the newest ends up at the front */
+        for (uint8_t i = s_ring.count; i > 0; i--) {
+            uint8_t slot = (uint8_t)((s_ring.head + CRASH_DIAG_HISTORY_LEN - i) % CRASH_DIAG_HISTORY_LEN);
+            history_push(&s_ring.rec[slot]);
+        }
+        esp_err_t err = save_history();
+        if (err == ESP_OK) {
+            s_ring.count = 0;
+        } else {
+            /* Keep them in RTC; the next boot tries again */
+            ESP_LOGW(TAG, "Failed to persist crash history: %s", esp_err_to_name(err));
+        }
+        const crash_diag_record_t *r = &s_hist.rec[0];
+        ESP_LOGW(TAG, "Crash in boot #%lu at %lu s: %s, task '%s', pc 0x%08lx (%u recorded)",
+                 r->boot_count, r->uptime_sec, crash_diag_reset_reason_str(r->reset_reason),
+                 r->task, r->bt_depth ? r->backtrace[0] : 0, (unsigned)s_hist.count);
+    }
+
+    s_ring.cur_boot = boot_count;
+}
+
+/* ================================================================== */
+/*  Public API                                                         */
+/* ================================================================== */
+
+esp_err_t crash_diag_get_history(crash_diag_record_t *out, size_t max, size_t *count)
+{
+    if (!count || (max && !out)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t n = s_hist.count < max ? s_hist.count : max;
+    if (n) {
+        memcpy(out, s_hist.rec, n * sizeof(crash_diag_record_t));
+    }
+    *count = n;
+    return ESP_OK;
+}
+
+uint8_t crash_diag_history_crash_streak(uint32_t prev_boot, uint32_t max_uptime_sec)
+{
+    /* Records are newest first and at most one per boot: the streak is the
+     * leading run whose boot numbers count down from prev_boot without a gap */
+    uint8_t streak = 0;
+    uint32_t expect = prev_boot;
+    for (uint8_t i = 0; i < s_hist.count && expect; i++, expect--) {
+        const crash_diag_record_t *r = &s_hist.rec[i];
+        if (r->boot_count != expect || r->uptime_sec >= max_uptime_sec) {
+            break;
+        }
+        streak++;
+    }
+    return streak;
+}
+
+const crash_diag_record_t *crash_diag_history_at(size_t i)
+{
+    return i < s_hist.count ? &s_hist.rec[i] : NULL;
+}
+
+esp_err_t crash_diag_clear_history(void)
+{
+    memset(s_hist.rec, 0, sizeof(s_hist.rec));
+    s_hist.count = 0;
+    s_ring.count = 0;
+    return save_history();
+}
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: MIT
+#include "crash_diag_json.h"
+#include "crash_diag_priv.h"
+
+#include "cJSON.h"
+#include "esp_timer.h"
+#include <stdio.h>
+
+/* Layouts are documented in crash_diag_json.h */
+
+static void add_summary(cJSON *root)
+{
+    crash_diag_data_t d;
+    crash_diag_get_data(&d);
+    cJSON_AddNumberToObject(root, "boot_count",      (double)d.boot_count);
+    cJSON_AddNumberToObject(root, "reset_reason",    (double)d.reset_reason);
+    cJSON_AddStringToObject(root, "reset_reason_str", crash_diag_reset_reason_str(d.reset_reason));
+    cJSON_AddNumberToObject(root, "last_uptime_sec", (double)d.last_uptime_sec);
+    cJSON_AddNumberToObject(root, "min_free_heap",   (double)d.min_free_heap);
+    cJSON_AddNumberToObject(root, "uptime_sec",      (double)(esp_timer_get_time() / 1000000));
+    cJSON_AddBoolToObject(root, "safe_mode", crash_diag_in_safe_mode());
+}
+
+static void add_history(cJSON *root)
+{
+    cJSON *crashes = cJSON_AddArrayToObject(root, "crashes");
+    const crash_diag_record_t *r;
+    for (size_t i = 0; (r = crash_diag_history_at(i)) != NULL; i++) {
+        cJSON *c = cJSON_CreateObject();
+        cJSON_AddNumberToObject(c, "boot",       (double)r->boot_count);
+        cJSON_AddNumberToObject(c, "uptime_sec", (double)r->uptime_sec);
+        cJSON_AddStringToObject(c, "reset_reason", crash_diag_reset_reason_str(r->reset_reason));
+        cJSON_AddStringToObject(c, "task", r->task);
+        cJSON_AddBoolToObject(c, "panic", (r->flags & CRASH_DIAG_REC_PANIC) != 0);
+        cJSON *bt = cJSON_AddArrayToObject(c, "backtrace");
+        for (uint8_t k = 0; k < r->bt_depth && k < CRASH_DIAG_BT_DEPTH; k++) {
+            char pc[11];
+            snprintf(pc, sizeof(pc), "0x%08lx", (unsigned long)r->backtrace[k]);
+            cJSON_AddItemToArray(bt, cJSON_CreateString(pc));
+        }
+        cJSON_AddItemToArray(crashes, c);
+    }
+}
+
+static cJSON *heap_object(cJSON *root)
+{
+    cJSON *heap = cJSON_GetObjectItem(root, "heap");
+    return heap ? heap : cJSON_AddObjectToObject(root, "heap");
+}
+
+static void add_heap(cJSON *root)
+{
+    crash_diag_heap_stats_t hs;
+    crash_diag_get_heap_stats(&hs);
+    cJSON *heap = heap_object(root);
+    cJSON_AddNumberToObject(heap, "free_internal",     (double)hs.free_internal);
+    cJSON_AddNumberToObject(heap, "largest_internal",  (double)hs.largest_internal);
+    cJSON_AddNumberToObject(heap, "min_free_internal", (double)hs.min_free_internal);
+    cJSON_AddNumberToObject(heap, "free_dma",          (double)hs.free_dma);
+    cJSON_AddNumberToObject(heap, "largest_dma",       (double)hs.largest_dma);
+    /* Share of free internal RAM unusable for one allocation of that size */
+    cJSON_AddNumberToObject(heap, "frag_pct", hs.free_internal
+        ? (double)(100 - (uint64_t)hs.largest_internal * 100 / hs.free_internal) : 0);
+    cJSON_AddNumberToObject(heap, "alloc_fail_count",    (double)hs.alloc_fail_count);
+    cJSON_AddNumberToObject(heap, "alloc_fail_max_size", (double)hs.alloc_fail_max_size);
+    cJSON *fails = cJSON_AddArrayToObject(heap, "recent_fails");
+    for (uint8_t i = 0; i < hs.recent_count; i++) {
+        cJSON *f = cJSON_CreateObject();
+        cJSON_AddNumberToObject(f, "size",       (double)hs.recent[i].size);
+        cJSON_AddNumberToObject(f, "caps",       (double)hs.recent[i].caps);
+        cJSON_AddNumberToObject(f, "uptime_sec", (double)hs.recent[i].uptime_sec);
+        cJSON_AddItemToArray(fails, f);
+    }
+}
+
+static void add_heap_samples(cJSON *root)
+{
+    cJSON *rows = cJSON_AddArrayToObject(heap_object(root), "samples");
+    crash_diag_heap_sample_t s;
+    for (size_t i = 0; crash_diag_heap_sample_at(i, &s); i++) {
+        const double row[] = {
+            s.uptime_sec, s.free_internal, s.largest_internal, s.free_dma_kb, s.alloc_fails,
+        };
+        cJSON_AddItemToArray(rows, cJSON_CreateDoubleArray(row, 5));
+    }
+}
+
+static void add_tasks(cJSON *root)
+{
+    size_t n;
+    /* An empty table with the sampler built but not running */
+    if (crash_diag_get_task_stats(NULL, 0, &n) == ESP_OK) {
+        cJSON *arr = cJSON_AddArrayToObject(root, "tasks");
+        crash_diag_task_stat_t t;
+        for (size_t i = 0; crash_diag_tasks_at(i, &t); i++) {
+            cJSON *o = cJSON_CreateObject();
+            cJSON_AddStringToObject(o, "name", t.name);
+            cJSON_AddNumberToObject(o, "min_stack_free", (double)t.min_stack_free);
+            cJSON_AddNumberToObject(o, "cpu_permille",   (double)t.cpu_permille);
+            cJSON_AddNumberToObject(o, "prio",           (double)t.priority);
+            cJSON_AddBoolToObject(o, "alive", t.alive);
+            cJSON_AddItemToArray(arr, o);
+        }
+    }
+
+    crash_diag_task_offenders_t prev;
+    if (crash_diag_get_task_offenders(&prev, true) != ESP_OK) {
+        return;
+    }
+    cJSON *o = cJSON_AddObjectToObject(root, "prev_boot_tasks");
+    cJSON_AddNumberToObject(o, "boot",       (double)prev.boot_count);
+    cJSON_AddNumberToObject(o, "uptime_sec", (double)prev.uptime_sec);
+    cJSON *st = cJSON_AddArrayToObject(o, "stack");
+    for (uint8_t i = 0; i < prev.stack_count; i++) {
+        cJSON *t = cJSON_CreateObject();
+        cJSON_AddStringToObject(t, "name", prev.stack[i].name);
+        cJSON_AddNumberToObject(t, "min_stack_free", (double)prev.stack[i].min_stack_free);
+        cJSON_AddItemToArray(st, t);
+    }
+    cJSON *cpu = cJSON_AddArrayToObject(o, "cpu");
+    for (uint8_t i = 0; i < prev.cpu_count; i++) {
+        cJSON *t = cJSON_CreateObject();
+        cJSON_AddStringToObject(t, "name", prev.cpu[i].name);
+        cJSON_AddNumberToObject(t, "cpu_permille", (double)prev.cpu[i].cpu_permille);
+        cJSON_AddItemToArray(cpu, t);
+    }
+}
+
+/* {"boot":N,"fw_version":"..","phases_ms":{"wifi_ip":1234,...}}, reached phases only */
+static void add_boot_profile(cJSON *parent, const char *key, const crash_diag_boot_profile_t *p)
+{
+    cJSON *o = cJSON_AddObjectToObject(parent, key);
+    cJSON_AddNumberToObject(o, "boot", (double)p->boot_count);
+    cJSON_AddStringToObject(o, "fw_version", p->fw_version);
+    cJSON *ph = cJSON_AddObjectToObject(o, "phases_ms");
+    for (int i = 0; i < CRASH_DIAG_PHASE_COUNT; i++) {
+        if (p->at_us[i]) {
+            cJSON_AddNumberToObject(ph, crash_diag_phase_name((crash_diag_phase_t)i),
+                                    (double)(p->at_us[i] / 1000));
+        }
+    }
+}
+
+static void add_boot(cJSON *root)
+{
+    crash_diag_boot_profile_t p;
+    cJSON *boot = cJSON_AddObjectToObject(root, "boot_profile");
+    crash_diag_get_boot_profile(&p, false);
+    add_boot_profile(boot, "current", &p);
+    if (crash_diag_get_boot_profile(&p, true) == ESP_OK) {
+        add_boot_profile(boot, "previous", &p);
+    }
+}
+
+static void add_stall(cJSON *root)
+{
+    crash_diag_stall_t s;
+    if (crash_diag_get_last_stall(&s) != ESP_OK) {
+        return;
+    }
+    cJSON *o = cJSON_AddObjectToObject(root, "last_stall");
+    cJSON_AddNumberToObject(o, "boot",       (double)s.boot_count);
+    cJSON_AddNumberToObject(o, "uptime_sec", (double)s.uptime_sec);
+    cJSON_AddStringToObject(o, "task", s.task);
+    if (s.stack_free != UINT32_MAX) {
+        cJSON_AddNumberToObject(o, "stack_free", (double)s.stack_free);
+    }
+    /* Rows [ts_us, id, core, arg0, arg1] as in prev_trace */
+    cJSON *tr = cJSON_AddArrayToObject(o, "trace");
+    for (uint8_t i = 0; i < s.trace_count && i < CRASH_DIAG_STALL_TRACE; i++) {
+        const crash_diag_trace_event_t *e = &s.trace[i];
+        const double row[] = { e->ts_us, e->id, e->core, e->arg0, e->arg1 };
+        cJSON_AddItemToArray(tr, cJSON_CreateDoubleArray(row, 5));
+    }
+}
+
+static void add_brownout(cJSON *root)
+{
+    crash_diag_brownout_t b;
+    if (crash_diag_get_brownout(&b) != ESP_OK) {
+        return;
+    }
+    cJSON *o = cJSON_AddObjectToObject(root, "last_brownout");
+    cJSON_AddNumberToObject(o, "boot",      (double)b.boot_count);
+    cJSON_AddNumberToObject(o, "uptime_ms", (double)b.uptime_ms);
+    cJSON *ids = cJSON_AddArrayToObject(o, "blobs");
+    for (uint8_t i = 0; i < b.blob_count; i++) {
+        cJSON_AddItemToArray(ids, cJSON_CreateNumber(b.blob_ids[i]));
+    }
+}
+
+void crash_diag_json_add(cJSON *root, uint32_t sections)
+{
+    if (!root) {
+        return;
+    }
+    if (sections & CRASH_DIAG_CBOR_SUMMARY) {
+        add_summary(root);
+    }
+    if (sections & CRASH_DIAG_CBOR_HISTORY) {
+        add_history(root);
+    }
+    if (sections & CRASH_DIAG_CBOR_HEAP) {
+        add_heap(root);
+    }
+    if (sections & CRASH_DIAG_CBOR_HEAP_SAMPLES) {
+        add_heap_samples(root);
+    }
+    if (sections & CRASH_DIAG_CBOR_TASKS) {
+        add_tasks(root);
+    }
+    if (sections & CRASH_DIAG_CBOR_BOOT) {
+        add_boot(root);
+    }
+    if (sections & CRASH_DIAG_CBOR_STALL) {
+        add_stall(root);
+    }
+    if (sections & CRASH_DIAG_CBOR_BROWNOUT) {
+        add_brownout(root);
+    }
+}
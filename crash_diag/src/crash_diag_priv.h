@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: MIT
+#pragma once
+
+/*
+ * Internal interfaces between the crash_diag source files.
+ */
+
+#include "crash_diag.h"
+
+/* NVS namespace for crash diagnostics (separate from main app config) */
+#define CRASH_DIAG_NVS_NAMESPACE "crash_diag"
+
+/* ==== crash_diag.c ==== */
+
+/** Store the current uptime in RTC memory (IRAM-safe, used by the panic hook) */
+void crash_diag_rtc_uptime_now(void);
+
+/* ==== crash_diag_history.c ==== */
+
+/**
+ * Finish records left by the previous boot and persist them.
+ *
+ * @param reset_reason   esp_reset_reason() of this boot
+ * @param boot_count     This boot's number (stamped on crashes recorded from now on)
+ * @param prev_boot      Number of the boot that just ended
+ * @param prev_uptime    Its last known uptime, for resets the panic hook never saw
+ */
+void crash_diag_history_init(uint8_t reset_reason, uint32_t boot_count,
+                             uint32_t prev_boot, uint32_t prev_uptime);
+
+/** True for resets meaning the previous boot died (panic, WDT, brownout, ...) */
+bool crash_diag_is_crash_reset(uint8_t reason);
+
+/**
+ * Number of boots in a row, counting back from prev_boot, that each ended
+ * in a crash recorded less than max_uptime_sec after starting
+ */
+uint8_t crash_diag_history_crash_streak(uint32_t prev_boot, uint32_t max_uptime_sec);
+
+/** History record `i`, newest first, or NULL past the end */
+const crash_diag_record_t *crash_diag_history_at(size_t i);
+
+/* ==== crash_diag_heap.c ==== */
+
+/** Register the failed-allocation hook and start sampling (0 = no samples) */
+void crash_diag_heap_init(uint32_t period_sec);
+
+/** Number of heap samples held */
+size_t crash_diag_heap_sample_count(void);
+
+/** Heap sample `i` of crash_diag_heap_sample_count(), oldest first; false past the end */
+bool crash_diag_heap_sample_at(size_t i, crash_diag_heap_sample_t *out);
+
+/* ==== crash_diag_tasks.c ==== */
+
+/** Recover the previous boot's offenders from RTC and start sampling (0 = off) */
+void crash_diag_tasks_init(uint32_t period_sec, uint32_t boot_count);
+
+/** Lowest stack headroom sampled for a task, UINT32_MAX if unknown. Lock-free (ISR use). */
+uint32_t crash_diag_tasks_stack_free(const char *name);
+
+/** Copy tracked task `i` under the sampler lock; false past the end or with the sampler off */
+bool crash_diag_tasks_at(size_t i, crash_diag_task_stat_t *out);
+
+/* ==== crash_diag_boot.c ==== */
+
+/** Keep the previous boot's phase table and start mirroring this one to RTC */
+void crash_diag_boot_init(uint32_t boot_count);
+
+/* ==== crash_diag_trace.c ==== */
+
+/** Keep the previous trace if that boot crashed, then clear and arm the rings */
+void crash_diag_trace_init(uint8_t reset_reason);
+
+/* ==== crash_diag_brownout.c ==== */
+
+/** Recover the state saved by a brownout that ended the previous boot */
+void crash_diag_brownout_init(uint32_t boot_count, uint8_t reset_reason);
+
+/* ==== crash_diag_stall.c ==== */
+
+/** Stamp this boot on future stalls and report one that ended the previous boot */
+void crash_diag_stall_init(uint32_t boot_count, uint32_t prev_boot);
+
+/** Task named by a TWDT timeout in this panic's run-up, or NULL (IRAM, for the panic hook) */
+const char *crash_diag_stall_culprit(void);
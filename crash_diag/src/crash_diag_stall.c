@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: MIT
+#include "crash_diag_priv.h"
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_task_wdt.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static const char *TAG = "crash_diag";
+
+/**
+ * Last stall in RTC memory (RTC_NOINIT, see crash_diag.c). Not cleared at
+ * boot: the record carries its boot number and stays until the next stall.
+ */
+typedef struct {
+    uint32_t magic;
+    crash_diag_stall_t stall;
+} rtc_stall_t;
+
+#define RTC_STALL_MAGIC 0x57A11ED0
+
+static RTC_NOINIT_ATTR rtc_stall_t s_rtc;
+static uint32_t s_boot_count;
+/* When the TWDT ISR last fired; the panic hook only blames the stalled task
+ * if the panic follows right after (CONFIG_ESP_TASK_WDT_PANIC) */
+static int64_t s_stall_at_us;
+#define STALL_PANIC_WINDOW_US 1000000
+/* Application's TWDT hook, run after the stall is recorded */
+static volatile crash_diag_twdt_handler_t s_user_handler;
+
+/* esp_task_wdt_print_triggered_tasks() reports each late entry as
+ * "\n - ", name, then for tasks a CPU suffix; keep the first one */
+typedef struct {
+    crash_diag_stall_t *stall;
+    uint8_t state;          /* 0 before the first entry, 1 name next, 2 in it, 3 done */
+} parse_ctx_t;
+
+static void on_triggered_msg(void *opaque, const char *msg)
+{
+    parse_ctx_t *ctx = opaque;
+    switch (ctx->state) {
+    case 0:
+        if (strstr(msg, " - ")) {
+            ctx->state = 1;
+        }
+        break;
+    case 1:
+        strncpy(ctx->stall->task, msg, CRASH_DIAG_TASK_NAME_LEN - 1);
+        ctx->stall->task[CRASH_DIAG_TASK_NAME_LEN - 1] = '\0';
+        ctx->state = 2;
+        break;
+    case 2: {
+        if (strstr(msg, " - ")) {
+            ctx->state = 3;
+            break;
+        }
+        /* "CPU 0" / "CPU 1"; "CPU 0/1" means unpinned */
+        const char *c = strstr(msg, "CPU ");
+        if (c && (c[4] == '0' || c[4] == '1') && c[5] != '/') {
+            ctx->stall->cpu = (uint8_t)(c[4] - '0');
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/*
+ * Weak in esp_system: called from the TWDT interrupt on every timeout, with
+ * the watchdog's lock held and before the panic when CONFIG_ESP_TASK_WDT_PANIC
+ * is set. Same rules as any ISR: no logging, no blocking. Asking for the
+ * triggered list again is fine: the watchdog's spinlock nests on one core.
+ * This strong definition takes the hook, so applications chain theirs
+ * through crash_diag_set_twdt_user_handler().
+ */
+void esp_task_wdt_isr_user_handler(void)
+{
+    crash_diag_stall_t st;
+    memset(&st, 0, sizeof(st));
+    st.boot_count = s_boot_count;
+    st.uptime_sec = (uint32_t)(esp_timer_get_time() / 1000000);
+    st.cpu = 0xFF;
+
+    parse_ctx_t ctx = { .stall = &st, .state = 0 };
+    int cpus_fail = 0;
+    esp_task_wdt_print_triggered_tasks(on_triggered_msg, &ctx, &cpus_fail);
+    st.stack_free = st.task[0] ? crash_diag_tasks_stack_free(st.task) : UINT32_MAX;
+
+    size_t n = 0;
+    crash_diag_get_trace(st.trace, CRASH_DIAG_STALL_TRACE, &n, false);
+    st.trace_count = (uint8_t)n;
+
+    crash_diag_rtc_uptime_now();
+    s_rtc.magic = 0;
+    s_rtc.stall = st;
+    s_rtc.magic = RTC_STALL_MAGIC;
+    s_stall_at_us = esp_timer_get_time();
+
+    crash_diag_twdt_handler_t user = s_user_handler;
+    if (user) {
+        user();
+    }
+}
+
+void crash_diag_set_twdt_user_handler(crash_diag_twdt_handler_t handler)
+{
+    s_user_handler = handler;
+}
+
+const char *IRAM_ATTR crash_diag_stall_culprit(void)
+{
+    if (!s_stall_at_us || esp_timer_get_time() - s_stall_at_us > STALL_PANIC_WINDOW_US ||
+        s_rtc.magic != RTC_STALL_MAGIC || !s_rtc.stall.task[0]) {
+        return NULL;
+    }
+    return s_rtc.stall.task;
+}
+
+void crash_diag_stall_init(uint32_t boot_count, uint32_t prev_boot)
+{
+    s_boot_count = boot_count;
+    if (s_rtc.magic != RTC_STALL_MAGIC) {
+        return;
+    }
+    const crash_diag_stall_t *st = &s_rtc.stall;
+    if (st->boot_count == prev_boot) {
+        if (st->stack_free != UINT32_MAX) {
+            ESP_LOGW(TAG, "Task watchdog in boot #%lu at %lu s: '%s' starved (stack free %lu B)",
+                     st->boot_count, st->uptime_sec, st->task, st->stack_free);
+        } else {
+            ESP_LOGW(TAG, "Task watchdog in boot #%lu at %lu s: '%s' starved",
+                     st->boot_count, st->uptime_sec, st->task);
+        }
+    }
+}
+
+esp_err_t crash_diag_get_last_stall(crash_diag_stall_t *out)
+{
+    if (!out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_rtc.magic != RTC_STALL_MAGIC) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *out = s_rtc.stall;
+    return ESP_OK;
+}
@@ -0,0 +1,352 @@
+// SPDX-License-Identifier: MIT
+#include "crash_diag_priv.h"
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <string.h>
+
+static const char *TAG = "crash_diag";
+
+/**
+ * Offenders of the running boot, rewritten after every sample. RTC_NOINIT
+ * like the other crash_diag RTC blocks; magic is cleared while the block is
+ * being rewritten so a reset mid-update leaves it marked invalid rather than
+ * half old, half new.
+ */
+typedef struct {
+    uint32_t magic;
+    crash_diag_task_offenders_t top;
+} rtc_task_data_t;
+
+#define RTC_TASKS_MAGIC 0x7A5C0FFE
+
+static RTC_NOINIT_ATTR rtc_task_data_t s_rtc;
+static crash_diag_task_offenders_t s_prev_boot;
+static bool s_prev_valid;
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+
+/* Two preallocated snapshots swapped each sample: CPU is the runtime
+ * counter delta between them. Only the esp_timer task touches these. */
+static TaskStatus_t s_snap[2][CRASH_DIAG_MAX_TASKS];
+static UBaseType_t  s_snap_n[2];
+static uint32_t     s_snap_total[2];
+static uint8_t      s_cur;
+
+/* Per-task table keyed by FreeRTOS task number */
+typedef struct {
+    UBaseType_t number;
+    crash_diag_task_stat_t stat;
+} tracked_task_t;
+
+static tracked_task_t s_tracked[CRASH_DIAG_MAX_TASKS];
+static size_t         s_tracked_n;
+static crash_diag_task_offenders_t s_latest;
+static uint32_t       s_boot_count;
+static bool           s_sampled;
+static esp_timer_handle_t s_timer;
+
+/* Sampler (esp_timer task) vs API readers; both are tasks */
+static SemaphoreHandle_t s_lock;
+static StaticSemaphore_t s_lock_buf;
+
+static tracked_task_t *track(const TaskStatus_t *t)
+{
+    for (size_t i = 0; i < s_tracked_n; i++) {
+        if (s_tracked[i].number == t->xTaskNumber) {
+            return &s_tracked[i];
+        }
+    }
+    tracked_task_t *slot = NULL;
+    if (s_tracked_n < CRASH_DIAG_MAX_TASKS) {
+        slot = &s_tracked[s_tracked_n++];
+    } else {
+        /* Table full: reuse a deleted task's slot */
+        for (size_t i = 0; i < s_tracked_n && !slot; i++) {
+            if (!s_tracked[i].stat.alive) {
+                slot = &s_tracked[i];
+            }
+        }
+        if (!slot) {
+            return NULL;
+        }
+    }
+    memset(slot, 0, sizeof(*slot));
+    slot->number = t->xTaskNumber;
+    slot->stat.min_stack_free = UINT32_MAX;
+    strncpy(slot->stat.name, t->pcTaskName, CRASH_DIAG_TASK_NAME_LEN - 1);
+    return slot;
+}
+
+static bool is_idle_task(const char *name)
+{
+    return strncmp(name, "IDLE", 4) == 0;
+}
+
+/* Insert into a fixed top-N list ordered by `better` */
+static void top_insert(crash_diag_task_stat_t *list, uint8_t *count, const crash_diag_task_stat_t *s,
+                       bool (*better)(const crash_diag_task_stat_t *, const crash_diag_task_stat_t *))
+{
+    uint8_t pos = *count;
+    while (pos > 0 && better(s, &list[pos - 1])) {
+        pos--;
+    }
+    if (pos >= CRASH_DIAG_TOP_TASKS) {
+        return;
+    }
+    uint8_t last = *count < CRASH_DIAG_TOP_TASKS ? *count : CRASH_DIAG_TOP_TASKS - 1;
+    memmove(&list[pos + 1], &list[pos], (last - pos) * sizeof(*list));
+    list[pos] = *s;
+    if (*count < CRASH_DIAG_TOP_TASKS) {
+        (*count)++;
+    }
+}
+
+static bool less_headroom(const crash_diag_task_stat_t *a, const crash_diag_task_stat_t *b)
+{
+    return a->min_stack_free < b->min_stack_free;
+}
+
+static bool more_cpu(const crash_diag_task_stat_t *a, const crash_diag_task_stat_t *b)
+{
+    return a->cpu_permille > b->cpu_permille;
+}
+
+static void sample_timer_cb(void *arg)
+{
+    (void)arg;
+    uint8_t prev = s_cur;
+    uint8_t cur = (uint8_t)(s_cur ^ 1);
+    s_snap_n[cur] = uxTaskGetSystemState(s_snap[cur], CRASH_DIAG_MAX_TASKS, &s_snap_total[cur]);
+    if (s_snap_n[cur] == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, sampler skipped", CRASH_DIAG_MAX_TASKS);
+        return;
+    }
+    s_cur = cur;
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    /* Counters are per core; the window holds that much time on each */
+    uint32_t window = (s_snap_total[cur] - s_snap_total[prev]) * portNUM_PROCESSORS;
+    bool have_cpu = s_sampled && window > 0;
+#else
+    (void)prev;
+#endif
+
+    crash_diag_task_offenders_t top;
+    memset(&top, 0, sizeof(top));
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    /* Liveness first: when the table is full, track() reuses a slot whose
+     * task is missing from this snapshot, never one not yet visited below */
+    for (size_t i = 0; i < s_tracked_n; i++) {
+        uint8_t alive = 0;
+        for (UBaseType_t j = 0; j < s_snap_n[cur] && !alive; j++) {
+            alive = s_snap[cur][j].xTaskNumber == s_tracked[i].number;
+        }
+        s_tracked[i].stat.alive = alive;
+    }
+    for (UBaseType_t i = 0; i < s_snap_n[cur]; i++) {
+        const TaskStatus_t *t = &s_snap[cur][i];
+        tracked_task_t *tt = track(t);
+        if (!tt) {
+            continue;
+        }
+        crash_diag_task_stat_t *st = &tt->stat;
+        st->alive = 1;
+        st->priority = (uint8_t)t->uxCurrentPriority;
+        uint32_t free_bytes = (uint32_t)t->usStackHighWaterMark * sizeof(StackType_t);
+        if (free_bytes < st->min_stack_free) {
+            st->min_stack_free = free_bytes;
+        }
+        st->cpu_permille = 0;
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+        if (have_cpu) {
+            for (UBaseType_t j = 0; j < s_snap_n[prev]; j++) {
+                if (s_snap[prev][j].xTaskNumber == t->xTaskNumber) {
+                    uint32_t d = t->ulRunTimeCounter - s_snap[prev][j].ulRunTimeCounter;
+                    st->cpu_permille = (uint16_t)((uint64_t)d * 1000 / window);
+                    break;
+                }
+            }
+        }
+#endif
+    }
+    for (size_t i = 0; i < s_tracked_n; i++) {
+        const crash_diag_task_stat_t *st = &s_tracked[i].stat;
+        top_insert(top.stack, &top.stack_count, st, less_headroom);
+        if (st->alive && st->cpu_permille && !is_idle_task(st->name)) {
+            top_insert(top.cpu, &top.cpu_count, st, more_cpu);
+        }
+    }
+    top.boot_count = s_boot_count;
+    top.uptime_sec = (uint32_t)(esp_timer_get_time() / 1000000);
+    s_latest = top;
+    s_sampled = true;
+    xSemaphoreGive(s_lock);
+
+    s_rtc.magic = 0;
+    s_rtc.top = top;
+    s_rtc.magic = RTC_TASKS_MAGIC;
+}
+
+void crash_diag_tasks_init(uint32_t period_sec, uint32_t boot_count)
+{
+    if (s_rtc.magic == RTC_TASKS_MAGIC && s_rtc.top.stack_count <= CRASH_DIAG_TOP_TASKS &&
+        s_rtc.top.cpu_count <= CRASH_DIAG_TOP_TASKS) {
+        s_prev_boot = s_rtc.top;
+        s_prev_valid = true;
+        if (s_prev_boot.stack_count) {
+            const crash_diag_task_stat_t *w = &s_prev_boot.stack[0];
+            ESP_LOGI(TAG, "Previous boot: least stack headroom '%s' %lu B",
+                     w->name, w->min_stack_free);
+        }
+    }
+    s_rtc.magic = 0;
+    s_boot_count = boot_count;
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+    }
+
+    if (period_sec == 0 || s_timer) {
+        return;
+    }
+    const esp_timer_create_args_t args = {
+        .callback = sample_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "crash_diag_task",
+        .skip_unhandled_events = true,
+    };
+    esp_err_t err = esp_timer_create(&args, &s_timer);
+    if (err == ESP_OK) {
+        err = esp_timer_start_periodic(s_timer, (uint64_t)period_sec * 1000000);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Task sampler unavailable: %s", esp_err_to_name(err));
+    }
+}
+
+uint32_t crash_diag_tasks_stack_free(const char *name)
+{
+    /* Called from the TWDT ISR: no lock, a sample racing this read only
+     * makes the figure one period staler */
+    for (size_t i = 0; i < s_tracked_n; i++) {
+        if (strncmp(s_tracked[i].stat.name, name, CRASH_DIAG_TASK_NAME_LEN) == 0) {
+            return s_tracked[i].stat.min_stack_free;
+        }
+    }
+    return UINT32_MAX;
+}
+
+bool crash_diag_tasks_at(size_t i, crash_diag_task_stat_t *out)
+{
+    if (!s_lock) {
+        return false;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool ok = i < s_tracked_n;
+    if (ok) {
+        *out = s_tracked[i].stat;
+    }
+    xSemaphoreGive(s_lock);
+    return ok;
+}
+
+esp_err_t crash_diag_get_task_stats(crash_diag_task_stat_t *out, size_t max, size_t *count)
+{
+    if (!count || (max && !out)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_lock) {
+        *count = 0;
+        return ESP_OK;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    size_t n = s_tracked_n < max ? s_tracked_n : max;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = s_tracked[i].stat;
+    }
+    xSemaphoreGive(s_lock);
+    *count = n;
+    return ESP_OK;
+}
+
+esp_err_t crash_diag_get_task_offenders(crash_diag_task_offenders_t *out, bool previous_boot)
+{
+    if (!out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (previous_boot) {
+        if (!s_prev_valid) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        *out = s_prev_boot;
+        return ESP_OK;
+    }
+    if (!s_lock) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool ok = s_sampled;
+    if (ok) {
+        *out = s_latest;
+    }
+    xSemaphoreGive(s_lock);
+    return ok ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+#else  /* !CONFIG_FREERTOS_USE_TRACE_FACILITY */
+
+void crash_diag_tasks_init(uint32_t period_sec, uint32_t boot_count)
+{
+    (void)boot_count;
+    if (s_rtc.magic == RTC_TASKS_MAGIC) {
+        s_prev_boot = s_rtc.top;
+        s_prev_valid = true;
+    }
+    s_rtc.magic = 0;
+    if (period_sec) {
+        ESP_LOGW(TAG, "Task sampler needs CONFIG_FREERTOS_USE_TRACE_FACILITY");
+    }
+}
+
+uint32_t crash_diag_tasks_stack_free(const char *name)
+{
+    (void)name;
+    return UINT32_MAX;
+}
+
+bool crash_diag_tasks_at(size_t i, crash_diag_task_stat_t *out)
+{
+    (void)i;
+    (void)out;
+    return false;
+}
+
+esp_err_t crash_diag_get_task_stats(crash_diag_task_stat_t *out, size_t max, size_t *count)
+{
+    (void)out;
+    (void)max;
+    if (count) {
+        *count = 0;
+    }
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t crash_diag_get_task_offenders(crash_diag_task_offenders_t *out, bool previous_boot)
+{
+    if (!out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!previous_boot || !s_prev_valid) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *out = s_prev_boot;
+    return ESP_OK;
+}
+
+#endif /* CONFIG_FREERTOS_USE_TRACE_FACILITY */
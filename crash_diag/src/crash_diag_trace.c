@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: MIT
+#include "crash_diag_priv.h"
+#include "crash_diag_trace.h"
+
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+static const char *TAG = "crash_diag";
+
+#if CONFIG_CRASH_DIAG_TRACE
+
+#define TRACE_LEN  CONFIG_CRASH_DIAG_TRACE_LEN
+#define TRACE_MASK (TRACE_LEN - 1)
+
+_Static_assert((TRACE_LEN & TRACE_MASK) == 0, "CONFIG_CRASH_DIAG_TRACE_LEN must be a power of two");
+
+/**
+ * Per-core rings in RTC memory (RTC_NOINIT, see crash_diag.c). `written`
+ * mirrors the RAM counter after each event so the next boot knows where
+ * each ring ends; an ISR that preempts an emit between its claim and its
+ * mirror store can leave it one short, which only hides that one event.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t written[portNUM_PROCESSORS];
+    crash_diag_trace_event_t ev[portNUM_PROCESSORS][TRACE_LEN];
+} rtc_trace_t;
+
+#define RTC_TRACE_MAGIC 0x7EACE016
+
+static RTC_NOINIT_ATTR rtc_trace_t s_rtc;
+static uint32_t s_written[portNUM_PROCESSORS];  /* claim counters, RAM for atomics */
+static bool s_armed;
+static rtc_trace_t *s_prev;                     /* previous boot's rings after a crash */
+
+void IRAM_ATTR crash_diag_trace(uint16_t id, uint32_t arg0, uint32_t arg1)
+{
+    if (!s_armed) {
+        return;
+    }
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    int core = esp_cpu_get_core_id();
+    uint32_t n = __atomic_fetch_add(&s_written[core], 1, __ATOMIC_RELAXED);
+
+    crash_diag_trace_event_t *e = &s_rtc.ev[core][n & TRACE_MASK];
+    e->ts_us = now;
+    e->id    = id;
+    e->core  = (uint8_t)core;
+    e->arg0  = arg0;
+    e->arg1  = arg1;
+    s_rtc.written[core] = n + 1;
+}
+
+void crash_diag_trace_init(uint8_t reset_reason)
+{
+    if (s_rtc.magic == RTC_TRACE_MAGIC && crash_diag_is_crash_reset(reset_reason) && !s_prev) {
+        s_prev = heap_caps_malloc(sizeof(*s_prev), MALLOC_CAP_INTERNAL);
+        if (s_prev) {
+            memcpy(s_prev, &s_rtc, sizeof(*s_prev));
+            uint32_t kept = 0;
+            for (int c = 0; c < portNUM_PROCESSORS; c++) {
+                kept += s_prev->written[c] < TRACE_LEN ? s_prev->written[c] : TRACE_LEN;
+            }
+            ESP_LOGW(TAG, "Kept %lu trace events from the crashed boot", kept);
+        } else {
+            ESP_LOGW(TAG, "No memory to keep the previous boot's trace");
+        }
+    }
+    s_armed = false;
+    memset(s_written, 0, sizeof(s_written));
+    memset(&s_rtc, 0, sizeof(s_rtc));
+    s_rtc.magic = RTC_TRACE_MAGIC;
+    s_armed = true;
+}
+
+/* Newest `max` events of all rings, merged by timestamp, oldest first */
+static size_t collect(const rtc_trace_t *t, const uint32_t *written,
+                      crash_diag_trace_event_t *out, size_t max)
+{
+    uint32_t left[portNUM_PROCESSORS];
+    uint32_t next[portNUM_PROCESSORS];  /* index of the newest not yet taken */
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        left[c] = written[c] < TRACE_LEN ? written[c] : TRACE_LEN;
+        next[c] = written[c] - 1;
+    }
+
+    /* Fill from the back, newest first */
+    size_t n = 0;
+    while (n < max) {
+        int best = -1;
+        for (int c = 0; c < portNUM_PROCESSORS; c++) {
+            if (left[c] && (best < 0 ||
+                (int32_t)(t->ev[c][next[c] & TRACE_MASK].ts_us -
+                          t->ev[best][next[best] & TRACE_MASK].ts_us) > 0)) {
+                best = c;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        out[max - 1 - n] = t->ev[best][next[best] & TRACE_MASK];
+        left[best]--;
+        next[best]--;
+        n++;
+    }
+    if (n < max) {
+        memmove(out, out + (max - n), n * sizeof(*out));
+    }
+    return n;
+}
+
+esp_err_t crash_diag_get_trace(crash_diag_trace_event_t *out, size_t max, size_t *count,
+                               bool previous_boot)
+{
+    if (!count || (max && !out)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *count = 0;
+    if (previous_boot) {
+        if (!s_prev) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        *count = collect(s_prev, s_prev->written, out, max);
+        return ESP_OK;
+    }
+    /* Live rings: snapshot the counters; events racing the copy may be torn */
+    uint32_t written[portNUM_PROCESSORS];
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        written[c] = __atomic_load_n(&s_written[c], __ATOMIC_RELAXED);
+    }
+    *count = collect(&s_rtc, written, out, max);
+    return ESP_OK;
+}
+
+#else  /* !CONFIG_CRASH_DIAG_TRACE */
+
+void crash_diag_trace(uint16_t id, uint32_t arg0, uint32_t arg1)
+{
+    (void)id;
+    (void)arg0;
+    (void)arg1;
+}
+
+void crash_diag_trace_init(uint8_t reset_reason)
+{
+    (void)reset_reason;
+    (void)TAG;
+}
+
+esp_err_t crash_diag_get_trace(crash_diag_trace_event_t *out, size_t max, size_t *count,
+                               bool previous_boot)
+{
+    (void)out;
+    (void)max;
+    (void)previous_boot;
+    if (count) {
+        *count = 0;
+    }
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif /* CONFIG_CRASH_DIAG_TRACE */
@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: MIT
+/**
+ * @file index_bench.c
+ * @brief Host-side correctness and throughput benchmark for ota_index_scan.
+ *
+ * Fixtures: generated indexes of 10 to 1000 entries shaped like the public
+ * Zigbee OTA indexes (urls, sha512 hashes, release notes, nested arrays),
+ * with the device's entry first, in the middle, last or missing, and its
+ * fileVersion as a number or a hex string.
+ *
+ * Correctness: every fixture is scanned whole, in 512-byte chunks (what
+ * ota_check reads) and one byte at a time, and must give the expected
+ * result each way; a set of hand-written edge cases (escapes, duplicate
+ * keys, deep nesting, malformed and truncated bodies) must too.
+ *
+ * Throughput: MB/s and ns per entry for a scan that stops at the middle
+ * entry and a full one (entry missing, the worst case), plus heap
+ * allocations during scanning, which must be zero.
+ * The exit code says whether everything passed.
+ *
+ * Usage:
+ *   make run
+ *   ./index_bench -n 200      # scans per fixture for the timing
+ */
+
+#include "ota_index_scan.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MFR_CODE    0x131B
+#define IMAGE_TYPE  0x0102
+#define VERSION     0x01020304u
+#define CHUNK       512
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void  __real_free(void *ptr);
+
+static unsigned long s_allocs = 0;
+
+void *__wrap_malloc(size_t size)             { s_allocs++; return __real_malloc(size); }
+void *__wrap_calloc(size_t n, size_t size)   { s_allocs++; return __real_calloc(n, size); }
+void *__wrap_realloc(void *ptr, size_t size) { s_allocs++; return __real_realloc(ptr, size); }
+void  __wrap_free(void *ptr)                 { __real_free(ptr); }
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* xorshift32: deterministic across runs and hosts */
+static uint32_t s_rng = 0x12345678;
+
+static inline uint32_t rng_u32(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static int s_failures = 0;
+
+/* ================================================================== */
+/*  Fixtures                                                           */
+/* ================================================================== */
+
+typedef enum { AT_FIRST, AT_MIDDLE, AT_LAST, AT_NONE } placement_t;
+
+static const char *const s_placement_names[] = { "first", "middle", "last", "none" };
+
+typedef struct {
+    char  *buf;
+    size_t len;
+    size_t cap;
+} text_t;
+
+static void put(text_t *t, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void put(text_t *t, const char *fmt, ...)
+{
+    va_list ap;
+    for (;;) {
+        va_start(ap, fmt);
+        int n = vsnprintf(t->buf + t->len, t->cap - t->len, fmt, ap);
+        va_end(ap);
+        if ((size_t)n < t->cap - t->len) {
+            t->len += n;
+            return;
+        }
+        t->cap = t->cap * 2 + n;
+        t->buf = realloc(t->buf, t->cap);
+        if (!t->buf) {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+    }
+}
+
+static void put_entry(text_t *t, uint16_t mfr, uint16_t img, uint32_t ver, bool ver_string)
+{
+    put(t, "{\"fileName\":\"%04X-%04X-%08X.ota\",", mfr, img, ver);
+    if (ver_string) put(t, "\"fileVersion\":\"0x%08X\",", ver);
+    else            put(t, "\"fileVersion\":%u,", ver);
+    put(t, "\"fileSize\":%u,\"url\":\"https://github.com/example/zigbee-ota/raw/master/images/"
+           "%04X/%04X-%08X.ota\",", 150000 + rng_u32() % 400000, mfr, mfr, ver);
+    put(t, "\"imageType\":%u,\"manufacturerCode\":%u,\"sha512\":\"", img, mfr);
+    for (int i = 0; i < 16; i++) put(t, "%08x", rng_u32());
+    put(t, "\",\"otaHeaderString\":\"\\\"fw\\\" %u\\u0000\",", ver & 0xFF);
+    put(t, "\"releaseNotes\":\"Fixes, {braces} and [brackets] in text\",");
+    put(t, "\"manufacturerName\":[\"_TZ3000_%04x\",\"_TZ3210_%04x\"],",
+        rng_u32() & 0xFFFF, rng_u32() & 0xFFFF);
+    put(t, "\"extra\":{\"force\":false,\"minFileVersion\":0,\"hardwareVersions\":{\"min\":1,\"max\":2e0}}}");
+}
+
+/* A pretty-printed index with `n` entries; ours placed as asked */
+static text_t make_index(int n, placement_t at, bool ver_string)
+{
+    text_t t = { .cap = 4096 };
+    t.buf = malloc(t.cap);
+    int ours = at == AT_FIRST ? 0 : at == AT_MIDDLE ? n / 2 : at == AT_LAST ? n - 1 : -1;
+    put(&t, "[\n");
+    for (int i = 0; i < n; i++) {
+        if (i == ours) {
+            put_entry(&t, MFR_CODE, IMAGE_TYPE, VERSION, ver_string);
+        } else {
+            /* Neighbours: same manufacturer other image types, or other vendors */
+            uint16_t mfr = (i % 3) ? (uint16_t)(0x1000 + i) : MFR_CODE;
+            uint16_t img = (uint16_t)(mfr == MFR_CODE ? 0x2000 + i : IMAGE_TYPE);
+            put_entry(&t, mfr, img, 0x00010000u + i, (i & 1) != 0);
+        }
+        put(&t, i + 1 < n ? ",\n  " : "\n");
+    }
+    put(&t, "]\n");
+    return t;
+}
+
+/* ================================================================== */
+/*  Correctness                                                        */
+/* ================================================================== */
+
+static ota_index_scan_status_t scan(const char *data, size_t len, size_t chunk, uint32_t *ver)
+{
+    ota_index_scan_t s;
+    ota_index_scan_init(&s, MFR_CODE, IMAGE_TYPE);
+    for (size_t off = 0; off < len && s.status == OTA_INDEX_SCAN_MORE; off += chunk) {
+        ota_index_scan_feed(&s, data + off, len - off < chunk ? len - off : chunk);
+    }
+    *ver = s.file_version;
+    return (ota_index_scan_status_t)s.status;
+}
+
+static void expect(const char *name, const char *data, size_t len,
+                   ota_index_scan_status_t want, uint32_t want_ver)
+{
+    static const size_t chunks[] = { (size_t)-1, CHUNK, 7, 1 };
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        uint32_t ver;
+        ota_index_scan_status_t got = scan(data, len, chunks[i] > len ? len + 1 : chunks[i], &ver);
+        if (got != want || (want == OTA_INDEX_SCAN_FOUND && ver != want_ver)) {
+            fprintf(stderr, "FAIL %s (chunk %zu): status %d version 0x%08X, want %d 0x%08X\n",
+                    name, chunks[i] > len ? len : chunks[i], got, ver, want, want_ver);
+            s_failures++;
+            return;
+        }
+    }
+}
+
+/* A matching entry whose first value is `levels` nested arrays */
+static int make_deep(char *out, int levels)
+{
+    int n = sprintf(out, "[{\"a\":");
+    for (int i = 0; i < levels; i++) out[n++] = '[';
+    for (int i = 0; i < levels; i++) out[n++] = ']';
+    n += sprintf(out + n, ",\"manufacturerCode\":4891,\"imageType\":258,\"fileVersion\":1}]");
+    return n;
+}
+
+#define EXPECT(json, want, ver) expect(json, json, strlen(json), want, ver)
+
+static void check_edge_cases(void)
+{
+    const ota_index_scan_status_t F = OTA_INDEX_SCAN_FOUND, D = OTA_INDEX_SCAN_DONE;
+    const ota_index_scan_status_t E = OTA_INDEX_SCAN_ERROR, M = OTA_INDEX_SCAN_MORE;
+
+    EXPECT("[]", D, 0);
+    EXPECT(" \n[ ]\n", D, 0);
+    EXPECT("[{\"manufacturerCode\":4891,\"imageType\":258,\"fileVersion\":16909060}]", F, VERSION);
+    EXPECT("[{\"fileVersion\":\"0x01020304\",\"imageType\":258,\"manufacturerCode\":4891}]", F, VERSION);
+    EXPECT("[{\"fileVersion\":\"16909060\",\"imageType\":258,\"manufacturerCode\":4891}]", F, VERSION);
+    /* Key names compare case-insensitively, like cJSON_GetObjectItem() */
+    EXPECT("[{\"MANUFACTURERCODE\":4891,\"imagetype\":258,\"FileVersion\":5}]", F, 5);
+    /* First occurrence of a key counts */
+    EXPECT("[{\"manufacturerCode\":4891,\"imageType\":258,\"fileVersion\":5,\"fileVersion\":6}]", F, 5);
+    EXPECT("[{\"manufacturerCode\":1,\"manufacturerCode\":4891,\"imageType\":258,\"fileVersion\":5}]", D, 0);
+    /* Entry without a usable fileVersion is skipped, a later one still matches */
+    EXPECT("[{\"manufacturerCode\":4891,\"imageType\":258},"
+           "{\"manufacturerCode\":4891,\"imageType\":258,\"fileVersion\":null},"
+           "{\"manufacturerCode\":4891,\"imageType\":258,\"fileVersion\":7}]", F, 7);
+    /* Codes given as strings do not match (cJSON valueint of a string is 0) */
+    EXPECT("[{\"manufacturerCode\":\"4891\",\"imageType\":258,\"fileVersion\":5}]", D, 0);
+    /* Matching keys nested below the entry are not the entry's */
+    EXPECT("[{\"x\":{\"manufacturerCode\":4891,\"imageType\":258,\"fileVersion\":5}}]", D, 0);
+    EXPECT("[{\"x\":[{\"manufacturerCode\":4891}],\"manufacturerCode\":4891,"
+           "\"imageType\":258,\"fileVersion\":9}]", F, 9);
+    /* Escapes, including an escaped quote ending in what looks like a key */
+    EXPECT("[{\"n\":\"a\\\\\",\"manufacturerCode\":4891,\"imageType\":258,\"fileVersion\":3}]", F, 3);
+    EXPECT("[{\"n\":\"\\\",\\\"manufacturerCode\\\":4891\",\"imageType\":258,\"fileVersion\":3}]", D, 0);
+    EXPECT("[{\"file\\u0056ersion\":3,\"manufacturerCode\":4891,\"imageType\":258}]", D, 0);
+    /* Over-long keys and values are skipped */
+    EXPECT("[{\"manufacturerCodeButMuchLongerThanAnyKey\":4891,\"imageType\":258,\"fileVersion\":3}]", D, 0);
+    EXPECT("[{\"manufacturerCode\":4891,\"imageType\":258,"
+           "\"fileVersion\":\"0x000000000000000000000000000001\"}]", D, 0);
+    /* Non-object entries are ignored */
+    EXPECT("[1,\"x\",[{\"manufacturerCode\":4891}],true,"
+           "{\"manufacturerCode\":4891,\"imageType\":258,\"fileVersion\":2}]", F, 2);
+    /* Deep nesting up to the limit, then one past it */
+    {
+        char deep[160];
+        int n = make_deep(deep, OTA_INDEX_SCAN_MAX_DEPTH - 2);
+        expect("nesting limit", deep, n, F, 1);
+        n = make_deep(deep, OTA_INDEX_SCAN_MAX_DEPTH - 1);
+        expect("nesting limit + 1", deep, n, E, 0);
+    }
+    /* Malformed or not an index */
+    EXPECT("{\"manufacturerCode\":4891}", E, 0);
+    EXPECT("\"text\"", E, 0);
+    EXPECT("<html>", E, 0);
+    EXPECT("[{]", E, 0);
+    EXPECT("[}", E, 0);
+    EXPECT("[{\"a\":1]}", E, 0);
+    EXPECT("[{\"a\":#}]", E, 0);
+    EXPECT("[]]", D, 0);        /* trailing data after the index is not read */
+    /* Truncated */
+    EXPECT("", M, 0);
+    EXPECT("[{\"manufacturerCode\":4891,\"imageType\":258,\"fileVersion\":5", M, 0);
+    EXPECT("[{\"manufacturerCode\":1,\"imageType\":258,\"fileVersion\":5},", M, 0);
+    /* ...but a complete matching entry is enough */
+    EXPECT("[{\"manufacturerCode\":4891,\"imageType\":258,\"fileVersion\":5},{\"x", F, 5);
+}
+
+static void check_fixtures(const int *sizes, size_t n_sizes)
+{
+    for (size_t i = 0; i < n_sizes; i++) {
+        for (int at = AT_FIRST; at <= AT_NONE; at++) {
+            for (int vs = 0; vs <= 1; vs++) {
+                text_t t = make_index(sizes[i], at, vs);
+                char name[64];
+                snprintf(name, sizeof(name), "%d entries, %s, %s version",
+                         sizes[i], s_placement_names[at], vs ? "string" : "numeric");
+                expect(name, t.buf, t.len,
+                       at == AT_NONE ? OTA_INDEX_SCAN_DONE : OTA_INDEX_SCAN_FOUND, VERSION);
+                free(t.buf);
+            }
+        }
+    }
+}
+
+/* ================================================================== */
+/*  Throughput                                                         */
+/* ================================================================== */
+
+static void bench(const int *sizes, size_t n_sizes, int iterations)
+{
+    printf("\n%8s %10s %10s %10s %12s %8s %10s\n",
+           "entries", "bytes", "us/scan", "MB/s", "ns/entry", "allocs", "match");
+    for (size_t i = 0; i < n_sizes; i++) {
+        for (int at = AT_MIDDLE; at <= AT_NONE; at += AT_NONE - AT_MIDDLE) {
+            text_t t = make_index(sizes[i], at, false);
+            ota_index_scan_t s;
+
+            unsigned long allocs_before = s_allocs;
+            uint64_t start = now_ns();
+            for (int k = 0; k < iterations; k++) {
+                ota_index_scan_init(&s, MFR_CODE, IMAGE_TYPE);
+                for (size_t off = 0; off < t.len && s.status == OTA_INDEX_SCAN_MORE; off += CHUNK) {
+                    ota_index_scan_feed(&s, t.buf + off, t.len - off < CHUNK ? t.len - off : CHUNK);
+                }
+            }
+            uint64_t total = now_ns() - start;
+            unsigned long allocs = s_allocs - allocs_before;
+
+            double ns = (double)total / iterations;
+            printf("%8d %10zu %10.1f %10.1f %12.1f %8lu %10s\n",
+                   sizes[i], s.offset, ns / 1e3, s.offset / (ns / 1e3), ns / s.entries,
+                   allocs, s_placement_names[at]);
+            if (allocs) {
+                fprintf(stderr, "FAIL: %lu heap allocations while scanning\n", allocs);
+                s_failures++;
+            }
+            free(t.buf);
+        }
+    }
+    printf("\nsizeof(ota_index_scan_t) = %zu bytes, nesting limit %d\n",
+           sizeof(ota_index_scan_t), OTA_INDEX_SCAN_MAX_DEPTH);
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 200;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-n scans]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (iterations < 1) iterations = 1;
+
+    static const int sizes[] = { 10, 30, 100, 300, 1000 };
+    check_edge_cases();
+    check_fixtures(sizes, sizeof(sizes) / sizeof(sizes[0]));
+    printf("correctness: %s\n", s_failures ? "FAILED" : "ok (whole, 512 B, 7 B and 1 B chunks)");
+
+    bench(sizes, sizeof(sizes) / sizeof(sizes[0]), iterations);
+
+    if (s_failures) {
+        fprintf(stderr, "FAIL: %d check(s)\n", s_failures);
+        return 1;
+    }
+    return 0;
+}
@@ -35,6 +35,35 @@ void ota_check_trigger(void);
 /** True if the latest index version is newer than the running firmware. */
 bool ota_check_available(void);
 
+/**
+ * Index fetch counters since boot. Checks send If-None-Match /
+ * If-Modified-Since with the validators of the last full download (kept in
+ * NVS with its result), so an unchanged index costs a 304 and no parse.
+ *
+ * The HTTP client persists between checks: with
+ * CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS a new connection resumes the last
+ * TLS session, and a connection is kept open for 30 s after a check that
+ * read the whole response. Heap peaks are measured as the drop in free
+ * internal heap during the check, so other tasks' allocations count too.
+ */
+typedef struct {
+    uint32_t checks;          /**< Checks answered with 200 or 304 */
+    uint32_t not_modified;    /**< ... of which 304 Not Modified */
+    uint32_t last_bytes;      /**< Index bytes received by the last check (0 on 304) */
+    uint32_t last_parse_us;   /**< Parse time of the last check (0 on 304) */
+    uint64_t total_bytes;     /**< Index bytes received */
+    uint64_t saved_bytes;     /**< Index bytes not downloaded thanks to 304s */
+    uint64_t saved_parse_us;  /**< Parse time avoided (cached index's parse time per 304) */
+    uint32_t connections;     /**< Checks that opened a new connection */
+    uint32_t reused;          /**< Checks sent on a kept-alive connection */
+    uint32_t last_connect_us; /**< DNS + TCP + TLS handshake of the last check (0 if reused) */
+    uint32_t last_heap_peak;  /**< Internal heap in use by the last check at its peak (bytes) */
+    uint32_t max_heap_peak;   /**< Largest last_heap_peak since boot */
+} ota_check_stats_t;
+
+/** Copy the index fetch counters. */
+void ota_check_get_stats(ota_check_stats_t *out);
+
 /**
  * Version string of the latest available firmware, e.g. "2.2.4".
  * Empty string if no update is available or no check has completed.
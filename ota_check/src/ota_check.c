@@ -1,8 +1,11 @@
 // SPDX-License-Identifier: MIT
 #include "ota_check.h"
+#include "ota_index_scan.h"
 #include "zigbee_ota.h"
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
+#include "esp_heap_caps.h"
+#include "esp_idf_version.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
@@ -10,8 +13,8 @@
 #include "freertos/semphr.h"
 #include "nvs_flash.h"
 #include "nvs.h"
-#include "cJSON.h"
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 
 #define TAG                "ota_check"
@@ -19,11 +22,21 @@
     "https://shaunpccom.github.io/zigbee-ota-index/ota_index.json"
 #define OTA_MFR_CODE       0x131B
 #define DEFAULT_INTERVAL_H 12
-#define INDEX_BUF_SIZE     6144
+#define INDEX_CHUNK_SIZE   512
 #define INDEX_URL_MAX      256
 #define NVS_NAMESPACE_MAX  32
 #define NVS_KEY_INTERVAL   "ota_chk_int"
 #define NVS_KEY_INDEX_URL  "ota_idx_url"
+#define NVS_KEY_INDEX_CACHE "ota_idx_cache"
+#define ETAG_MAX           80
+#define LAST_MODIFIED_MAX  40
+#define INDEX_CACHE_VERSION 1
+#define KEEPALIVE_IDLE_MS  30000
+#define NOTIFY_CHECK       (1u << 0)
+#define NOTIFY_IDLE        (1u << 1)    /* connection kept: re-arm the idle close */
+
+/* Watch the heap's minimum free size over a window (IDF 5.3+) */
+#define HAVE_LOCAL_HEAP_MIN (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0))
 
 static bool               s_available = false;
 static char               s_latest_version[16] = "";
@@ -31,100 +44,380 @@ static char               s_index_url[INDEX_URL_MAX] = OTA_INDEX_URL_DEFAULT;
 static esp_timer_handle_t s_timer = NULL;
 static TaskHandle_t       s_task  = NULL;
 static SemaphoreHandle_t  s_mutex = NULL;
-static char               s_buf[INDEX_BUF_SIZE];   /* static — not on task stack */
+static char               s_buf[INDEX_CHUNK_SIZE]; /* static — not on task stack */
 
 /* Device-specific config (set in ota_check_init) */
 static uint16_t s_image_type      = 0;
 static uint32_t s_current_version = 0;
 static char     s_nvs_namespace[NVS_NAMESPACE_MAX] = "";
 
+/* Persistent client (see get_client) */
+static esp_http_client_handle_t s_client = NULL;
+static bool                     s_conn_open = false;
+static int64_t                  s_conn_used_us = 0;
+
+/* Free internal heap at the start of the check and the lowest seen since */
+static size_t s_heap_before;
+static size_t s_heap_low;
+
+static inline void heap_sample(void)
+{
+    size_t free_now = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    if (free_now < s_heap_low) s_heap_low = free_now;
+}
+
+/* Result of the last full index download, persisted with the validators the
+ * server sent for it so later checks can be conditional requests */
+typedef struct {
+    uint8_t  version;
+    uint8_t  found;                 /* index had an entry for image_type */
+    uint16_t image_type;
+    uint32_t latest_hex;
+    uint32_t body_len;              /* index size, i.e. what a 304 saves */
+    uint32_t parse_us;              /* time its parse took */
+    char     etag[ETAG_MAX];
+    char     last_modified[LAST_MODIFIED_MAX];
+} index_cache_t;
+
+static index_cache_t s_cache;
+static bool          s_cache_valid = false;
+
+/* Validators of the response being fetched (HTTP_EVENT_ON_HEADER) */
+static char s_resp_etag[ETAG_MAX];
+static char s_resp_last_modified[LAST_MODIFIED_MAX];
+
+static ota_check_stats_t s_stats;
+static portMUX_TYPE      s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* ── Index cache (NVS) ─────────────────────────────────────────────────── */
+
+static void load_index_cache(void)
+{
+    s_cache_valid = false;
+    nvs_handle_t h;
+    if (nvs_open(s_nvs_namespace, NVS_READONLY, &h) != ESP_OK) return;
+    size_t len = sizeof(s_cache);
+    esp_err_t err = nvs_get_blob(h, NVS_KEY_INDEX_CACHE, &s_cache, &len);
+    nvs_close(h);
+    if (err != ESP_OK || len != sizeof(s_cache) || s_cache.version != INDEX_CACHE_VERSION ||
+        s_cache.image_type != s_image_type) {
+        return;
+    }
+    s_cache.etag[ETAG_MAX - 1] = '\0';
+    s_cache.last_modified[LAST_MODIFIED_MAX - 1] = '\0';
+    s_cache_valid = true;
+}
+
+static void save_index_cache(void)
+{
+    nvs_handle_t h;
+    if (nvs_open(s_nvs_namespace, NVS_READWRITE, &h) != ESP_OK) return;
+    if (nvs_set_blob(h, NVS_KEY_INDEX_CACHE, &s_cache, sizeof(s_cache)) == ESP_OK) {
+        nvs_commit(h);
+    }
+    nvs_close(h);
+}
+
+static void erase_index_cache(void)
+{
+    s_cache_valid = false;
+    nvs_handle_t h;
+    if (nvs_open(s_nvs_namespace, NVS_READWRITE, &h) != ESP_OK) return;
+    if (nvs_erase_key(h, NVS_KEY_INDEX_CACHE) == ESP_OK) {
+        nvs_commit(h);
+    }
+    nvs_close(h);
+}
+
+static esp_err_t http_event_cb(esp_http_client_event_t *evt)
+{
+    if (evt->event_id != HTTP_EVENT_ON_HEADER) return ESP_OK;
+    /* An oversized validator is dropped rather than truncated: a cut ETag
+     * would never match and only cost the header bytes */
+    if (strcasecmp(evt->header_key, "ETag") == 0) {
+        if (strlen(evt->header_value) < sizeof(s_resp_etag)) {
+            strlcpy(s_resp_etag, evt->header_value, sizeof(s_resp_etag));
+        }
+    } else if (strcasecmp(evt->header_key, "Last-Modified") == 0) {
+        if (strlen(evt->header_value) < sizeof(s_resp_last_modified)) {
+            strlcpy(s_resp_last_modified, evt->header_value, sizeof(s_resp_last_modified));
+        }
+    }
+    return ESP_OK;
+}
+
+static void apply_result(bool found, uint32_t latest_hex)
+{
+    if (found && latest_hex > s_current_version) {
+        s_available = true;
+        uint8_t maj = (latest_hex >> 16) & 0xFF;
+        uint8_t min = (latest_hex >>  8) & 0xFF;
+        uint8_t pat =  latest_hex        & 0xFF;
+        snprintf(s_latest_version, sizeof(s_latest_version), "%u.%u.%u", maj, min, pat);
+    } else {
+        s_available = false;
+        s_latest_version[0] = '\0';
+    }
+}
+
+/* ── Persistent client ─────────────────────────────────────────────────── */
+
+/* The client outlives a check so its TLS session ticket does: the next
+ * connection resumes the session instead of a full handshake with
+ * certificate-bundle verification. A connection whose response was read to
+ * the end is also kept open for KEEPALIVE_IDLE_MS, so a manual check right
+ * after another (or after boot) skips the connect entirely. */
+static esp_http_client_handle_t get_client(void)
+{
+    if (!s_client) {
+        esp_http_client_config_t cfg = {
+            .url                = s_index_url,
+            .crt_bundle_attach  = esp_crt_bundle_attach,
+            .timeout_ms         = 10000,
+            .disable_auto_redirect = false,
+            .event_handler      = http_event_cb,
+            .keep_alive_enable  = true,
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+            .save_client_session = true,
+#endif
+        };
+        s_client = esp_http_client_init(&cfg);
+        s_conn_open = false;
+    }
+    return s_client;
+}
+
+static void close_connection(void)
+{
+    if (s_client && s_conn_open) {
+        esp_http_client_close(s_client);
+    }
+    s_conn_open = false;
+}
+
+static void destroy_client(void)
+{
+    if (s_client) {
+        esp_http_client_cleanup(s_client);
+        s_client = NULL;
+    }
+    s_conn_open = false;
+}
+
+/* Send the request and read the response headers. A kept-alive connection
+ * the server has since dropped fails here, and is retried once on a new one.
+ * On success `*connect_us` is the DNS + TCP + TLS time, 0 on reuse. */
+static esp_err_t send_request(esp_http_client_handle_t client, uint32_t *connect_us)
+{
+    for (;;) {
+        bool reuse = s_conn_open;
+        int64_t t0 = esp_timer_get_time();
+        esp_err_t err = esp_http_client_open(client, 0);
+        *connect_us = reuse ? 0 : (uint32_t)(esp_timer_get_time() - t0);
+        heap_sample();
+        if (err == ESP_OK && esp_http_client_fetch_headers(client) < 0) {
+            err = ESP_FAIL;
+        }
+        if (err == ESP_OK) {
+            s_conn_open = true;
+            return ESP_OK;
+        }
+        esp_http_client_close(client);
+        s_conn_open = false;
+        if (!reuse) return err;
+        ESP_LOGD(TAG, "kept-alive connection dropped, reconnecting");
+    }
+}
+
+/* ── Heap use of a check ───────────────────────────────────────────────── */
+
+/* The TLS handshake's allocations are freed before esp_http_client_open()
+ * returns, so sampling alone misses the peak; where IDF can watch the
+ * minimum free size over a window, that is used as well. */
+static void heap_watch_start(void)
+{
+    s_heap_before = s_heap_low = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+#if HAVE_LOCAL_HEAP_MIN
+    heap_caps_monitor_local_minimum_free_size_start();
+#endif
+}
+
+static uint32_t heap_watch_stop(void)
+{
+    heap_sample();
+#if HAVE_LOCAL_HEAP_MIN
+    size_t low = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    if (low < s_heap_low) s_heap_low = low;
+    heap_caps_monitor_local_minimum_free_size_stop();
+#endif
+    return s_heap_before > s_heap_low ? (uint32_t)(s_heap_before - s_heap_low) : 0;
+}
+
 /* ── Core HTTP check ───────────────────────────────────────────────────── */
 
-static void do_check(void)
+/* One index request on the persistent client; caller holds s_mutex */
+static void fetch_index(void)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_http_client_handle_t client = get_client();
+    if (!client) {
+        ESP_LOGW(TAG, "client init failed");
+        return;
+    }
 
-    esp_http_client_config_t cfg = {
-        .url                = s_index_url,
-        .crt_bundle_attach  = esp_crt_bundle_attach,
-        .timeout_ms         = 10000,
-        .disable_auto_redirect = false,
-    };
-    esp_http_client_handle_t client = esp_http_client_init(&cfg);
+    /* Conditional request when the last full download left validators */
+    esp_http_client_delete_header(client, "If-None-Match");
+    esp_http_client_delete_header(client, "If-Modified-Since");
+    bool conditional = s_cache_valid && (s_cache.etag[0] || s_cache.last_modified[0]);
+    if (conditional) {
+        if (s_cache.etag[0]) {
+            esp_http_client_set_header(client, "If-None-Match", s_cache.etag);
+        }
+        if (s_cache.last_modified[0]) {
+            esp_http_client_set_header(client, "If-Modified-Since", s_cache.last_modified);
+        }
+    }
+    s_resp_etag[0] = '\0';
+    s_resp_last_modified[0] = '\0';
 
-    esp_err_t err = esp_http_client_open(client, 0);
+    uint32_t connect_us;
+    esp_err_t err = send_request(client, &connect_us);
     if (err != ESP_OK) {
-        ESP_LOGW(TAG, "open failed: %s", esp_err_to_name(err));
-        esp_http_client_cleanup(client);
-        xSemaphoreGive(s_mutex);
+        ESP_LOGW(TAG, "request failed: %s", esp_err_to_name(err));
         return;
     }
 
-    esp_http_client_fetch_headers(client);
+    portENTER_CRITICAL(&s_stats_lock);
+    if (connect_us) {
+        s_stats.connections++;
+    } else {
+        s_stats.reused++;
+    }
+    s_stats.last_connect_us = connect_us;
+    portEXIT_CRITICAL(&s_stats_lock);
 
     int status = esp_http_client_get_status_code(client);
+    if (status == 304 && conditional) {
+        int drained;
+        if (esp_http_client_flush_response(client, &drained) != ESP_OK) close_connection();
+        apply_result(s_cache.found, s_cache.latest_hex);
+
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.checks++;
+        s_stats.not_modified++;
+        s_stats.last_bytes = 0;
+        s_stats.last_parse_us = 0;
+        s_stats.saved_bytes    += s_cache.body_len;
+        s_stats.saved_parse_us += s_cache.parse_us;
+        portEXIT_CRITICAL(&s_stats_lock);
+
+        ESP_LOGI(TAG, "index not modified (saved %lu B, ~%lu us parse): available=%d latest=%s",
+                 (unsigned long)s_cache.body_len, (unsigned long)s_cache.parse_us,
+                 s_available, s_latest_version);
+        return;
+    }
     if (status != 200) {
         ESP_LOGW(TAG, "HTTP %d", status);
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
-        xSemaphoreGive(s_mutex);
+        close_connection();
         return;
     }
 
+    /* Scan the body as it arrives; the index can be any size and reading
+     * stops at the matching entry */
+    ota_index_scan_t scan;
+    ota_index_scan_init(&scan, OTA_MFR_CODE, s_image_type);
     int total = 0, rd;
-    while (total < INDEX_BUF_SIZE - 1) {
-        rd = esp_http_client_read(client, s_buf + total, INDEX_BUF_SIZE - 1 - total);
+    int64_t scan_us = 0;
+    while (scan.status == OTA_INDEX_SCAN_MORE) {
+        rd = esp_http_client_read(client, s_buf, sizeof(s_buf));
+        heap_sample();
         if (rd <= 0) break;
         total += rd;
+        int64_t t0 = esp_timer_get_time();
+        ota_index_scan_feed(&scan, s_buf, rd);
+        scan_us += esp_timer_get_time() - t0;
     }
-    s_buf[total] = '\0';
-    esp_http_client_close(client);
-    esp_http_client_cleanup(client);
 
-    cJSON *root = cJSON_Parse(s_buf);
-    if (!root) {
-        ESP_LOGW(TAG, "JSON parse failed");
-        xSemaphoreGive(s_mutex);
-        return;
+    /* Keep the connection only when the rest of the body is just the
+     * trailing whitespace; stopping at an entry mid-index leaves too much */
+    int drained;
+    if (scan.status != OTA_INDEX_SCAN_DONE ||
+        esp_http_client_flush_response(client, &drained) != ESP_OK) {
+        close_connection();
     }
 
-    bool found = false;
-    cJSON *item;
-    cJSON_ArrayForEach(item, root) {
-        cJSON *mfr = cJSON_GetObjectItem(item, "manufacturerCode");
-        cJSON *img = cJSON_GetObjectItem(item, "imageType");
-        cJSON *ver = cJSON_GetObjectItem(item, "fileVersion");
-        if (!mfr || !img || !ver) continue;
-        if ((uint16_t)mfr->valueint != OTA_MFR_CODE)   continue;
-        if ((uint16_t)img->valueint != s_image_type)    continue;
-
-        uint32_t latest_hex;
-        if (cJSON_IsNumber(ver)) {
-            latest_hex = (uint32_t)ver->valuedouble;
-        } else if (cJSON_IsString(ver)) {
-            latest_hex = (uint32_t)strtoul(ver->valuestring, NULL, 0);
-        } else {
-            continue;
-        }
-
-        if (latest_hex > s_current_version) {
-            s_available = true;
-            uint8_t maj = (latest_hex >> 16) & 0xFF;
-            uint8_t min = (latest_hex >>  8) & 0xFF;
-            uint8_t pat =  latest_hex        & 0xFF;
-            snprintf(s_latest_version, sizeof(s_latest_version), "%u.%u.%u", maj, min, pat);
-        } else {
-            s_available = false;
-            s_latest_version[0] = '\0';
-        }
-        found = true;
-        break;
+    if (scan.status == OTA_INDEX_SCAN_ERROR || scan.status == OTA_INDEX_SCAN_MORE) {
+        ESP_LOGW(TAG, "index %s at byte %u (%lu entries scanned)",
+                 scan.status == OTA_INDEX_SCAN_ERROR ? "malformed" : "truncated",
+                 (unsigned)scan.offset, (unsigned long)scan.entries);
+        return;
     }
-    cJSON_Delete(root);
+
+    bool found = scan.status == OTA_INDEX_SCAN_FOUND;
+    uint32_t latest_hex = found ? scan.file_version : 0;
+    uint32_t parse_us = (uint32_t)scan_us;
+    apply_result(found, latest_hex);
+
+    memset(&s_cache, 0, sizeof(s_cache));
+    s_cache.version    = INDEX_CACHE_VERSION;
+    s_cache.found      = found;
+    s_cache.image_type = s_image_type;
+    s_cache.latest_hex = latest_hex;
+    s_cache.body_len   = (uint32_t)total;
+    s_cache.parse_us   = parse_us;
+    strlcpy(s_cache.etag, s_resp_etag, sizeof(s_cache.etag));
+    strlcpy(s_cache.last_modified, s_resp_last_modified, sizeof(s_cache.last_modified));
+    s_cache_valid = true;
+    save_index_cache();
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.checks++;
+    s_stats.last_bytes    = (uint32_t)total;
+    s_stats.last_parse_us = parse_us;
+    s_stats.total_bytes  += (uint32_t)total;
+    portEXIT_CRITICAL(&s_stats_lock);
 
     if (!found) ESP_LOGW(TAG, "no matching entry in OTA index (imageType=0x%04X)", s_image_type);
-    ESP_LOGI(TAG, "check done: available=%d latest=%s", s_available, s_latest_version);
+    ESP_LOGI(TAG, "check done (%d B, %lu entries, %lu us parse%s): available=%d latest=%s",
+             total, (unsigned long)scan.entries, (unsigned long)parse_us,
+             s_cache.etag[0] || s_cache.last_modified[0] ? "" : ", no validators",
+             s_available, s_latest_version);
+}
+
+static void do_check(void)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    heap_watch_start();
+    fetch_index();
+    uint32_t heap_peak = heap_watch_stop();
+    if (s_conn_open) s_conn_used_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.last_heap_peak = heap_peak;
+    if (heap_peak > s_stats.max_heap_peak) s_stats.max_heap_peak = heap_peak;
+    uint32_t connect_us = s_stats.last_connect_us;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    ESP_LOGI(TAG, "connect %lu us%s, heap peak %lu B, %s", (unsigned long)connect_us,
+             connect_us ? "" : " (reused)", (unsigned long)heap_peak,
+             s_conn_open ? "connection kept" : "connection closed");
+    bool kept = s_conn_open;
+    xSemaphoreGive(s_mutex);
 
+    /* Let the check task arm the idle close when called from elsewhere */
+    if (kept && s_task && xTaskGetCurrentTaskHandle() != s_task) {
+        xTaskNotify(s_task, NOTIFY_IDLE, eSetBits);
+    }
+}
+
+static void close_idle_connection(void)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_conn_open &&
+        esp_timer_get_time() - s_conn_used_us >= (int64_t)KEEPALIVE_IDLE_MS * 1000) {
+        close_connection();
+        ESP_LOGD(TAG, "idle connection closed");
+    }
     xSemaphoreGive(s_mutex);
 }
 
@@ -137,16 +430,21 @@ static void check_task_fn(void *arg)
     do_check();
 
     while (1) {
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-        do_check();
+        /* While a connection is kept open, wake to close it once idle */
+        TickType_t wait = s_conn_open ? pdMS_TO_TICKS(KEEPALIVE_IDLE_MS) : portMAX_DELAY;
+        uint32_t bits = 0;
+        if (xTaskNotifyWait(0, UINT32_MAX, &bits, wait) == pdFALSE) {
+            close_idle_connection();
+            continue;
+        }
+        if (bits & NOTIFY_CHECK) do_check();
     }
 }
 
 static void timer_cb(void *arg)
 {
-    if (s_task) xTaskNotifyGive(s_task);
+    if (s_task) xTaskNotify(s_task, NOTIFY_CHECK, eSetBits);
 }
-
 /* ── NVS helpers ─────────────────────────────────────────────────────── */
 
 static uint16_t load_interval(void)
@@ -200,6 +498,7 @@ void ota_check_init(const ota_check_config_t *cfg)
 
     s_mutex = xSemaphoreCreateMutex();
     load_index_url();
+    load_index_cache();
     zigbee_ota_set_wifi_index_url(s_index_url);
     xTaskCreate(check_task_fn, "ota_check", 6144, NULL, 2, &s_task);
     start_periodic_timer(load_interval());
@@ -222,6 +521,14 @@ const char *ota_check_latest_version(void)
     return s_latest_version;
 }
 
+void ota_check_get_stats(ota_check_stats_t *out)
+{
+    if (!out) return;
+    portENTER_CRITICAL(&s_stats_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
 uint16_t ota_check_get_interval_hours(void)
 {
     return load_interval();
@@ -254,6 +561,13 @@ void ota_check_set_index_url(const char *url)
     }
     /* Notify OTA component so Z2M-triggered Wi-Fi transport uses the new URL */
     zigbee_ota_set_wifi_index_url(s_index_url);
+    /* Validators, result and TLS session belong to the old index */
+    if (s_mutex) {
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        erase_index_cache();
+        destroy_client();
+        xSemaphoreGive(s_mutex);
+    }
     /* Persist */
     nvs_handle_t h;
     if (nvs_open(s_nvs_namespace, NVS_READWRITE, &h) == ESP_OK) {
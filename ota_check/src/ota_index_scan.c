@@ -0,0 +1,229 @@
+// SPDX-License-Identifier: MIT
+#include "ota_index_scan.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+enum {
+    ST_VALUE,           /* between tokens */
+    ST_STRING,
+    ST_STRING_ESC,      /* after a backslash */
+    ST_BARE,            /* number or true/false/null */
+};
+
+enum {
+    FIELD_NONE,
+    FIELD_MFR,
+    FIELD_IMG,
+    FIELD_VER,
+};
+
+#define HAVE_MFR  (1u << FIELD_MFR)
+#define HAVE_IMG  (1u << FIELD_IMG)
+#define HAVE_VER  (1u << FIELD_VER)
+#define HAVE_ALL  (HAVE_MFR | HAVE_IMG | HAVE_VER)
+
+/* Depth of the entry objects: inside the top-level array */
+#define ENTRY_DEPTH 2
+
+void ota_index_scan_init(ota_index_scan_t *s, uint16_t mfr_code, uint16_t image_type)
+{
+    memset(s, 0, sizeof(*s));
+    s->mfr_code = mfr_code;
+    s->image_type = image_type;
+}
+
+static inline bool in_object(const ota_index_scan_t *s)
+{
+    return s->depth && (s->obj_mask & (1u << (s->depth - 1)));
+}
+
+static uint8_t field_for_key(const char *key)
+{
+    if (strcasecmp(key, "manufacturerCode") == 0) return FIELD_MFR;
+    if (strcasecmp(key, "imageType") == 0)        return FIELD_IMG;
+    if (strcasecmp(key, "fileVersion") == 0)      return FIELD_VER;
+    return FIELD_NONE;
+}
+
+static bool is_number(const char *tok)
+{
+    return tok[0] == '-' || (tok[0] >= '0' && tok[0] <= '9');
+}
+
+/* A complete value for `s->field` of the current entry; the first
+ * occurrence of a key counts, like cJSON_GetObjectItem() */
+static void entry_value(ota_index_scan_t *s, bool is_string)
+{
+    uint8_t bit = 1u << s->field;
+    if (s->have & bit) return;
+
+    char *end;
+    switch (s->field) {
+    case FIELD_MFR:
+    case FIELD_IMG: {
+        if (is_string || !is_number(s->tok)) return;
+        uint16_t v = (uint16_t)(int)strtod(s->tok, &end);
+        if (s->field == FIELD_MFR) s->mfr = v;
+        else                       s->img = v;
+        break;
+    }
+    case FIELD_VER:
+        if (is_string) {
+            s->ver = (uint32_t)strtoul(s->tok, &end, 0);
+        } else if (is_number(s->tok)) {
+            s->ver = (uint32_t)strtod(s->tok, &end);
+        } else {
+            return;     /* true/false/null: entry is skipped */
+        }
+        break;
+    default:
+        return;
+    }
+    s->have |= bit;
+}
+
+/* A string or bare token just ended */
+static void token_done(ota_index_scan_t *s, bool is_string)
+{
+    s->tok[s->tok_len] = '\0';
+    bool captured = s->capture;
+    s->capture = false;
+
+    if (is_string && in_object(s) && s->expect_key) {
+        s->expect_key = false;
+        s->field = (captured && s->depth == ENTRY_DEPTH) ? field_for_key(s->tok) : FIELD_NONE;
+        return;
+    }
+    if (captured && s->field != FIELD_NONE) {
+        entry_value(s, is_string);
+    }
+    s->field = FIELD_NONE;
+}
+
+static void entry_done(ota_index_scan_t *s)
+{
+    s->entries++;
+    if ((s->have & HAVE_ALL) == HAVE_ALL &&
+        s->mfr == s->mfr_code && s->img == s->image_type) {
+        s->file_version = s->ver;
+        s->status = OTA_INDEX_SCAN_FOUND;
+    }
+}
+
+/* Capture the token about to start when it can be a key or value of interest */
+static inline void token_start(ota_index_scan_t *s, bool is_string)
+{
+    s->tok_len = 0;
+    s->capture = s->depth == ENTRY_DEPTH &&
+                 ((is_string && s->expect_key) || s->field != FIELD_NONE);
+}
+
+static inline void token_char(ota_index_scan_t *s, char c)
+{
+    if (!s->capture) return;
+    if (s->tok_len < OTA_INDEX_SCAN_TOK_MAX) {
+        s->tok[s->tok_len++] = c;
+    } else {
+        s->capture = false;     /* too long to be anything we match */
+        s->tok_len = 0;
+    }
+}
+
+/* Structural character or start of a token; false on a syntax error */
+static bool value_char(ota_index_scan_t *s, char c)
+{
+    switch (c) {
+    case ' ': case '\t': case '\r': case '\n': case ':':
+        return true;
+    case ',':
+        if (in_object(s)) s->expect_key = true;
+        return true;
+    case '{':
+    case '[':
+        if (s->depth == OTA_INDEX_SCAN_MAX_DEPTH || (s->depth == 0 && c != '[')) return false;
+        if (c == '{') s->obj_mask |=  (1u << s->depth);
+        else          s->obj_mask &= ~(1u << s->depth);
+        s->depth++;
+        s->expect_key = (c == '{');
+        s->field = FIELD_NONE;
+        if (s->depth == ENTRY_DEPTH && c == '{') s->have = 0;
+        return true;
+    case '}':
+    case ']':
+        if (s->depth == 0 || in_object(s) != (c == '}')) return false;
+        if (s->depth == ENTRY_DEPTH && c == '}') entry_done(s);
+        s->depth--;
+        s->expect_key = false;
+        s->field = FIELD_NONE;
+        if (s->depth == 0 && s->status == OTA_INDEX_SCAN_MORE) s->status = OTA_INDEX_SCAN_DONE;
+        return true;
+    case '"':
+        if (s->depth == 0) return false;
+        token_start(s, true);
+        s->state = ST_STRING;
+        return true;
+    default:
+        if (s->depth == 0 || !(c == '-' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z'))) {
+            return false;
+        }
+        token_start(s, false);
+        token_char(s, c);
+        s->state = ST_BARE;
+        return true;
+    }
+}
+
+ota_index_scan_status_t ota_index_scan_feed(ota_index_scan_t *s, const char *data, size_t len)
+{
+    size_t i = 0;
+    while (i < len && s->status == OTA_INDEX_SCAN_MORE) {
+        char c = data[i];
+        switch (s->state) {
+        case ST_VALUE:
+            if (!value_char(s, c)) s->status = OTA_INDEX_SCAN_ERROR;
+            i++;
+            break;
+
+        case ST_STRING:
+            if (!s->capture) {
+                /* Skipped strings (urls, hashes) are most of the index */
+                while (i < len && data[i] != '"' && data[i] != '\\') i++;
+                if (i == len) break;
+                c = data[i];
+            }
+            if (c == '"') {
+                s->state = ST_VALUE;
+                token_done(s, true);
+            } else if (c == '\\') {
+                s->state = ST_STRING_ESC;
+                token_char(s, c);
+            } else {
+                token_char(s, c);
+            }
+            i++;
+            break;
+
+        case ST_STRING_ESC:
+            token_char(s, c);
+            s->state = ST_STRING;
+            i++;
+            break;
+
+        case ST_BARE:
+            if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+                c == '.' || c == '-' || c == '+' || c == 'E') {
+                token_char(s, c);
+                i++;
+            } else {
+                /* Delimiter: end the token, then handle it as structure */
+                s->state = ST_VALUE;
+                token_done(s, false);
+            }
+            break;
+        }
+    }
+    s->offset += i;
+    return (ota_index_scan_status_t)s->status;
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: MIT
+#pragma once
+
+/**
+ * @file ota_index_scan.h
+ * @brief Incremental OTA index scanner (private to ota_check)
+ *
+ * Finds the fileVersion of the entry matching a manufacturerCode/imageType
+ * pair in a Zigbee OTA index (a JSON array of objects) while the body is
+ * still arriving. Chunks can be split anywhere, nothing is allocated and the
+ * whole state is the struct below, so index size is unbounded. Values nested
+ * inside an entry (up to OTA_INDEX_SCAN_MAX_DEPTH levels) are skipped.
+ *
+ * Matching follows the cJSON code it replaces: the first entry whose numeric
+ * manufacturerCode and imageType match, and whose fileVersion is a number or
+ * a numeric string ("0x01020304" works), wins; key names compare
+ * case-insensitively. Scanning stops there, so the rest of the body need not
+ * be read.
+ *
+ * Plain C with no ESP-IDF dependencies; also built by host_bench/.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_INDEX_SCAN_MAX_DEPTH 32
+#define OTA_INDEX_SCAN_TOK_MAX   24     /* longest key or value captured */
+
+typedef enum {
+    OTA_INDEX_SCAN_MORE = 0,    /**< Feed more data */
+    OTA_INDEX_SCAN_FOUND,       /**< Matching entry found, file_version is set */
+    OTA_INDEX_SCAN_DONE,        /**< End of index, no matching entry */
+    OTA_INDEX_SCAN_ERROR,       /**< Not a JSON array, or malformed / too deeply nested */
+} ota_index_scan_status_t;
+
+typedef struct {
+    /* Search */
+    uint16_t mfr_code;
+    uint16_t image_type;
+
+    /* Result */
+    uint32_t file_version;          /**< Valid when status is FOUND */
+    uint32_t entries;               /**< Entries fully scanned */
+    size_t   offset;                /**< Bytes consumed */
+    uint8_t  status;                /**< ota_index_scan_status_t, sticky once not MORE */
+
+    /* Lexer */
+    uint8_t  state;
+    uint8_t  depth;
+    uint8_t  field;                 /* entry field the pending value belongs to */
+    bool     expect_key;
+    bool     capture;               /* copy the current token into tok */
+    uint8_t  tok_len;
+    uint32_t obj_mask;              /* bit d-1: container at depth d is an object */
+    char     tok[OTA_INDEX_SCAN_TOK_MAX + 1];
+
+    /* Current entry */
+    uint8_t  have;
+    uint16_t mfr;
+    uint16_t img;
+    uint32_t ver;
+} ota_index_scan_t;
+
+void ota_index_scan_init(ota_index_scan_t *s, uint16_t mfr_code, uint16_t image_type);
+
+/**
+ * Consume the next `len` bytes of the index. Returns the scan status; once
+ * it is not OTA_INDEX_SCAN_MORE further calls return it unchanged. Still
+ * MORE at the end of the body means the index was truncated.
+ */
+ota_index_scan_status_t ota_index_scan_feed(ota_index_scan_t *s, const char *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
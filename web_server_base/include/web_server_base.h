@@ -58,6 +58,29 @@ typedef struct {
  */
 esp_err_t web_server_base_start(const web_server_base_config_t *cfg);
 
+/**
+ * Mount the SPIFFS "www" partition ahead of web_server_base_start().
+ *
+ * Optional: lets a boot sequencer run the mount in parallel with other init
+ * work. web_server_base_start() skips the mount if this already ran.
+ *
+ * @return ESP_OK if mounted, ESP_FAIL if the mount failed.
+ */
+esp_err_t web_server_base_mount_storage(void);
+
+/**
+ * Sync firmware-embedded web assets to SPIFFS ahead of web_server_base_start().
+ *
+ * Optional, like web_server_base_mount_storage(). Requires NVS and a mounted
+ * SPIFFS partition; web_server_base_start() skips the sync if this already
+ * succeeded, and retries it otherwise.
+ *
+ * @param cfg  Same config later passed to web_server_base_start()
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if storage is not mounted, ESP_FAIL if
+ *         an asset could not be written, or the NVS error storing its version.
+ */
+esp_err_t web_server_base_sync_assets(const web_server_base_config_t *cfg);
+
 /**
  * Register a device-specific URI handler on the running server.
  *
@@ -3,6 +3,10 @@
 #include "wifi_manager.h"
 #include "ota_check.h"
 #include "crash_diag.h"
+#include "crash_diag_cbor.h"
+#include "crash_diag_hist.h"
+#include "crash_diag_json.h"
+#include "crash_diag_trace.h"
 #include "zigbee_ota.h"
 
 #include "cJSON.h"
@@ -23,12 +27,19 @@ extern esp_err_t ota_upload_transport_flash(httpd_req_t *req);
 #include <stdlib.h>
 #include <string.h>
 
+#if !CONFIG_CRASH_DIAG_JSON
+#error "web_server_base builds GET /api/diag with crash_diag_json_add(): enable CONFIG_CRASH_DIAG_JSON"
+#endif
+
 static const char *TAG = "wsb";
 static httpd_handle_t s_server = NULL;
 static web_server_base_config_t s_cfg_copy;
 static const web_server_base_config_t *s_cfg = NULL;
 static char *s_setup_html = NULL;
 
+/* Built-in handler latency, recorded by timed_handler() */
+static crash_diag_hist_t s_http_latency_us;
+
 #define MAX_BODY_LEN 4096
 
 /* ================================================================== */
@@ -145,9 +156,12 @@ static const char SETUP_HTML_TMPL[] =
 /* ================================================================== */
 
 static bool s_spiffs_ok = false;
+static bool s_spiffs_tried = false;
+static bool s_assets_synced = false;
 
 static void mount_spiffs(void)
 {
+    s_spiffs_tried = true;
     esp_vfs_spiffs_conf_t conf = {
         .base_path              = "/www",
         .partition_label        = "www",
@@ -162,37 +176,39 @@ static void mount_spiffs(void)
     }
 }
 
-static void sync_web_assets(void)
+/* Marks the assets synced only on success, so web_server_base_start() retries a failed sync */
+static esp_err_t sync_web_assets(const web_server_base_config_t *cfg)
 {
-    if (!s_spiffs_ok || !s_cfg) return;
+    if (!s_spiffs_ok || !cfg) return ESP_ERR_INVALID_STATE;
 
     nvs_handle_t nvs = 0;
     bool needs_update = true;
-    if (nvs_open(s_cfg->nvs_namespace, NVS_READWRITE, &nvs) == ESP_OK) {
+    if (nvs_open(cfg->nvs_namespace, NVS_READWRITE, &nvs) == ESP_OK) {
         char stored[16] = {0};
         size_t len = sizeof(stored);
         if (nvs_get_str(nvs, "web_asset_ver", stored, &len) == ESP_OK &&
-            strcmp(stored, s_cfg->firmware_version) == 0) {
+            strcmp(stored, cfg->firmware_version) == 0) {
             needs_update = false;
         }
     }
 
     if (!needs_update) {
-        ESP_LOGI(TAG, "Web assets current (%s)", s_cfg->firmware_version);
+        ESP_LOGI(TAG, "Web assets current (%s)", cfg->firmware_version);
         if (nvs) nvs_close(nvs);
-        return;
+        s_assets_synced = true;
+        return ESP_OK;
     }
 
-    ESP_LOGI(TAG, "Updating web assets to %s", s_cfg->firmware_version);
+    ESP_LOGI(TAG, "Updating web assets to %s", cfg->firmware_version);
 
     struct {
         const char    *path;
         const uint8_t *start;
         size_t         size;
     } files[] = {
-        { "/www/index.html", s_cfg->index_html_start, s_cfg->index_html_size },
-        { "/www/app.js",     s_cfg->app_js_start,     s_cfg->app_js_size     },
-        { "/www/style.css",  s_cfg->style_css_start,  s_cfg->style_css_size  },
+        { "/www/index.html", cfg->index_html_start, cfg->index_html_size },
+        { "/www/app.js",     cfg->app_js_start,     cfg->app_js_size     },
+        { "/www/style.css",  cfg->style_css_start,  cfg->style_css_size  },
     };
 
     bool ok = true;
@@ -207,12 +223,19 @@ static void sync_web_assets(void)
         if (written != len) { ESP_LOGE(TAG, "Short write %s", files[i].path); ok = false; }
     }
 
+    esp_err_t err = ok ? ESP_OK : ESP_FAIL;
     if (ok && nvs) {
-        nvs_set_str(nvs, "web_asset_ver", s_cfg->firmware_version);
-        nvs_commit(nvs);
-        ESP_LOGI(TAG, "Web assets updated");
+        err = nvs_set_str(nvs, "web_asset_ver", cfg->firmware_version);
+        if (err == ESP_OK) err = nvs_commit(nvs);
+        if (err == ESP_OK) {
+            ESP_LOGI(TAG, "Web assets updated");
+        } else {
+            ESP_LOGE(TAG, "Cannot store web asset version: %s", esp_err_to_name(err));
+        }
     }
     if (nvs) nvs_close(nvs);
+    if (err == ESP_OK) s_assets_synced = true;
+    return err;
 }
 
 /* ================================================================== */
@@ -487,18 +510,118 @@ static esp_err_t handle_get_status(httpd_req_t *req)
 /*  GET /api/diag                                                      */
 /* ================================================================== */
 
+/* Scratch shared by both encodings; handlers run one at a time */
+static crash_diag_hist_t s_diag_latency;
+#if CONFIG_CRASH_DIAG_TRACE
+#define DIAG_TRACE_MAX (CONFIG_CRASH_DIAG_TRACE_LEN * portNUM_PROCESSORS)
+static crash_diag_trace_event_t s_diag_trace[DIAG_TRACE_MAX];
+#endif
+
+/* Keys after crash_diag's own (see crash_diag_cbor.h) */
+enum {
+    DIAG_CBOR_KEY_HTTP_LATENCY = CRASH_DIAG_CBOR_KEY_APP,  /* [count, mean, p50, p90, p99, max] */
+    DIAG_CBOR_KEY_PREV_TRACE,                              /* [[ts_us, id, core, arg0, arg1], ...] */
+};
+
+static bool accepts_cbor(httpd_req_t *req)
+{
+    char accept[64];
+    if (httpd_req_get_hdr_value_str(req, "Accept", accept, sizeof(accept)) != ESP_OK) {
+        return false;
+    }
+    return strstr(accept, "application/cbor") != NULL;
+}
+
+static esp_err_t cbor_chunk_sink(void *ctx, const uint8_t *data, size_t len)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, (const char *)data, (ssize_t)len);
+}
+
+/* Same content as the JSON reply, streamed in chunks through a stack buffer */
+static esp_err_t send_diag_cbor(httpd_req_t *req)
+{
+    uint8_t buf[256];
+    crash_diag_cbor_t w;
+    crash_diag_cbor_init_stream(&w, buf, sizeof(buf), cbor_chunk_sink, req);
+    httpd_resp_set_type(req, "application/cbor");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    crash_diag_cbor_map_begin(&w);
+    crash_diag_cbor_write_fields(&w, CRASH_DIAG_CBOR_ALL);
+
+    crash_diag_hist_summary_t ls;
+    crash_diag_hist_snapshot(&s_http_latency_us, &s_diag_latency, false);
+    crash_diag_hist_summary(&s_diag_latency, &ls);
+    crash_diag_cbor_uint(&w, DIAG_CBOR_KEY_HTTP_LATENCY);
+    crash_diag_cbor_array(&w, 6);
+    crash_diag_cbor_uint(&w, ls.count);
+    crash_diag_cbor_uint(&w, ls.mean);
+    crash_diag_cbor_uint(&w, ls.p50);
+    crash_diag_cbor_uint(&w, ls.p90);
+    crash_diag_cbor_uint(&w, ls.p99);
+    crash_diag_cbor_uint(&w, ls.max);
+
+#if CONFIG_CRASH_DIAG_TRACE
+    size_t n = 0;
+    if (crash_diag_get_trace(s_diag_trace, DIAG_TRACE_MAX, &n, true) == ESP_OK) {
+        crash_diag_cbor_uint(&w, DIAG_CBOR_KEY_PREV_TRACE);
+        crash_diag_cbor_array(&w, n);
+        for (size_t i = 0; i < n; i++) {
+            const crash_diag_trace_event_t *e = &s_diag_trace[i];
+            crash_diag_cbor_array(&w, 5);
+            crash_diag_cbor_uint(&w, e->ts_us);
+            crash_diag_cbor_uint(&w, e->id);
+            crash_diag_cbor_uint(&w, e->core);
+            crash_diag_cbor_uint(&w, e->arg0);
+            crash_diag_cbor_uint(&w, e->arg1);
+        }
+    }
+#endif
+    crash_diag_cbor_end(&w);
+
+    size_t len;
+    esp_err_t err = crash_diag_cbor_finish(&w, &len);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "CBOR diag aborted after %u bytes: %s", (unsigned)len, esp_err_to_name(err));
+        return ESP_FAIL;    /* headers are out; httpd closes the socket */
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
 static esp_err_t handle_get_diag(httpd_req_t *req)
 {
-    crash_diag_data_t d;
-    crash_diag_get_data(&d);
+    if (accepts_cbor(req)) {
+        return send_diag_cbor(req);
+    }
 
     cJSON *root = cJSON_CreateObject();
-    cJSON_AddNumberToObject(root, "boot_count",     (double)d.boot_count);
-    cJSON_AddNumberToObject(root, "reset_reason",   (double)d.reset_reason);
-    cJSON_AddStringToObject(root, "reset_reason_str",
-                            crash_diag_reset_reason_str(d.reset_reason));
-    cJSON_AddNumberToObject(root, "last_uptime_sec", (double)d.last_uptime_sec);
-    cJSON_AddNumberToObject(root, "min_free_heap",   (double)d.min_free_heap);
+    if (!root) { httpd_resp_send_500(req); return ESP_OK; }
+    crash_diag_json_add(root, CRASH_DIAG_CBOR_ALL);
+
+    /* Built-in handler latency since boot (includes sending the response) */
+    crash_diag_hist_summary_t ls;
+    crash_diag_hist_snapshot(&s_http_latency_us, &s_diag_latency, false);
+    crash_diag_hist_summary(&s_diag_latency, &ls);
+    cJSON *hl = cJSON_AddObjectToObject(root, "http_latency_us");
+    cJSON_AddNumberToObject(hl, "count", (double)ls.count);
+    cJSON_AddNumberToObject(hl, "mean",  (double)ls.mean);
+    cJSON_AddNumberToObject(hl, "p50",   (double)ls.p50);
+    cJSON_AddNumberToObject(hl, "p90",   (double)ls.p90);
+    cJSON_AddNumberToObject(hl, "p99",   (double)ls.p99);
+    cJSON_AddNumberToObject(hl, "max",   (double)ls.max);
+
+#if CONFIG_CRASH_DIAG_TRACE
+    /* Trace of a boot that ended in a crash, rows [ts_us, id, core, arg0, arg1] */
+    size_t n = 0;
+    if (crash_diag_get_trace(s_diag_trace, DIAG_TRACE_MAX, &n, true) == ESP_OK) {
+        cJSON *arr = cJSON_AddArrayToObject(root, "prev_trace");
+        for (size_t i = 0; i < n; i++) {
+            const crash_diag_trace_event_t *e = &s_diag_trace[i];
+            const double row[] = { e->ts_us, e->id, e->core, e->arg0, e->arg1 };
+            cJSON_AddItemToArray(arr, cJSON_CreateDoubleArray(row, 5));
+        }
+    }
+#endif
     send_json(req, 200, root);
     cJSON_Delete(root);
     return ESP_OK;
@@ -722,6 +845,21 @@ static esp_err_t handle_get_ota_status(httpd_req_t *req)
     cJSON_AddBoolToObject(resp, "available", ota_check_available());
     cJSON_AddStringToObject(resp, "current", plain);
     cJSON_AddStringToObject(resp, "latest",  ota_check_latest_version());
+
+    /* Index fetches since boot; not_modified ones were answered 304 */
+    ota_check_stats_t st;
+    ota_check_get_stats(&st);
+    cJSON *idx = cJSON_AddObjectToObject(resp, "index");
+    cJSON_AddNumberToObject(idx, "checks",         (double)st.checks);
+    cJSON_AddNumberToObject(idx, "not_modified",   (double)st.not_modified);
+    cJSON_AddNumberToObject(idx, "bytes",          (double)st.total_bytes);
+    cJSON_AddNumberToObject(idx, "bytes_saved",    (double)st.saved_bytes);
+    cJSON_AddNumberToObject(idx, "parse_us_saved", (double)st.saved_parse_us);
+    cJSON_AddNumberToObject(idx, "connections",    (double)st.connections);
+    cJSON_AddNumberToObject(idx, "reused",         (double)st.reused);
+    cJSON_AddNumberToObject(idx, "connect_us",     (double)st.last_connect_us);
+    cJSON_AddNumberToObject(idx, "heap_peak",      (double)st.last_heap_peak);
+    cJSON_AddNumberToObject(idx, "heap_peak_max",  (double)st.max_heap_peak);
     send_json(req, 200, resp);
     cJSON_Delete(resp);
     return ESP_OK;
@@ -795,6 +933,22 @@ static esp_err_t handle_post_ota_index_url(httpd_req_t *req)
 /*  404 handler                                                        */
 /* ================================================================== */
 
+/* Built-in handlers are registered through this wrapper, which times every
+ * request and brackets it with trace events; user_ctx is the index into the
+ * handler table */
+static const httpd_uri_t *s_wrapped_uris;
+
+static esp_err_t timed_handler(httpd_req_t *req)
+{
+    uint32_t idx = (uint32_t)(uintptr_t)req->user_ctx;
+    CD_TRACE(CD_TRACE_HTTP_BEGIN, req->method, idx);
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = s_wrapped_uris[idx].handler(req);
+    crash_diag_hist_record(&s_http_latency_us, (uint32_t)(esp_timer_get_time() - t0));
+    CD_TRACE(CD_TRACE_HTTP_END, ret, idx);
+    return ret;
+}
+
 static esp_err_t handle_not_found(httpd_req_t *req, httpd_err_code_t err)
 {
     (void)err;
@@ -821,8 +975,9 @@ esp_err_t web_server_base_start(const web_server_base_config_t *cfg)
                  cfg->firmware_version);/* badge */
     }
 
-    mount_spiffs();
-    sync_web_assets();
+    /* Either step may already have run as a separate boot phase */
+    if (!s_spiffs_tried)  mount_spiffs();
+    if (!s_assets_synced) sync_web_assets(s_cfg);
 
     httpd_config_t hcfg = HTTPD_DEFAULT_CONFIG();
     hcfg.lru_purge_enable  = true;
@@ -863,11 +1018,16 @@ esp_err_t web_server_base_start(const web_server_base_config_t *cfg)
         { .uri = "/api/ota/index-url",   .method = HTTP_POST, .handler = handle_post_ota_index_url},
     };
 
+    s_wrapped_uris = uris;
     for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
-        httpd_register_uri_handler(s_server, &uris[i]);
+        httpd_uri_t u = uris[i];
+        u.handler  = timed_handler;
+        u.user_ctx = (void *)(uintptr_t)i;
+        httpd_register_uri_handler(s_server, &u);
     }
 
     httpd_register_err_handler(s_server, HTTPD_404_NOT_FOUND, handle_not_found);
+    crash_diag_mark(CRASH_DIAG_PHASE_HTTP_READY);
 
     /* Start background OTA check (first check fires 15 s after init) */
     ota_check_config_t ota_cfg = {
@@ -895,6 +1055,19 @@ esp_err_t web_server_base_register(const char *uri, httpd_method_t method,
     return httpd_register_uri_handler(s_server, &h);
 }
 
+esp_err_t web_server_base_mount_storage(void)
+{
+    if (!s_spiffs_tried) mount_spiffs();
+    return s_spiffs_ok ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t web_server_base_sync_assets(const web_server_base_config_t *cfg)
+{
+    if (!cfg) return ESP_ERR_INVALID_ARG;
+    if (!s_spiffs_ok) return ESP_ERR_INVALID_STATE;
+    return s_assets_synced ? ESP_OK : sync_web_assets(cfg);
+}
+
 void web_server_base_stop(void)
 {
     if (s_server) {
@@ -1,6 +1,8 @@
 // SPDX-License-Identifier: MIT
 #include "wifi_manager.h"
 
+#include "crash_diag.h"
+#include "crash_diag_trace.h"
 #include "esp_coexist.h"
 #include "esp_event.h"
 #include "esp_log.h"
@@ -249,6 +251,7 @@ static void captive_dns_task(void *arg)
 static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                                int32_t event_id, void *event_data)
 {
+    CD_TRACE(CD_TRACE_WIFI_EVENT, event_id, event_base == IP_EVENT);
     if (event_base == WIFI_EVENT) {
         switch (event_id) {
         case WIFI_EVENT_STA_START:
@@ -256,6 +259,7 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
              * APSTA is used for provisioning mode scans. */
             if (s_state == WIFI_MGR_STATE_STA_CONNECTING) {
                 ESP_LOGI(TAG, "STA start — connecting...");
+                crash_diag_mark(CRASH_DIAG_PHASE_WIFI_START);
                 esp_wifi_connect();
             }
             break;
@@ -266,6 +270,7 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                 break; /* not in STA mode, ignore */
             }
             wifi_event_sta_disconnected_t *d = (wifi_event_sta_disconnected_t *)event_data;
+            CD_TRACE(CD_TRACE_WIFI_DISC, d->reason, s_retry_count);
             ESP_LOGW(TAG, "STA disconnected (reason %u), retry %d/%d",
                      d->reason, s_retry_count + 1, WIFI_STA_MAX_RETRY);
             if (s_retry_count < WIFI_STA_MAX_RETRY) {
@@ -301,6 +306,7 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t *ev = (ip_event_got_ip_t *)event_data;
         ESP_LOGI(TAG, "STA got IP: " IPSTR, IP2STR(&ev->ip_info.ip));
+        crash_diag_mark(CRASH_DIAG_PHASE_WIFI_GOT_IP);
         s_retry_count = 0;
         s_state = WIFI_MGR_STATE_STA_CONNECTED;
 
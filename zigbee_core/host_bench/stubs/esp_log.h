@@ -0,0 +1,11 @@
+// SPDX-License-Identifier: MIT
+/* Host stub of esp_log.h — logging compiles out so it does not skew timings. */
+#pragma once
+
+#include "esp_err.h"
+
+#define ESP_LOGE(tag, fmt, ...) do { (void)(tag); } while (0)
+#define ESP_LOGW(tag, fmt, ...) do { (void)(tag); } while (0)
+#define ESP_LOGI(tag, fmt, ...) do { (void)(tag); } while (0)
+#define ESP_LOGD(tag, fmt, ...) do { (void)(tag); } while (0)
+#define ESP_LOGV(tag, fmt, ...) do { (void)(tag); } while (0)
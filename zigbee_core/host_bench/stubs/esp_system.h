@@ -0,0 +1,7 @@
+// SPDX-License-Identifier: MIT
+/* Host stub of esp_system.h — esp_restart() is counted, not executed. */
+#pragma once
+
+#include "esp_err.h"
+
+void esp_restart(void);
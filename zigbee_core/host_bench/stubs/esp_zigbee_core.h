@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: MIT
+/**
+ * @file esp_zigbee_core.h
+ * @brief Host stub of the esp-zigbee-lib data model and scheduler.
+ *
+ * Declares only the subset of the esp_zb_* API that zigbee_core and a typical
+ * project attribute handler touch. Names and signatures follow the real
+ * library so handler sources compile unchanged against this header.
+ *
+ * The data model is a flat, fixed-size attribute table and the scheduler is a
+ * fixed-size alarm queue driven by a virtual millisecond clock — no heap, no
+ * threads — so the benchmark measures handler code, not the stub.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ================================================================== */
+/*  Signals                                                            */
+/* ================================================================== */
+
+typedef enum {
+    ESP_ZB_ZDO_SIGNAL_DEFAULT_START      = 0x00,
+    ESP_ZB_ZDO_SIGNAL_SKIP_STARTUP       = 0x01,
+    ESP_ZB_ZDO_SIGNAL_DEVICE_ANNCE       = 0x02,
+    ESP_ZB_ZDO_SIGNAL_LEAVE              = 0x03,
+    ESP_ZB_ZDO_SIGNAL_ERROR              = 0x04,
+    ESP_ZB_BDB_SIGNAL_DEVICE_FIRST_START = 0x05,
+    ESP_ZB_BDB_SIGNAL_DEVICE_REBOOT      = 0x06,
+    ESP_ZB_BDB_SIGNAL_STEERING           = 0x0A,
+    ESP_ZB_COMMON_SIGNAL_CAN_SLEEP       = 0x16,
+    ESP_ZB_NLME_STATUS_INDICATION        = 0x32,
+} esp_zb_app_signal_type_t;
+
+typedef struct esp_zb_app_signal_s {
+    uint32_t *p_app_signal;
+    esp_err_t esp_err_status;
+} esp_zb_app_signal_t;
+
+#define ESP_ZB_BDB_NETWORK_STEERING 0x02
+
+void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct);
+
+esp_err_t esp_zb_bdb_start_top_level_commissioning(uint8_t mode_mask);
+bool      esp_zb_bdb_is_factory_new(void);
+void      esp_zb_factory_reset(void);
+
+/* ================================================================== */
+/*  Scheduler                                                          */
+/* ================================================================== */
+
+typedef void (*esp_zb_callback_t)(uint8_t param);
+
+void esp_zb_scheduler_alarm(esp_zb_callback_t cb, uint8_t param, uint32_t time);
+void esp_zb_scheduler_alarm_cancel(esp_zb_callback_t cb, uint8_t param);
+
+bool esp_zb_lock_acquire(uint32_t block_ticks);
+void esp_zb_lock_release(void);
+
+/* ================================================================== */
+/*  ZCL data model                                                     */
+/* ================================================================== */
+
+typedef enum {
+    ESP_ZB_ZCL_STATUS_SUCCESS      = 0x00,
+    ESP_ZB_ZCL_STATUS_FAIL         = 0x01,
+    ESP_ZB_ZCL_STATUS_UNSUP_ATTRIB = 0x86,
+    ESP_ZB_ZCL_STATUS_INVALID_TYPE = 0x8D,
+} esp_zb_zcl_status_t;
+
+typedef enum {
+    ESP_ZB_ZCL_ATTR_TYPE_U8              = 0x20,
+    ESP_ZB_ZCL_ATTR_TYPE_U16             = 0x21,
+    ESP_ZB_ZCL_ATTR_TYPE_U32             = 0x23,
+    ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING    = 0x41,
+    ESP_ZB_ZCL_ATTR_TYPE_CHAR_STRING     = 0x42,
+    ESP_ZB_ZCL_ATTR_TYPE_LONG_OCTET_STRING = 0x43,
+} esp_zb_zcl_attr_type_t;
+
+#define ESP_ZB_ZCL_CLUSTER_SERVER_ROLE 0x01
+#define ESP_ZB_ZCL_CLUSTER_CLIENT_ROLE 0x02
+
+typedef enum {
+    ESP_ZB_ZCL_CMD_DIRECTION_TO_SRV = 0x00,
+    ESP_ZB_ZCL_CMD_DIRECTION_TO_CLI = 0x01,
+} esp_zb_zcl_cmd_direction_t;
+
+typedef enum {
+    ESP_ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT = 0x00,
+    ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT           = 0x02,
+} esp_zb_zcl_address_mode_t;
+
+typedef union {
+    uint16_t addr_short;
+    uint8_t  addr_long[8];
+} esp_zb_addr_u;
+
+typedef struct {
+    esp_zb_addr_u dst_addr_u;
+    uint8_t       dst_endpoint;
+    uint8_t       src_endpoint;
+} esp_zb_zcl_basic_cmd_t;
+
+typedef struct {
+    esp_zb_zcl_basic_cmd_t    zcl_basic_cmd;
+    esp_zb_zcl_address_mode_t address_mode;
+    uint16_t                  clusterID;
+    uint8_t                   direction;
+    uint16_t                  attributeID;
+} esp_zb_zcl_report_attr_cmd_t;
+
+esp_zb_zcl_status_t esp_zb_zcl_set_attribute_val(uint8_t endpoint, uint16_t cluster_id,
+                                                 uint8_t cluster_role, uint16_t attr_id,
+                                                 void *value_p, bool check);
+esp_err_t esp_zb_zcl_report_attr_cmd_req(esp_zb_zcl_report_attr_cmd_t *cmd_req);
+
+/* ================================================================== */
+/*  Core action callbacks                                              */
+/* ================================================================== */
+
+typedef enum {
+    ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID = 0x0000,
+    ESP_ZB_CORE_REPORT_ATTR_CB_ID    = 0x2000,
+} esp_zb_core_action_callback_id_t;
+
+typedef struct {
+    esp_zb_zcl_status_t status;
+    uint8_t             dst_endpoint;
+    uint16_t            cluster;
+} esp_zb_device_cb_common_info_t;
+
+typedef struct {
+    esp_zb_zcl_attr_type_t type;
+    uint16_t               size;
+    void                  *value;
+} esp_zb_zcl_attribute_data_t;
+
+typedef struct {
+    uint16_t                    id;
+    esp_zb_zcl_attribute_data_t data;
+} esp_zb_zcl_attribute_t;
+
+typedef struct {
+    esp_zb_device_cb_common_info_t info;
+    esp_zb_zcl_attribute_t         attribute;
+} esp_zb_zcl_set_attr_value_message_t;
+
+typedef esp_err_t (*esp_zb_core_action_callback_t)(esp_zb_core_action_callback_id_t callback_id,
+                                                   const void *message);
+
+void esp_zb_core_action_handler_register(esp_zb_core_action_callback_t cb);
+
+/* ================================================================== */
+/*  Stub-only controls (not part of esp-zigbee-lib)                    */
+/* ================================================================== */
+
+#define ZB_STUB_MAX_ATTRS    32
+#define ZB_STUB_MAX_ALARMS   16
+#define ZB_STUB_ATTR_MAX_LEN 64
+
+/** Counters the benchmark reads back to sanity-check each case. */
+typedef struct {
+    uint32_t commissioning_starts;
+    uint32_t attr_sets;
+    uint32_t attr_set_failures;
+    uint32_t reports;
+    uint32_t alarms_scheduled;
+    uint32_t alarms_fired;
+    uint32_t alarms_dropped;
+    uint32_t restarts;
+    uint32_t factory_resets;
+} zb_stub_stats_t;
+
+/** Declare an attribute in the flat data model (call before the run). */
+esp_err_t zb_stub_attr_declare(uint8_t endpoint, uint16_t cluster_id, uint16_t attr_id,
+                               esp_zb_zcl_attr_type_t type, uint16_t size);
+
+/** Deliver a ZCL Write Attributes request through the registered action handler. */
+esp_err_t zb_stub_write_attr(uint8_t endpoint, uint16_t cluster_id, uint16_t attr_id,
+                             esp_zb_zcl_attr_type_t type, void *value, uint16_t size);
+
+/** Advance the virtual clock by @p ms and fire every alarm that became due. */
+void zb_stub_advance(uint32_t ms);
+
+/** Drop all pending alarms (used between benchmark cases). */
+void zb_stub_clear_alarms(void);
+
+void zb_stub_set_factory_new(bool factory_new);
+void zb_stub_get_stats(zb_stub_stats_t *out);
+void zb_stub_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,11 @@
+// SPDX-License-Identifier: MIT
+/* Host stub of FreeRTOS.h */
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef void    *TaskHandle_t;
+
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFUL)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
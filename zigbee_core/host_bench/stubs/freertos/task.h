@@ -0,0 +1,7 @@
+// SPDX-License-Identifier: MIT
+/* Host stub of task.h — delays advance the stub scheduler clock instead of sleeping. */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+void vTaskDelay(TickType_t ticks);
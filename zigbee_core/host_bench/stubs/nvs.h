@@ -0,0 +1,13 @@
+// SPDX-License-Identifier: MIT
+/* Host stub of nvs.h */
+#pragma once
+
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle);
+esp_err_t nvs_erase_all(nvs_handle_t handle);
+esp_err_t nvs_commit(nvs_handle_t handle);
+void      nvs_close(nvs_handle_t handle);
@@ -0,0 +1,5 @@
+// SPDX-License-Identifier: MIT
+/* Host stub of nvs_flash.h */
+#pragma once
+
+#include "nvs.h"
@@ -0,0 +1,3 @@
+// SPDX-License-Identifier: MIT
+/* Host stub of sdkconfig.h: optional features (CD_TRACE, ...) compiled out */
+#pragma once
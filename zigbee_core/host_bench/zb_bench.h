@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: MIT
+/**
+ * @file zb_bench.h
+ * @brief Shared definitions for the zigbee_core host benchmark.
+ */
+#pragma once
+
+#include "esp_zigbee_core.h"
+#include "freertos/FreeRTOS.h"
+
+#define ZB_BENCH_ENDPOINT      10
+#define ZB_BENCH_CLUSTER       0xFC00
+#define ZB_BENCH_ATTR_CFG_U16  0x0000
+#define ZB_BENCH_ATTR_CFG_U8   0x0001
+
+/** Declare the attributes the handler under test expects in the data model. */
+void zb_bench_declare_attrs(void);
+
+/** Action handler under test (registered with esp_zb_core_action_handler_register). */
+esp_err_t zb_bench_action_handler(esp_zb_core_action_callback_id_t callback_id,
+                                  const void *message);
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: MIT
+/**
+ * @file zb_bench_handler.c
+ * @brief Reference custom-cluster attribute handler driven by the benchmark.
+ *
+ * Mirrors the shape of a project's zigbee_attr_handler.c: cluster 0xFC00 with
+ * the shared restart / factory-reset attributes from zigbee_ctrl.h plus two
+ * config attributes that are stored and reported back to the coordinator.
+ *
+ * Both entry points are weak. To benchmark a real project handler, build with
+ * HANDLER_SRCS=path/to/zigbee_attr_handler.c and provide strong definitions of
+ * zb_bench_declare_attrs() and zb_bench_action_handler().
+ */
+
+#include "zb_bench.h"
+#include "zigbee_ctrl.h"
+#include "zigbee_signal_handler.h"
+
+static uint16_t s_cfg_u16 = 0;
+static uint8_t  s_cfg_u8  = 0;
+
+static void report(uint16_t attr_id)
+{
+    esp_zb_zcl_report_attr_cmd_t cmd = {
+        .zcl_basic_cmd = { .src_endpoint = ZB_BENCH_ENDPOINT },
+        .address_mode  = ESP_ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT,
+        .clusterID     = ZB_BENCH_CLUSTER,
+        .direction     = ESP_ZB_ZCL_CMD_DIRECTION_TO_CLI,
+        .attributeID   = attr_id,
+    };
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_zb_zcl_report_attr_cmd_req(&cmd);
+    esp_zb_lock_release();
+}
+
+__attribute__((weak)) void zb_bench_declare_attrs(void)
+{
+    zb_stub_attr_declare(ZB_BENCH_ENDPOINT, ZB_BENCH_CLUSTER, ZB_BENCH_ATTR_CFG_U16,
+                         ESP_ZB_ZCL_ATTR_TYPE_U16, sizeof(uint16_t));
+    zb_stub_attr_declare(ZB_BENCH_ENDPOINT, ZB_BENCH_CLUSTER, ZB_BENCH_ATTR_CFG_U8,
+                         ESP_ZB_ZCL_ATTR_TYPE_U8, sizeof(uint8_t));
+    zb_stub_attr_declare(ZB_BENCH_ENDPOINT, ZB_BENCH_CLUSTER, ZB_ATTR_RESTART,
+                         ESP_ZB_ZCL_ATTR_TYPE_U8, sizeof(uint8_t));
+    zb_stub_attr_declare(ZB_BENCH_ENDPOINT, ZB_BENCH_CLUSTER, ZB_ATTR_FACTORY_RESET,
+                         ESP_ZB_ZCL_ATTR_TYPE_U8, sizeof(uint8_t));
+}
+
+__attribute__((weak)) esp_err_t zb_bench_action_handler(esp_zb_core_action_callback_id_t callback_id,
+                                                        const void *message)
+{
+    if (callback_id != ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID) {
+        return ESP_OK;
+    }
+    const esp_zb_zcl_set_attr_value_message_t *m = message;
+    if (m->info.status != ESP_ZB_ZCL_STATUS_SUCCESS || !m->attribute.data.value) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (m->info.cluster != ZB_BENCH_CLUSTER) {
+        return ESP_OK;
+    }
+
+    switch (m->attribute.id) {
+    case ZB_BENCH_ATTR_CFG_U16:
+        s_cfg_u16 = *(const uint16_t *)m->attribute.data.value;
+        report(ZB_BENCH_ATTR_CFG_U16);
+        return ESP_OK;
+    case ZB_BENCH_ATTR_CFG_U8:
+        s_cfg_u8 = *(const uint8_t *)m->attribute.data.value;
+        report(ZB_BENCH_ATTR_CFG_U8);
+        return ESP_OK;
+    case ZB_ATTR_RESTART:
+        zgb_ctrl_handle_restart();
+        return ESP_OK;
+    case ZB_ATTR_FACTORY_RESET:
+        zgb_ctrl_handle_factory_reset(*(const uint8_t *)m->attribute.data.value,
+                                      zigbee_full_factory_reset);
+        return ESP_OK;
+    default:
+        return ESP_OK;
+    }
+}
@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: MIT
+/**
+ * @file zb_stub.c
+ * @brief Host implementation of the stubbed esp_zb_* data model and scheduler.
+ *
+ * Everything is static and fixed-size so the stub itself never allocates;
+ * any allocation the benchmark counts comes from the code under test.
+ */
+
+#include "crash_diag.h"
+#include "esp_zigbee_core.h"
+#include "esp_system.h"
+#include "freertos/task.h"
+#include "nvs.h"
+
+#include <string.h>
+
+/* ================================================================== */
+/*  Data model                                                         */
+/* ================================================================== */
+
+typedef struct {
+    bool                   used;
+    uint8_t                endpoint;
+    uint16_t               cluster_id;
+    uint16_t               attr_id;
+    esp_zb_zcl_attr_type_t type;
+    uint16_t               size;
+    uint8_t                value[ZB_STUB_ATTR_MAX_LEN];
+} stub_attr_t;
+
+typedef struct {
+    esp_zb_callback_t cb;
+    uint8_t           param;
+    uint32_t          due_ms;
+} stub_alarm_t;
+
+static stub_attr_t    s_attrs[ZB_STUB_MAX_ATTRS];
+static stub_alarm_t   s_alarms[ZB_STUB_MAX_ALARMS];
+static uint32_t       s_alarm_count = 0;
+static uint32_t       s_now_ms = 0;
+static bool           s_factory_new = false;
+static zb_stub_stats_t s_stats;
+static esp_zb_core_action_callback_t s_action_cb = NULL;
+
+static stub_attr_t *find_attr(uint8_t endpoint, uint16_t cluster_id, uint16_t attr_id)
+{
+    for (int i = 0; i < ZB_STUB_MAX_ATTRS; i++) {
+        stub_attr_t *a = &s_attrs[i];
+        if (a->used && a->endpoint == endpoint &&
+            a->cluster_id == cluster_id && a->attr_id == attr_id) {
+            return a;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t zb_stub_attr_declare(uint8_t endpoint, uint16_t cluster_id, uint16_t attr_id,
+                               esp_zb_zcl_attr_type_t type, uint16_t size)
+{
+    if (size > ZB_STUB_ATTR_MAX_LEN) return ESP_ERR_INVALID_ARG;
+    if (find_attr(endpoint, cluster_id, attr_id)) return ESP_OK;
+    for (int i = 0; i < ZB_STUB_MAX_ATTRS; i++) {
+        if (!s_attrs[i].used) {
+            s_attrs[i] = (stub_attr_t){
+                .used = true, .endpoint = endpoint, .cluster_id = cluster_id,
+                .attr_id = attr_id, .type = type, .size = size,
+            };
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_zb_zcl_status_t esp_zb_zcl_set_attribute_val(uint8_t endpoint, uint16_t cluster_id,
+                                                 uint8_t cluster_role, uint16_t attr_id,
+                                                 void *value_p, bool check)
+{
+    (void)cluster_role;
+    (void)check;
+    stub_attr_t *a = find_attr(endpoint, cluster_id, attr_id);
+    if (!a || !value_p) {
+        s_stats.attr_set_failures++;
+        return ESP_ZB_ZCL_STATUS_UNSUP_ATTRIB;
+    }
+    memcpy(a->value, value_p, a->size);
+    s_stats.attr_sets++;
+    return ESP_ZB_ZCL_STATUS_SUCCESS;
+}
+
+esp_err_t esp_zb_zcl_report_attr_cmd_req(esp_zb_zcl_report_attr_cmd_t *cmd_req)
+{
+    if (!cmd_req) return ESP_ERR_INVALID_ARG;
+    if (!find_attr(cmd_req->zcl_basic_cmd.src_endpoint, cmd_req->clusterID,
+                   cmd_req->attributeID)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_stats.reports++;
+    return ESP_OK;
+}
+
+void esp_zb_core_action_handler_register(esp_zb_core_action_callback_t cb)
+{
+    s_action_cb = cb;
+}
+
+esp_err_t zb_stub_write_attr(uint8_t endpoint, uint16_t cluster_id, uint16_t attr_id,
+                             esp_zb_zcl_attr_type_t type, void *value, uint16_t size)
+{
+    /* The real stack stores the value first, then invokes the callback */
+    esp_zb_zcl_status_t st = esp_zb_zcl_set_attribute_val(
+        endpoint, cluster_id, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, attr_id, value, false);
+    if (st != ESP_ZB_ZCL_STATUS_SUCCESS || !s_action_cb) {
+        return ESP_FAIL;
+    }
+    esp_zb_zcl_set_attr_value_message_t msg = {
+        .info = { .status = ESP_ZB_ZCL_STATUS_SUCCESS, .dst_endpoint = endpoint,
+                  .cluster = cluster_id },
+        .attribute = { .id = attr_id, .data = { .type = type, .size = size, .value = value } },
+    };
+    return s_action_cb(ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID, &msg);
+}
+
+/* ================================================================== */
+/*  Scheduler                                                          */
+/* ================================================================== */
+
+void esp_zb_scheduler_alarm(esp_zb_callback_t cb, uint8_t param, uint32_t time)
+{
+    if (s_alarm_count >= ZB_STUB_MAX_ALARMS) {
+        s_stats.alarms_dropped++;
+        return;
+    }
+    s_alarms[s_alarm_count++] = (stub_alarm_t){ .cb = cb, .param = param,
+                                                .due_ms = s_now_ms + time };
+    s_stats.alarms_scheduled++;
+}
+
+void esp_zb_scheduler_alarm_cancel(esp_zb_callback_t cb, uint8_t param)
+{
+    for (uint32_t i = 0; i < s_alarm_count; ) {
+        if (s_alarms[i].cb == cb && s_alarms[i].param == param) {
+            s_alarms[i] = s_alarms[--s_alarm_count];
+        } else {
+            i++;
+        }
+    }
+}
+
+void zb_stub_advance(uint32_t ms)
+{
+    s_now_ms += ms;
+    /* Alarms may schedule further alarms; rescan until nothing is due */
+    bool fired = true;
+    while (fired) {
+        fired = false;
+        for (uint32_t i = 0; i < s_alarm_count; i++) {
+            if ((int32_t)(s_now_ms - s_alarms[i].due_ms) >= 0) {
+                stub_alarm_t a = s_alarms[i];
+                s_alarms[i] = s_alarms[--s_alarm_count];
+                s_stats.alarms_fired++;
+                a.cb(a.param);
+                fired = true;
+                break;
+            }
+        }
+    }
+}
+
+void zb_stub_clear_alarms(void)
+{
+    s_alarm_count = 0;
+}
+
+bool esp_zb_lock_acquire(uint32_t block_ticks)
+{
+    (void)block_ticks;
+    return true;
+}
+
+void esp_zb_lock_release(void)
+{
+}
+
+/* ================================================================== */
+/*  Commissioning / system                                             */
+/* ================================================================== */
+
+esp_err_t esp_zb_bdb_start_top_level_commissioning(uint8_t mode_mask)
+{
+    (void)mode_mask;
+    s_stats.commissioning_starts++;
+    return ESP_OK;
+}
+
+bool esp_zb_bdb_is_factory_new(void)
+{
+    return s_factory_new;
+}
+
+void esp_zb_factory_reset(void)
+{
+    s_stats.factory_resets++;
+}
+
+void esp_restart(void)
+{
+    s_stats.restarts++;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    s_now_ms += ticks;
+}
+
+void zb_stub_set_factory_new(bool factory_new)
+{
+    s_factory_new = factory_new;
+}
+
+void zb_stub_get_stats(zb_stub_stats_t *out)
+{
+    *out = s_stats;
+}
+
+void zb_stub_reset_stats(void)
+{
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    return code == ESP_OK ? "ESP_OK" : "ESP_ERR";
+}
+
+/* ================================================================== */
+/*  NVS + board_led C wrappers referenced by zigbee_signal_handler.c   */
+/* ================================================================== */
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    (void)name;
+    (void)open_mode;
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) { (void)handle; return ESP_OK; }
+esp_err_t nvs_commit(nvs_handle_t handle)    { (void)handle; return ESP_OK; }
+void      nvs_close(nvs_handle_t handle)     { (void)handle; }
+
+void board_led_set_state_off(void)        {}
+void board_led_set_state_not_joined(void) {}
+void board_led_set_state_pairing(void)    {}
+void board_led_set_state_joined(void)     {}
+void board_led_set_state_error(void)      {}
+
+void crash_diag_mark(crash_diag_phase_t phase) { (void)phase; }
@@ -0,0 +1,82 @@
+/**
+ * @file zigbee_diag.h
+ * @brief crash_diag health data as reportable attributes of cluster 0xFC00.
+ *
+ * Replaces seeding diagnostics attributes by hand from crash_diag_get_data().
+ * The attributes are added to the project's custom cluster once, the boot-time
+ * values (boot count, reset reason, previous uptime) are fixed for the whole
+ * boot, and the heap figures are re-read periodically but written to the
+ * data model only when they move by at least heap_delta bytes. Local
+ * reporting configuration makes the stack report them on change (bounded by
+ * the min interval) and at least every max interval, to bound coordinators,
+ * so no polling is needed.
+ *
+ * Usage:
+ *   // while building the endpoint:
+ *   esp_zb_attribute_list_t *ctrl = esp_zb_zcl_attr_list_create(ZB_DIAG_CLUSTER_ID);
+ *   ...project and zigbee_ctrl attributes...
+ *   zigbee_diag_add_attrs(ctrl);
+ *
+ *   // in the on_joined hook (Zigbee task context):
+ *   zigbee_diag_config_t cfg = ZIGBEE_DIAG_CONFIG_DEFAULT(MY_ENDPOINT);
+ *   zigbee_diag_start(&cfg);
+ */
+
+#ifndef ZIGBEE_DIAG_H
+#define ZIGBEE_DIAG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+#include <stdint.h>
+
+/* Custom cluster shared with zigbee_ctrl.h */
+#define ZB_DIAG_CLUSTER_ID             0xFC00
+
+/* Attribute IDs in custom cluster 0xFC00, all read-only and reportable */
+#define ZB_ATTR_DIAG_BOOT_COUNT        0x00E0  /* U32, boots since NVS counter reset */
+#define ZB_ATTR_DIAG_RESET_REASON      0x00E1  /* U8, esp_reset_reason_t as in crash_diag_data_t */
+#define ZB_ATTR_DIAG_LAST_UPTIME       0x00E2  /* U32, seconds the previous boot ran */
+#define ZB_ATTR_DIAG_MIN_FREE_HEAP     0x00E3  /* U32, bytes, low-water mark of internal RAM */
+#define ZB_ATTR_DIAG_LARGEST_BLOCK     0x00E4  /* U32, bytes, largest free internal block */
+
+typedef struct {
+    uint8_t  endpoint;          /**< Endpoint carrying cluster 0xFC00 */
+    uint16_t refresh_sec;       /**< How often heap figures are re-read */
+    uint16_t report_min_sec;    /**< Minimum seconds between reports of one attribute */
+    uint16_t report_max_sec;    /**< Report at least this often (0 = only on change) */
+    uint32_t heap_delta;        /**< Heap change (bytes) that counts as a change */
+} zigbee_diag_config_t;
+
+#define ZIGBEE_DIAG_CONFIG_DEFAULT(ep) { \
+    .endpoint       = (ep),              \
+    .refresh_sec    = 60,                \
+    .report_min_sec = 60,                \
+    .report_max_sec = 3600,              \
+    .heap_delta     = 1024,              \
+}
+
+/**
+ * @brief Add the diagnostics attributes to the custom cluster's attribute list.
+ *
+ * Call once while creating the endpoint, after crash_diag_init(). The
+ * attributes start with this boot's values.
+ */
+esp_err_t zigbee_diag_add_attrs(esp_zb_attribute_list_t *custom_cluster);
+
+/**
+ * @brief Configure reporting and start refreshing the heap attributes.
+ *
+ * Call from the Zigbee task (e.g. the on_joined hook); calling it again on
+ * rejoin re-applies the reporting configuration and restarts the refresh.
+ */
+esp_err_t zigbee_diag_start(const zigbee_diag_config_t *cfg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZIGBEE_DIAG_H */
@@ -0,0 +1,150 @@
+/**
+ * @file zigbee_diag.c
+ * @brief Diagnostics attributes fed from crash_diag, reported on change.
+ */
+
+#include "zigbee_diag.h"
+#include "crash_diag.h"
+#include "esp_log.h"
+
+#include <string.h>
+
+static const char *TAG = "zigbee_diag";
+
+/* Attribute storage handed to esp_zb_custom_cluster_add_custom_attr(), which
+ * copies it; these also hold the last values written to the data model */
+static uint32_t s_boot_count;
+static uint8_t  s_reset_reason;
+static uint32_t s_last_uptime;
+static uint32_t s_min_free_heap;
+static uint32_t s_largest_block;
+
+static zigbee_diag_config_t s_cfg;
+static bool s_started;
+
+static const uint16_t s_reported[] = {
+    ZB_ATTR_DIAG_BOOT_COUNT,
+    ZB_ATTR_DIAG_RESET_REASON,
+    ZB_ATTR_DIAG_LAST_UPTIME,
+    ZB_ATTR_DIAG_MIN_FREE_HEAP,
+    ZB_ATTR_DIAG_LARGEST_BLOCK,
+};
+
+static void read_heap(uint32_t *min_free, uint32_t *largest)
+{
+    crash_diag_heap_stats_t hs;
+    crash_diag_get_heap_stats(&hs);
+    *min_free = hs.min_free_internal;
+    *largest  = hs.largest_internal;
+}
+
+esp_err_t zigbee_diag_add_attrs(esp_zb_attribute_list_t *custom_cluster)
+{
+    if (!custom_cluster) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    crash_diag_data_t d;
+    crash_diag_get_data(&d);
+    s_boot_count   = d.boot_count;
+    s_reset_reason = d.reset_reason;
+    s_last_uptime  = d.last_uptime_sec;
+    read_heap(&s_min_free_heap, &s_largest_block);
+
+    const uint8_t access = ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING;
+    const struct {
+        uint16_t id;
+        uint8_t  type;
+        void    *value;
+    } attrs[] = {
+        { ZB_ATTR_DIAG_BOOT_COUNT,    ESP_ZB_ZCL_ATTR_TYPE_U32, &s_boot_count    },
+        { ZB_ATTR_DIAG_RESET_REASON,  ESP_ZB_ZCL_ATTR_TYPE_U8,  &s_reset_reason  },
+        { ZB_ATTR_DIAG_LAST_UPTIME,   ESP_ZB_ZCL_ATTR_TYPE_U32, &s_last_uptime   },
+        { ZB_ATTR_DIAG_MIN_FREE_HEAP, ESP_ZB_ZCL_ATTR_TYPE_U32, &s_min_free_heap },
+        { ZB_ATTR_DIAG_LARGEST_BLOCK, ESP_ZB_ZCL_ATTR_TYPE_U32, &s_largest_block },
+    };
+    for (size_t i = 0; i < sizeof(attrs) / sizeof(attrs[0]); i++) {
+        esp_err_t err = esp_zb_custom_cluster_add_custom_attr(custom_cluster, attrs[i].id,
+                                                              attrs[i].type, access, attrs[i].value);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to add attr 0x%04X: %s", attrs[i].id, esp_err_to_name(err));
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static void configure_reporting(uint16_t attr_id)
+{
+    esp_zb_zcl_reporting_info_t info;
+    memset(&info, 0, sizeof(info));
+    info.direction    = ESP_ZB_ZCL_REPORT_DIRECTION_SEND;
+    info.ep           = s_cfg.endpoint;
+    info.cluster_id   = ZB_DIAG_CLUSTER_ID;
+    info.cluster_role = ESP_ZB_ZCL_CLUSTER_SERVER_ROLE;
+    info.attr_id      = attr_id;
+    info.manuf_code   = ESP_ZB_ZCL_ATTR_NON_MANUFACTURER_SPECIFIC;
+    info.dst.profile_id = ESP_ZB_AF_HA_PROFILE_ID;
+    info.u.send_info.min_interval     = s_cfg.report_min_sec;
+    info.u.send_info.max_interval     = s_cfg.report_max_sec;
+    info.u.send_info.def_min_interval = s_cfg.report_min_sec;
+    info.u.send_info.def_max_interval = s_cfg.report_max_sec;
+    info.u.send_info.delta.u32        = (attr_id == ZB_ATTR_DIAG_MIN_FREE_HEAP ||
+                                         attr_id == ZB_ATTR_DIAG_LARGEST_BLOCK) ? s_cfg.heap_delta : 1;
+
+    esp_err_t err = esp_zb_zcl_update_reporting_info(&info);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Reporting config for 0x%04X failed: %s", attr_id, esp_err_to_name(err));
+    }
+}
+
+static bool moved(uint32_t now, uint32_t last, uint32_t delta)
+{
+    return (now > last ? now - last : last - now) >= delta;
+}
+
+static void set_u32(uint16_t attr_id, uint32_t *store, uint32_t value)
+{
+    *store = value;
+    esp_zb_zcl_set_attribute_val(s_cfg.endpoint, ZB_DIAG_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 attr_id, store, false);
+}
+
+/* Scheduler alarm: runs in the Zigbee task, so no stack lock is needed */
+static void refresh_cb(uint8_t param)
+{
+    (void)param;
+    uint32_t min_free, largest;
+    read_heap(&min_free, &largest);
+
+    /* Untouched attributes generate no reports; min_interval paces the rest */
+    if (moved(min_free, s_min_free_heap, s_cfg.heap_delta)) {
+        set_u32(ZB_ATTR_DIAG_MIN_FREE_HEAP, &s_min_free_heap, min_free);
+    }
+    if (moved(largest, s_largest_block, s_cfg.heap_delta)) {
+        set_u32(ZB_ATTR_DIAG_LARGEST_BLOCK, &s_largest_block, largest);
+    }
+    esp_zb_scheduler_alarm(refresh_cb, 0, (uint32_t)s_cfg.refresh_sec * 1000);
+}
+
+esp_err_t zigbee_diag_start(const zigbee_diag_config_t *cfg)
+{
+    if (!cfg || cfg->refresh_sec == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_cfg = *cfg;
+    if (s_cfg.heap_delta == 0) {
+        s_cfg.heap_delta = 1;
+    }
+    for (size_t i = 0; i < sizeof(s_reported) / sizeof(s_reported[0]); i++) {
+        configure_reporting(s_reported[i]);
+    }
+
+    if (s_started) {
+        esp_zb_scheduler_alarm_cancel(refresh_cb, 0);
+    }
+    s_started = true;
+    refresh_cb(0);
+    ESP_LOGI(TAG, "Diagnostics reporting on ep %u (refresh %us, report %u..%us)",
+             s_cfg.endpoint, s_cfg.refresh_sec, s_cfg.report_min_sec, s_cfg.report_max_sec);
+    return ESP_OK;
+}
@@ -9,6 +9,8 @@
 
 #include "zigbee_signal_handler.h"
 
+#include "crash_diag.h"
+#include "crash_diag_trace.h"
 #include "esp_log.h"
 
 /* C wrappers for BoardLed (defined in board_led component) */
@@ -104,10 +106,13 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
     uint32_t *p_sg_p = signal_struct ? signal_struct->p_app_signal : NULL;
     esp_zb_app_signal_type_t sig = p_sg_p ? *p_sg_p : 0;
     esp_err_t status = signal_struct ? signal_struct->esp_err_status : ESP_OK;
+    CD_TRACE(CD_TRACE_ZB_SIGNAL, sig, status);
 
     switch (sig) {
     case ESP_ZB_ZDO_SIGNAL_SKIP_STARTUP:
         ESP_LOGI(TAG, "Stack initialized, starting network steering");
+        crash_diag_mark(CRASH_DIAG_PHASE_ZB_STACK_UP);
+        crash_diag_mark(CRASH_DIAG_PHASE_ZB_STEERING);
         board_led_set_state_pairing();
         esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_NETWORK_STEERING);
         if (s_hooks && s_hooks->on_stack_init) {
@@ -118,8 +123,10 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
     case ESP_ZB_BDB_SIGNAL_DEVICE_FIRST_START:
     case ESP_ZB_BDB_SIGNAL_DEVICE_REBOOT:
         if (status == ESP_OK) {
+            crash_diag_mark(CRASH_DIAG_PHASE_ZB_STACK_UP);
             if (esp_zb_bdb_is_factory_new()) {
                 ESP_LOGI(TAG, "Factory new device, starting network steering");
+                crash_diag_mark(CRASH_DIAG_PHASE_ZB_STEERING);
                 board_led_set_state_pairing();
                 esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_NETWORK_STEERING);
             } else {
@@ -131,10 +138,12 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
                  * the parent association and emits Device_annce as part of
                  * the rejoin — robust to stale parent state. */
                 ESP_LOGI(TAG, "Device rebooted (C6 ED) — rejoining to re-establish parent link");
+                crash_diag_mark(CRASH_DIAG_PHASE_ZB_STEERING);
                 board_led_set_state_pairing();
                 esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_NETWORK_STEERING);
 #else
                 ESP_LOGI(TAG, "Device rebooted, already joined network");
+                crash_diag_mark(CRASH_DIAG_PHASE_ZB_JOINED);
                 board_led_set_state_joined();
                 s_network_joined = true;
                 if (s_hooks && s_hooks->on_joined) {
@@ -153,6 +162,7 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
     case ESP_ZB_BDB_SIGNAL_STEERING:
         if (status == ESP_OK) {
             ESP_LOGI(TAG, "Successfully joined Zigbee network!");
+            crash_diag_mark(CRASH_DIAG_PHASE_ZB_JOINED);
             board_led_set_state_joined();
             s_network_joined = true;
             if (s_hooks && s_hooks->on_joined) {